@@ -34,4 +34,8 @@ macro(rg_setup_compile_options)
         # Still debating whether -fno-inline is necessary or not...
         component_compile_options(-DRG_ENABLE_PROFILING -finstrument-functions)
     endif()
+
+    if($ENV{RG_ENABLE_MEMTRACE})
+        component_compile_options(-DRG_ENABLE_MEMTRACE)
+    endif()
 endmacro()
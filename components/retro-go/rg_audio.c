@@ -1,6 +1,7 @@
 #include "rg_system.h"
 #include "rg_audio.h"
 
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
@@ -406,3 +407,157 @@ void rg_audio_set_sample_rate(int sampleRate)
     audio.sampleRate = sampleRate;
     RELEASE_DEVICE();
 }
+
+#define BLIP_TIME_BITS  32 // Fixed point fraction of the sample position
+#define BLIP_PHASE_BITS 5  // Kernel phases, sub-sample resolution of a delta
+#define BLIP_PHASES     (1 << BLIP_PHASE_BITS)
+#define BLIP_TAPS       16
+#define BLIP_DELTA_BITS 14 // Kernel precision, leaves 16 bits for the deltas
+#define BLIP_BASS_SHIFT 9  // DC removal (about 10Hz at 32KHz)
+
+struct rg_blip_s
+{
+    uint64_t factor; // Samples per clock
+    uint64_t offset; // End of the current frame, in samples
+    int32_t integrator;
+    int size;
+    int32_t buffer[];
+};
+
+static int16_t blip_kernel[BLIP_PHASES][BLIP_TAPS];
+
+static void blip_init_kernel(void)
+{
+    // Blackman windowed sinc, cut a bit below nyquist to leave room for the window's transition.
+    // Each phase is normalized so that a step always settles at exactly `delta`.
+    const double cutoff = 0.9;
+
+    for (int phase = 0; phase < BLIP_PHASES; ++phase)
+    {
+        double taps[BLIP_TAPS], total = 0;
+        int sum = 0, peak = 0;
+
+        for (int i = 0; i < BLIP_TAPS; ++i)
+        {
+            double x = i - (BLIP_TAPS / 2 - 1) - (double)phase / BLIP_PHASES;
+            double w = x / (BLIP_TAPS / 2);
+            double window = 0.42 + 0.5 * cos(M_PI * w) + 0.08 * cos(2 * M_PI * w);
+            taps[i] = (x == 0 ? 1.0 : sin(M_PI * cutoff * x) / (M_PI * cutoff * x)) * window;
+            total += taps[i];
+        }
+
+        for (int i = 0; i < BLIP_TAPS; ++i)
+        {
+            blip_kernel[phase][i] = lround(taps[i] / total * (1 << BLIP_DELTA_BITS));
+            sum += blip_kernel[phase][i];
+            if (blip_kernel[phase][i] > blip_kernel[phase][peak])
+                peak = i;
+        }
+
+        blip_kernel[phase][peak] += (1 << BLIP_DELTA_BITS) - sum;
+    }
+}
+
+rg_blip_t *rg_blip_create(int max_samples)
+{
+    rg_blip_t *blip = calloc(1, sizeof(rg_blip_t) + (max_samples + BLIP_TAPS) * sizeof(int32_t));
+    if (!blip)
+    {
+        RG_LOGE("Failed to allocate blip buffer (%d samples)!\n", max_samples);
+        return NULL;
+    }
+    if (!blip_kernel[0][BLIP_TAPS / 2])
+        blip_init_kernel();
+    blip->size = max_samples;
+    rg_blip_set_rates(blip, 1, 1);
+    return blip;
+}
+
+void rg_blip_free(rg_blip_t *blip)
+{
+    free(blip);
+}
+
+void rg_blip_set_rates(rg_blip_t *blip, double clock_rate, double sample_rate)
+{
+    // Only the rate of the deltas to come changes, whatever is already buffered stays as is
+    blip->factor = (uint64_t)(sample_rate / clock_rate * ((uint64_t)1 << BLIP_TIME_BITS) + 0.5);
+}
+
+void rg_blip_clear(rg_blip_t *blip)
+{
+    memset(blip->buffer, 0, (blip->size + BLIP_TAPS) * sizeof(int32_t));
+    blip->offset = 0;
+    blip->integrator = 0;
+}
+
+void rg_blip_add_delta(rg_blip_t *blip, unsigned time, int delta)
+{
+    uint64_t pos = blip->offset + time * blip->factor;
+    unsigned index = pos >> BLIP_TIME_BITS;
+
+    if (index >= (unsigned)blip->size) // The frame is longer than the buffer, drop it
+        return;
+
+    const int16_t *kernel = blip_kernel[(pos >> (BLIP_TIME_BITS - BLIP_PHASE_BITS)) & (BLIP_PHASES - 1)];
+    int32_t *out = blip->buffer + index;
+
+    for (int i = 0; i < BLIP_TAPS; ++i)
+        out[i] += kernel[i] * delta;
+}
+
+void rg_blip_end_frame(rg_blip_t *blip, unsigned duration)
+{
+    blip->offset += duration * blip->factor;
+
+    if ((blip->offset >> BLIP_TIME_BITS) > (uint64_t)blip->size)
+        blip->offset = (uint64_t)blip->size << BLIP_TIME_BITS;
+}
+
+int rg_blip_samples_avail(const rg_blip_t *blip)
+{
+    return blip->offset >> BLIP_TIME_BITS;
+}
+
+unsigned rg_blip_clocks_needed(const rg_blip_t *blip, int samples)
+{
+    // For sound chips that are pulled by the audio output instead of driven by the emulation
+    uint64_t needed = (uint64_t)samples << BLIP_TIME_BITS;
+    if (needed <= blip->offset)
+        return 0;
+    return (needed - blip->offset + blip->factor - 1) / blip->factor;
+}
+
+int rg_blip_read_samples(rg_blip_t *blip, int16_t *out, int count, int stride)
+{
+    int avail = rg_blip_samples_avail(blip);
+    int32_t sum = blip->integrator;
+
+    if (count > avail)
+        count = avail;
+
+    for (int i = 0; i < count; ++i)
+    {
+        int sample = sum >> BLIP_DELTA_BITS;
+        sum += blip->buffer[i];
+        if (sample > 32767)
+            sample = 32767;
+        else if (sample < -32768)
+            sample = -32768;
+        if (out) // NULL discards the samples
+        {
+            *out = sample;
+            out += stride;
+        }
+        sum -= sample << (BLIP_DELTA_BITS - BLIP_BASS_SHIFT);
+    }
+
+    // Shift the deltas of the samples that are still pending (and the kernel tails) to the front
+    int remaining = avail - count + BLIP_TAPS;
+    memmove(blip->buffer, blip->buffer + count, remaining * sizeof(int32_t));
+    memset(blip->buffer + remaining, 0, count * sizeof(int32_t));
+    blip->offset -= (uint64_t)count << BLIP_TIME_BITS;
+    blip->integrator = sum;
+
+    return count;
+}
@@ -62,3 +62,18 @@ void rg_audio_set_volume(int percent);
 void rg_audio_set_mute(bool mute);
 int rg_audio_get_sample_rate(void);
 void rg_audio_set_sample_rate(int sampleRate);
+
+// Band-limited synthesis buffer. Sound chips report amplitude changes (deltas) timestamped in
+// their own clock and the buffer turns them into samples at any output rate. Deltas are only
+// needed when a channel's output changes, and changing the rate (fast forward) is free.
+typedef struct rg_blip_s rg_blip_t;
+
+rg_blip_t *rg_blip_create(int max_samples);
+void rg_blip_free(rg_blip_t *blip);
+void rg_blip_set_rates(rg_blip_t *blip, double clock_rate, double sample_rate);
+void rg_blip_clear(rg_blip_t *blip);
+void rg_blip_add_delta(rg_blip_t *blip, unsigned time, int delta);
+void rg_blip_end_frame(rg_blip_t *blip, unsigned duration);
+int rg_blip_samples_avail(const rg_blip_t *blip);
+unsigned rg_blip_clocks_needed(const rg_blip_t *blip, int samples);
+int rg_blip_read_samples(rg_blip_t *blip, int16_t *out, int count, int stride);
@@ -1,5 +1,6 @@
 #include "rg_system.h"
 #include "rg_display.h"
+#include "rg_display_lines.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -40,6 +41,11 @@ static struct
     uint8_t repeat : 6; // How many times the line or column is repeated by the scaler or filter
 } filter_lines[320];
 static uint8_t screen_line_is_empty[RG_SCREEN_HEIGHT];
+static rg_line_diff_t rotated_diff[320]; // Diff of the source buffer's rows, before rotation
+static struct
+{
+    int width, height, crop_h, crop_v, stride, format;
+} source_format; // As given by the application, before rotation
 
 static const char *SETTING_BACKLIGHT = "DispBacklight";
 static const char *SETTING_SCALING = "DispScaling";
@@ -413,6 +419,33 @@ static inline unsigned blend_pixels(unsigned a, unsigned b)
     return (v << 8) | (v >> 8);
 }
 
+// Returns the address of the top left pixel of the (rotated) frame, as well as the byte offsets
+// to the next pixel on the same line (x_step) and to the next line (y_step).
+static inline const uint8_t *source_origin(const void *buffer, int *x_step, int *y_step)
+{
+    const int pixlen = display.source.pixlen;
+    const int stride = display.source.stride;
+
+    if (display.source.rotation == RG_DISPLAY_ROTATION_LEFT)
+    {
+        // Source row r becomes column r, read bottom to top
+        *x_step = stride;
+        *y_step = -pixlen;
+        return buffer + display.source.offset + (display.source.height - 1) * pixlen;
+    }
+    else if (display.source.rotation == RG_DISPLAY_ROTATION_RIGHT)
+    {
+        // Source row r becomes column (rows - 1 - r), read top to bottom
+        *x_step = -stride;
+        *y_step = pixlen;
+        return buffer + display.source.offset + (display.source.width - 1) * stride;
+    }
+
+    *x_step = pixlen;
+    *y_step = stride;
+    return buffer + display.source.offset;
+}
+
 static inline void write_rect(int left, int top, int width, int height,
                               const void *framebuffer, const uint16_t *palette)
 {
@@ -434,16 +467,16 @@ static inline void write_rect(int left, int top, int width, int height,
     const int filter_mode = config.scaling ? config.filter : 0;
     const bool filter_y = filter_mode == RG_DISPLAY_FILTER_VERT || filter_mode == RG_DISPLAY_FILTER_BOTH;
     const bool filter_x = filter_mode == RG_DISPLAY_FILTER_HORIZ || filter_mode == RG_DISPLAY_FILTER_BOTH;
-    const int format = display.source.format;
-    const int stride = display.source.stride;
-    union { const uint8_t *u8; const uint16_t *u16; } buffer;
+    const uint8_t *buffer;
+    int x_step, y_step;
 
     if (scaled_width < 1 || scaled_height < 1)
     {
         return;
     }
 
-    buffer.u8 = framebuffer + display.source.offset + (top * stride) + (left * display.source.pixlen);
+    buffer = source_origin(framebuffer, &x_step, &y_step);
+    buffer += (top * y_step) + (left * x_step);
 
     lcd_set_window(
         screen_left + RG_SCREEN_MARGIN_LEFT,
@@ -471,6 +504,7 @@ static inline void write_rect(int left, int top, int width, int height,
 
         uint16_t *line_buffer = spi_get_buffer();
         uint16_t *line_buffer_ptr = line_buffer;
+        int64_t build_start = rg_system_timer();
 
         for (int i = 0; i < lines_to_copy; ++i)
         {
@@ -481,27 +515,13 @@ static inline void write_rect(int left, int top, int width, int height,
             }
             else
             {
-                #define RENDER_LINE(pixel) { \
-                    for (int x = 0, x_acc = ix_acc; x < width;) { \
-                        *line_buffer_ptr++ = (pixel); \
-                        x_acc += x_inc; \
-                        while (x_acc >= screen_width) { \
-                            x_acc -= screen_width; \
-                            ++x; \
-                        } \
-                    } \
-                }
-                if (format & RG_PIXEL_PAL)
-                    RENDER_LINE(palette[buffer.u8[x]])
-                else if (format & RG_PIXEL_LE)
-                    RENDER_LINE((buffer.u16[x] << 8) | (buffer.u16[x] >> 8))
-                else
-                    RENDER_LINE(buffer.u16[x])
+                const uint16_t *line = line_fetcher(buffer, x_step, width, palette);
+                line_buffer_ptr = line_scaler(line_buffer_ptr, line, width, ix_acc);
             }
 
             if (!screen_line_is_empty[++screen_y])
             {
-                buffer.u8 += stride;
+                buffer += y_step;
                 ++y;
             }
         }
@@ -554,6 +574,7 @@ static inline void write_rect(int left, int top, int width, int height,
             }
         }
 
+        counters.renderTime += rg_system_timer() - build_start;
         lcd_send_data(line_buffer, scaled_width * lines_to_copy * 2);
     }
 }
@@ -595,6 +616,9 @@ static void update_viewport_scaling(void)
     display.viewport.width = new_width;
     display.viewport.height = new_height;
 
+    select_line_renderers(display.source.format, display.source.rotation != RG_DISPLAY_ROTATION_OFF,
+                          display.viewport.x_inc, display.screen.width);
+
     // Build boundary tables used by filtering
 
     memset(filter_lines, 1, sizeof(filter_lines));
@@ -618,9 +642,9 @@ static void update_viewport_scaling(void)
         }
     }
 
-    RG_LOGI("%dx%d@%.3f => %dx%d@%.3f x_pos:%d y_pos:%d x_inc:%d y_inc:%d\n", src_width, src_height,
+    RG_LOGI("%dx%d@%.3f => %dx%d@%.3f x_pos:%d y_pos:%d x_inc:%d y_inc:%d kernel:%d\n", src_width, src_height,
             src_width / (double)src_height, new_width, new_height, new_ratio, display.viewport.x_pos,
-            display.viewport.y_pos, display.viewport.x_inc, display.viewport.y_inc);
+            display.viewport.y_pos, display.viewport.x_inc, display.viewport.y_inc, scale_kernel);
 }
 
 static void display_task(void *arg)
@@ -743,7 +767,7 @@ display_filter_t rg_display_get_filter(void)
 void rg_display_set_rotation(display_rotation_t rotation)
 {
     config.rotation = RG_MIN(RG_MAX(0, rotation), RG_DISPLAY_ROTATION_COUNT - 1);
-    rg_settings_set_number(NS_APP, SETTING_SCALING, config.rotation);
+    rg_settings_set_number(NS_APP, SETTING_ROTATION, config.rotation);
     display.changed = true;
 }
 
@@ -771,20 +795,21 @@ bool rg_display_save_frame(const char *filename, const rg_video_update_t *frame,
         return false;
 
     uint16_t *dst_ptr = original->data;
+    int x_step, y_step;
+    const uint8_t *origin = source_origin(frame->buffer, &x_step, &y_step);
 
     for (int y = 0; y < original->height; y++)
     {
-        const uint8_t *src_ptr8 = frame->buffer + display.source.offset + (y * display.source.stride);
-        const uint16_t *src_ptr16 = (const uint16_t *)src_ptr8;
+        const uint8_t *src_ptr8 = origin + (y * y_step);
 
         for (int x = 0; x < original->width; x++)
         {
             uint16_t pixel;
 
             if (display.source.format & RG_PIXEL_PAL)
-                pixel = frame->palette[src_ptr8[x]];
+                pixel = frame->palette[src_ptr8[x * x_step]];
             else
-                pixel = src_ptr16[x];
+                pixel = *(const uint16_t *)(src_ptr8 + x * x_step);
 
             if (!(display.source.format & RG_PIXEL_LE))
                 pixel = (pixel << 8) | (pixel >> 8);
@@ -796,12 +821,118 @@ bool rg_display_save_frame(const char *filename, const rg_video_update_t *frame,
     rg_image_t *img = rg_image_copy_resampled(original, width, height, 0);
     rg_image_free(original);
 
-    bool success = img && rg_image_save_to_file(filename, img, 0);
+    bool success = img && rg_image_save_to_file(filename, img, RG_IMAGE_SAVE_FAST);
     rg_image_free(img);
 
     return success;
 }
 
+IRAM_ATTR
+static void optimize_diff(rg_line_diff_t *out_diff, int frame_width, int frame_height)
+{
+    // If filtering is enabled we must adjust our diff blocks to be on appropriate boundaries
+    if (config.filter && config.scaling)
+    {
+        for (int y = 0; y < frame_height; ++y)
+        {
+            if (out_diff[y].width < 1)
+                continue;
+
+            int block_start = y;
+            int block_end = y;
+            int left = out_diff[y].left;
+            int right = left + out_diff[y].width;
+
+            while (block_start > 0 && (out_diff[block_start].width > 0 || !filter_lines[block_start].start))
+                block_start--;
+
+            while (block_end < frame_height - 1 &&
+                   (out_diff[block_end].width > 0 || !filter_lines[block_end].stop))
+                block_end++;
+
+            for (int i = block_start; i <= block_end; i++)
+            {
+                if (out_diff[i].width > 0)
+                {
+                    right = RG_MAX(right, out_diff[i].left + out_diff[i].width);
+                    left = RG_MIN(left, out_diff[i].left);
+                }
+            }
+
+            left = RG_MAX(left - 1, 0);
+            right = RG_MIN(right + 1, frame_width);
+
+            for (int i = block_start; i <= block_end; i++)
+            {
+                out_diff[i].left = left;
+                out_diff[i].width = right - left;
+            }
+
+            y = block_end;
+        }
+    }
+
+    // Combine consecutive lines with similar changes location to optimize the SPI transfer
+    rg_line_diff_t *line = &out_diff[frame_height - 1];
+    rg_line_diff_t *prev_line = line - 1;
+
+    for (; line > out_diff; --line, --prev_line)
+    {
+        int right = line->left + line->width;
+        int right_prev = prev_line->left + prev_line->width;
+
+        if (abs(line->left - prev_line->left) <= 8 && abs(right - right_prev) <= 8)
+        {
+            if (line->left < prev_line->left)
+                prev_line->left = line->left;
+            prev_line->width = RG_MAX(right, right_prev) - prev_line->left;
+            prev_line->repeat = line->repeat + 1;
+        }
+    }
+}
+
+// Converts a diff of the source's rows (as stored in memory) to a diff of the rotated frame's lines.
+// Only the bounding box of the changes is kept, it is what a rotated game typically updates anyway
+// (a scrolling playfield or a few sprites), and it keeps this linear in the number of rows.
+IRAM_ATTR
+static void transpose_diff(rg_line_diff_t *out_diff, const rg_line_diff_t *in_diff, int in_width, int in_height)
+{
+    int row_first = in_height, row_last = -1;
+    int col_first = in_width, col_last = -1;
+
+    for (int r = 0; r < in_height; ++r)
+    {
+        if (in_diff[r].width > 0)
+        {
+            row_first = RG_MIN(row_first, r);
+            row_last = r;
+            col_first = RG_MIN(col_first, in_diff[r].left);
+            col_last = RG_MAX(col_last, in_diff[r].left + in_diff[r].width - 1);
+        }
+    }
+
+    // Source row r becomes column r (LEFT) or (in_height - 1 - r) (RIGHT), source column c
+    // becomes line (in_width - 1 - c) (LEFT) or c (RIGHT).
+    int left = row_first, top = col_first, bottom = col_last;
+    if (display.source.rotation == RG_DISPLAY_ROTATION_LEFT)
+    {
+        top = in_width - 1 - col_last;
+        bottom = in_width - 1 - col_first;
+    }
+    else
+    {
+        left = in_height - 1 - row_last;
+    }
+
+    for (int y = 0; y < in_width; ++y)
+    {
+        bool changed = y >= top && y <= bottom;
+        out_diff[y].left = changed ? left : 0;
+        out_diff[y].width = changed ? row_last - row_first + 1 : 0;
+        out_diff[y].repeat = 1;
+    }
+}
+
 IRAM_ATTR
 rg_update_t rg_display_submit(/*const*/ rg_video_update_t *update, const rg_video_update_t *previousUpdate)
 {
@@ -821,14 +952,16 @@ rg_update_t rg_display_submit(/*const*/ rg_video_update_t *update, const rg_vide
     }
     else // RG_UPDATE_PARTIAL
     {
+        // When rotated we compare the source's rows as they are in memory, the result is transposed below
+        const bool rotated = display.source.rotation != RG_DISPLAY_ROTATION_OFF;
         const uint32_t *frame_buffer = update->buffer + display.source.offset; // uint64_t is 0.7% faster!
         const uint32_t *prev_buffer = previousUpdate->buffer + display.source.offset;
-        const int frame_width = display.source.width;
-        const int frame_height = display.source.height;
+        const int frame_width = rotated ? display.source.height : display.source.width;
+        const int frame_height = rotated ? display.source.width : display.source.height;
         const int stride = display.source.stride;
         const int blocks = (frame_width * display.source.pixlen) / sizeof(*frame_buffer);
         const int pixels_per_block = sizeof(*frame_buffer) / display.source.pixlen;
-        rg_line_diff_t *out_diff = update->diff;
+        rg_line_diff_t *out_diff = rotated ? rotated_diff : update->diff;
 
         // If more than 50% of the screen has changed then stop the comparison and assume that the
         // rest also changed. This is true in 77% of the cases in Pokemon, resulting in a net
@@ -875,70 +1008,138 @@ rg_update_t rg_display_submit(/*const*/ rg_video_update_t *update, const rg_vide
         {
             update->type = RG_UPDATE_FULL;
         }
+        else if (rotated)
+        {
+            update->type = RG_UPDATE_PARTIAL;
+
+            transpose_diff(update->diff, out_diff, frame_width, frame_height);
+            optimize_diff(update->diff, display.source.width, display.source.height);
+        }
         else
         {
             update->type = RG_UPDATE_PARTIAL;
 
-            // If filtering is enabled we must adjust our diff blocks to be on appropriate boundaries
-            if (config.filter && config.scaling)
-            {
-                for (int y = 0; y < frame_height; ++y)
-                {
-                    if (out_diff[y].width < 1)
-                        continue;
+            optimize_diff(out_diff, frame_width, frame_height);
+        }
+    }
 
-                    int block_start = y;
-                    int block_end = y;
-                    int left = out_diff[y].left;
-                    int right = left + out_diff[y].width;
+    xQueueSend(display_task_queue, &update, portMAX_DELAY);
 
-                    while (block_start > 0 && (out_diff[block_start].width > 0 || !filter_lines[block_start].start))
-                        block_start--;
+    counters.busyTime += rg_system_timer() - time_start;
 
-                    while (block_end < frame_height - 1 &&
-                           (out_diff[block_end].width > 0 || !filter_lines[block_end].stop))
-                        block_end++;
+    return update->type;
+}
 
-                    for (int i = block_start; i <= block_end; i++)
-                    {
-                        if (out_diff[i].width > 0)
-                        {
-                            right = RG_MAX(right, out_diff[i].left + out_diff[i].width);
-                            left = RG_MIN(left, out_diff[i].left);
-                        }
-                    }
+IRAM_ATTR
+static void finish_diff(rg_video_update_t *update, int changed)
+{
+    const int frame_width = display.source.width;
+    const int frame_height = display.source.height;
+
+    if (changed == 0)
+    {
+        update->type = RG_UPDATE_EMPTY;
+    }
+    else if (changed >= frame_width * frame_height)
+    {
+        update->type = RG_UPDATE_FULL;
+    }
+    else
+    {
+        update->type = RG_UPDATE_PARTIAL;
+        optimize_diff(update->diff, frame_width, frame_height);
+    }
+}
 
-                    left = RG_MAX(left - 1, 0);
-                    right = RG_MIN(right + 1, frame_width);
+IRAM_ATTR
+rg_update_t rg_display_submit_lines(rg_video_update_t *update, const bool *dirty_lines)
+{
+    const int64_t time_start = rg_system_timer();
+    RG_ASSERT(update, "update is null!");
 
-                    for (int i = block_start; i <= block_end; i++)
-                    {
-                        out_diff[i].left = left;
-                        out_diff[i].width = right - left;
-                    }
+    // Lines and rectangles are in source coordinates, we don't bother transposing them when rotated
+    if (!dirty_lines || display.changed || display.source.rotation || config.update_mode == RG_DISPLAY_UPDATE_FULL)
+    {
+        update->type = RG_UPDATE_FULL;
+    }
+    else
+    {
+        // The emulator already knows exactly which lines it touched, so we skip the buffer compare
+        // entirely. dirty_lines is indexed by source line, before vertical cropping.
+        const bool *dirty = dirty_lines + display.source.crop_v;
+        const int frame_width = display.source.width;
+        const int frame_height = display.source.height;
+        rg_line_diff_t *out_diff = update->diff;
+        int changed = 0;
 
-                    y = block_end;
-                }
-            }
+        for (int y = 0; y < frame_height; ++y)
+        {
+            out_diff[y].left = 0;
+            out_diff[y].width = dirty[y] ? frame_width : 0;
+            out_diff[y].repeat = 1;
+            changed += out_diff[y].width;
+        }
 
-            // Combine consecutive lines with similar changes location to optimize the SPI transfer
-            rg_line_diff_t *line = &out_diff[frame_height - 1];
-            rg_line_diff_t *prev_line = line - 1;
+        finish_diff(update, changed);
+    }
 
-            for (; line > out_diff; --line, --prev_line)
-            {
-                int right = line->left + line->width;
-                int right_prev = prev_line->left + prev_line->width;
+    xQueueSend(display_task_queue, &update, portMAX_DELAY);
+
+    counters.busyTime += rg_system_timer() - time_start;
+
+    return update->type;
+}
+
+IRAM_ATTR
+rg_update_t rg_display_submit_rects(rg_video_update_t *update, const rg_display_rect_t *rects, size_t count)
+{
+    const int64_t time_start = rg_system_timer();
+    RG_ASSERT(update, "update is null!");
 
-                if (abs(line->left - prev_line->left) <= 8 && abs(right - right_prev) <= 8)
+    if (!rects || display.changed || display.source.rotation || config.update_mode == RG_DISPLAY_UPDATE_FULL)
+    {
+        update->type = RG_UPDATE_FULL;
+    }
+    else
+    {
+        // Rectangles are in source coordinates, before cropping. Each line gets the horizontal
+        // span covering every rectangle crossing it.
+        const int frame_width = display.source.width;
+        const int frame_height = display.source.height;
+        rg_line_diff_t *out_diff = update->diff;
+        int changed = 0;
+
+        for (int y = 0; y < frame_height; ++y)
+            out_diff[y] = (rg_line_diff_t){0, 0, 1};
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            int left = RG_MAX(rects[i].left - display.source.crop_h, 0);
+            int right = RG_MIN(rects[i].left + rects[i].width - display.source.crop_h, frame_width);
+            int top = RG_MAX(rects[i].top - display.source.crop_v, 0);
+            int bottom = RG_MIN(rects[i].top + rects[i].height - display.source.crop_v, frame_height);
+
+            for (int y = top; y < bottom && left < right; ++y)
+            {
+                rg_line_diff_t *line = &out_diff[y];
+                if (line->width > 0)
+                {
+                    int line_right = RG_MAX(line->left + line->width, right);
+                    line->left = RG_MIN(line->left, left);
+                    line->width = line_right - line->left;
+                }
+                else
                 {
-                    if (line->left < prev_line->left)
-                        prev_line->left = line->left;
-                    prev_line->width = RG_MAX(right, right_prev) - prev_line->left;
-                    prev_line->repeat = line->repeat + 1;
+                    line->left = left;
+                    line->width = right - left;
                 }
             }
         }
+
+        for (int y = 0; y < frame_height; ++y)
+            changed += out_diff[y].width;
+
+        finish_diff(update, changed);
     }
 
     xQueueSend(display_task_queue, &update, portMAX_DELAY);
@@ -948,26 +1149,72 @@ rg_update_t rg_display_submit(/*const*/ rg_video_update_t *update, const rg_vide
     return update->type;
 }
 
-void rg_display_set_source_format(int width, int height, int crop_h, int crop_v, int stride, int format)
+static void update_source_format(void)
 {
-    rg_display_sync();
+    int width = source_format.width;
+    int height = source_format.height;
+    int stride = source_format.stride;
+    int format = source_format.format;
 
     if (width % sizeof(int)) // frame diff doesn't handle non word multiple well right now...
     {
         RG_LOGW("Horizontal resolution (%d) isn't a word size multiple!\n", width);
         width -= width % sizeof(int);
     }
-    display.source.crop_h = RG_MAX(RG_MAX(0, width - display.screen.width) / 2, crop_h);
-    display.source.crop_v = RG_MAX(RG_MAX(0, height - display.screen.height) / 2, crop_v);
-    display.source.width = width - display.source.crop_h * 2;
-    display.source.height = height - display.source.crop_v * 2;
     display.source.format = format;
     display.source.stride = stride;
     display.source.pixlen = format & RG_PIXEL_PAL ? 1 : 2;
-    display.source.offset = (display.source.crop_v * stride) + (display.source.crop_h * display.source.pixlen);
+
+    if (display.source.rotation != RG_DISPLAY_ROTATION_OFF)
+    {
+        // The source's rows become screen columns. Cropping isn't supported in that mode,
+        // the scaler will simply fit the rotated frame.
+        display.source.crop_h = 0;
+        display.source.crop_v = 0;
+        display.source.width = height;
+        display.source.height = width;
+        display.source.offset = 0;
+    }
+    else
+    {
+        display.source.crop_h = RG_MAX(RG_MAX(0, width - display.screen.width) / 2, source_format.crop_h);
+        display.source.crop_v = RG_MAX(RG_MAX(0, height - display.screen.height) / 2, source_format.crop_v);
+        display.source.width = width - display.source.crop_h * 2;
+        display.source.height = height - display.source.crop_v * 2;
+        display.source.offset = (display.source.crop_v * stride) + (display.source.crop_h * display.source.pixlen);
+    }
     display.changed = true;
 }
 
+void rg_display_set_source_format(int width, int height, int crop_h, int crop_v, int stride, int format)
+{
+    rg_display_sync();
+
+    source_format.width = width;
+    source_format.height = height;
+    source_format.crop_h = crop_h;
+    source_format.crop_v = crop_v;
+    source_format.stride = stride;
+    source_format.format = format;
+    update_source_format();
+}
+
+void rg_display_set_source_rotation(display_rotation_t rotation)
+{
+    rg_display_sync();
+
+    if (rotation != RG_DISPLAY_ROTATION_LEFT && rotation != RG_DISPLAY_ROTATION_RIGHT)
+        rotation = RG_DISPLAY_ROTATION_OFF;
+    // The partial update diff is transposed into update->diff, one entry per source column
+    if (rotation != RG_DISPLAY_ROTATION_OFF && source_format.width > (int)RG_COUNT(((rg_video_update_t *)0)->diff))
+    {
+        RG_LOGE("Source is too wide (%d) to be rotated!\n", source_format.width);
+        rotation = RG_DISPLAY_ROTATION_OFF;
+    }
+    display.source.rotation = rotation;
+    update_source_format();
+}
+
 bool rg_display_is_busy(void)
 {
     return uxQueueMessagesWaiting(spi_transactions) < SPI_TRANSACTION_COUNT
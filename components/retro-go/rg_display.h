@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 typedef enum
@@ -75,7 +76,8 @@ typedef struct
 {
     int32_t totalFrames;
     int32_t fullFrames;
-    int64_t busyTime; // This is only time spent blocking the main task
+    int64_t busyTime;   // This is only time spent blocking the main task
+    int64_t renderTime; // Time spent building the LCD lines in the display task
 } rg_display_counters_t;
 
 typedef struct
@@ -105,6 +107,7 @@ typedef struct
         int crop_h;
         int crop_v;
         int format;
+        int rotation; // RG_DISPLAY_ROTATION_LEFT/RIGHT: width and height above are after rotation
     } source;
     bool changed;
 } rg_display_t;
@@ -116,6 +119,14 @@ typedef struct
     short repeat; // int32_t repeat:10;
 } rg_line_diff_t;
 
+typedef struct
+{
+    short left;
+    short top;
+    short width;
+    short height;
+} rg_display_rect_t;
+
 typedef struct
 {
     rg_update_t type;
@@ -134,8 +145,11 @@ bool rg_display_is_busy(void);
 void rg_display_force_redraw(void);
 bool rg_display_save_frame(const char *filename, const rg_video_update_t *frame, int width, int height);
 void rg_display_set_source_format(int width, int height, int crop_h, int crop_v, int stride, int format);
+void rg_display_set_source_rotation(display_rotation_t rotation);
 
 rg_update_t rg_display_submit(/*const*/ rg_video_update_t *update, const rg_video_update_t *previousUpdate);
+rg_update_t rg_display_submit_lines(rg_video_update_t *update, const bool *dirty_lines);
+rg_update_t rg_display_submit_rects(rg_video_update_t *update, const rg_display_rect_t *rects, size_t count);
 #define rg_display_queue_update rg_display_submit
 
 rg_display_counters_t rg_display_get_counters(void);
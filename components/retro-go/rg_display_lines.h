@@ -0,0 +1,150 @@
+#pragma once
+
+// Line renderers of rg_display.c, kept apart so that tests/display_lines.c can check them on the host.
+// Only rg_display.c should include this file.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "rg_display.h"
+
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+static uint16_t line_cache[320]; // Source line converted to the LCD format, see the line fetchers
+static int line_screen_width, line_x_inc; // Horizontal scaling, as in display.screen and display.viewport
+static enum
+{
+    SCALE_ANY = 0,
+    SCALE_1X,
+    SCALE_5_4, // 256 => 320
+    SCALE_3_2, // 160 => 240
+    SCALE_2X,  // 160 => 320
+} scale_kernel; // Exact horizontal ratio, selected by select_line_renderers
+
+// Line renderers are split in two steps, both specialized and selected once by select_line_renderers:
+// - A fetcher converts width source pixels (every x_step bytes) to the LCD format (565 big endian).
+// - A scaler stretches the fetched line to the viewport. The exact ratios have unrolled kernels, they
+//   step pixel by pixel until the start of their period (x_acc == 0) and handle the tail the same way.
+typedef const uint16_t *(*line_fetcher_t)(const uint8_t *src, int x_step, int width, const uint16_t *palette);
+typedef uint16_t *(*line_scaler_t)(uint16_t *dst, const uint16_t *src, int width, int x_acc);
+
+#define DEFINE_LINE_FETCHER(name, pixel) \
+    IRAM_ATTR static const uint16_t *name(const uint8_t *src, int x_step, int width, const uint16_t *palette) \
+    { \
+        for (int x = 0; x < width; ++x) \
+            line_cache[x] = (pixel); \
+        return line_cache; \
+    }
+
+#define SRC_U16(x) (*(const uint16_t *)(src + (x) * x_step))
+#define SWAP_U16(v) (((v) << 8) | ((v) >> 8))
+DEFINE_LINE_FETCHER(fetch_pal, palette[src[x]])
+DEFINE_LINE_FETCHER(fetch_pal_rotated, palette[src[x * x_step]])
+DEFINE_LINE_FETCHER(fetch_565_le, SWAP_U16(((const uint16_t *)src)[x]))
+DEFINE_LINE_FETCHER(fetch_565_le_rotated, SWAP_U16(SRC_U16(x)))
+DEFINE_LINE_FETCHER(fetch_565_be_rotated, SRC_U16(x))
+#undef SRC_U16
+#undef SWAP_U16
+
+// The source is already in the LCD format, the scaler reads it in place
+IRAM_ATTR
+static const uint16_t *fetch_565_be(const uint8_t *src, int x_step, int width, const uint16_t *palette)
+{
+    return (const uint16_t *)src;
+}
+
+#define DEFINE_LINE_SCALER(name, period_src, kernel) \
+    IRAM_ATTR static uint16_t *name(uint16_t *dst, const uint16_t *src, int width, int x_acc) \
+    { \
+        const int screen_width = line_screen_width; \
+        const int x_inc = line_x_inc; \
+        int x = 0; \
+        while (x < width && x_acc != 0) \
+            SCALE_STEP(); \
+        for (; x + (period_src) <= width; x += (period_src)) \
+            kernel \
+        while (x < width) \
+            SCALE_STEP(); \
+        return dst; \
+    }
+
+#define SCALE_STEP() { \
+        *dst++ = src[x]; \
+        x_acc += x_inc; \
+        while (x_acc >= screen_width) { \
+            x_acc -= screen_width; \
+            ++x; \
+        } \
+    }
+DEFINE_LINE_SCALER(scale_5_4, 4, {
+    dst[0] = dst[1] = src[x];
+    dst[2] = src[x + 1];
+    dst[3] = src[x + 2];
+    dst[4] = src[x + 3];
+    dst += 5;
+})
+DEFINE_LINE_SCALER(scale_3_2, 2, {
+    dst[0] = dst[1] = src[x];
+    dst[2] = src[x + 1];
+    dst += 3;
+})
+DEFINE_LINE_SCALER(scale_2x, 1, {
+    dst[0] = dst[1] = src[x];
+    dst += 2;
+})
+
+IRAM_ATTR
+static uint16_t *scale_any(uint16_t *dst, const uint16_t *src, int width, int x_acc)
+{
+    const int screen_width = line_screen_width;
+    const int x_inc = line_x_inc;
+    for (int x = 0; x < width;)
+        SCALE_STEP();
+    return dst;
+}
+#undef SCALE_STEP
+
+IRAM_ATTR
+static uint16_t *scale_1x(uint16_t *dst, const uint16_t *src, int width, int x_acc)
+{
+    memcpy(dst, src, width * 2);
+    return dst + width;
+}
+
+static const line_scaler_t line_scalers[] = {
+    [SCALE_ANY] = scale_any,
+    [SCALE_1X] = scale_1x,
+    [SCALE_5_4] = scale_5_4,
+    [SCALE_3_2] = scale_3_2,
+    [SCALE_2X] = scale_2x,
+};
+static line_fetcher_t line_fetcher = fetch_565_be;
+static line_scaler_t line_scaler = scale_any;
+
+static void select_line_renderers(int format, bool rotated, int x_inc, int screen_width)
+{
+    line_screen_width = screen_width;
+    line_x_inc = x_inc;
+
+    if (x_inc == screen_width)
+        scale_kernel = SCALE_1X;
+    else if (x_inc * 5 == screen_width * 4)
+        scale_kernel = SCALE_5_4;
+    else if (x_inc * 3 == screen_width * 2)
+        scale_kernel = SCALE_3_2;
+    else if (x_inc * 2 == screen_width)
+        scale_kernel = SCALE_2X;
+    else
+        scale_kernel = SCALE_ANY;
+
+    if (format & RG_PIXEL_PAL)
+        line_fetcher = rotated ? fetch_pal_rotated : fetch_pal;
+    else if (format & RG_PIXEL_LE)
+        line_fetcher = rotated ? fetch_565_le_rotated : fetch_565_le;
+    else
+        line_fetcher = rotated ? fetch_565_be_rotated : fetch_565_be;
+    line_scaler = line_scalers[scale_kernel];
+}
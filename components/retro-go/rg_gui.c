@@ -15,6 +15,9 @@ static struct
 {
     uint16_t *screen_buffer, *draw_buffer;
     int screen_width, screen_height;
+    struct {short left, right;} *dirty_lines; // Changed span of each line of screen_buffer
+    struct {int left, top, right, bottom;} clip;
+    rg_gui_counters_t counters;
     struct
     {
         const rg_font_t *font;
@@ -31,6 +34,24 @@ static struct
     bool initialized;
 } gui;
 
+#define GLYPH_CACHE_SIZE 64
+
+typedef struct
+{
+    uint16_t rows[24];  // Rendered at the current point size, bit x is pixel x
+    uint32_t last_used;
+    uint8_t chr;
+} glyph_t;
+
+static struct
+{
+    uint16_t offsets[256]; // Position of each glyph in the current font's data, 0xFFFF if missing
+    uint8_t widths[256];
+    int8_t slots[256];     // Cache slot of each character, -1 if it isn't cached
+    glyph_t cache[GLYPH_CACHE_SIZE];
+    uint32_t clock;
+} glyphs;
+
 static const char *SETTING_FONTTYPE  = "FontType";
 static const char *SETTING_THEME     = "Theme";
 
@@ -40,6 +61,7 @@ void rg_gui_init(void)
     gui.screen_width = rg_display_get_info()->screen.width;
     gui.screen_height = rg_display_get_info()->screen.height;
     gui.draw_buffer = rg_alloc(RG_MAX(gui.screen_width, gui.screen_height) * 20 * 2, MEM_SLOW);
+    rg_gui_set_clip(0, 0, 0, 0);
     rg_gui_set_font_type(rg_settings_get_number(NS_GLOBAL, SETTING_FONTTYPE, RG_FONT_VERA_12));
     rg_gui_set_theme(rg_settings_get_string(NS_GLOBAL, SETTING_THEME, NULL));
     gui.initialized = true;
@@ -103,18 +125,112 @@ const char *rg_gui_get_theme(void)
     return strlen(gui.theme) ? gui.theme : NULL;
 }
 
+static void mark_dirty(int left, int top, int right, int bottom)
+{
+    if (!gui.dirty_lines)
+        return;
+
+    left = RG_MAX(left, 0);
+    top = RG_MAX(top, 0);
+    right = RG_MIN(right, gui.screen_width);
+    bottom = RG_MIN(bottom, gui.screen_height);
+
+    for (int y = top; y < bottom && left < right; ++y)
+    {
+        if (gui.dirty_lines[y].right > gui.dirty_lines[y].left)
+        {
+            gui.dirty_lines[y].left = RG_MIN(gui.dirty_lines[y].left, left);
+            gui.dirty_lines[y].right = RG_MAX(gui.dirty_lines[y].right, right);
+        }
+        else
+        {
+            gui.dirty_lines[y].left = left;
+            gui.dirty_lines[y].right = right;
+        }
+    }
+}
+
 void rg_gui_set_buffered(bool buffered)
 {
     if (!buffered)
+    {
         free(gui.screen_buffer), gui.screen_buffer = NULL;
+        free(gui.dirty_lines), gui.dirty_lines = NULL;
+    }
     else if (!gui.screen_buffer)
+    {
         gui.screen_buffer = rg_alloc(gui.screen_width * gui.screen_height * 2, MEM_SLOW);
+        gui.dirty_lines = calloc(gui.screen_height, sizeof(*gui.dirty_lines));
+        // We don't know what's on the screen yet
+        mark_dirty(0, 0, gui.screen_width, gui.screen_height);
+    }
+}
+
+void rg_gui_set_clip(int left, int top, int width, int height)
+{
+    if (width <= 0 || height <= 0)
+    {
+        gui.clip.left = gui.clip.top = 0;
+        gui.clip.right = gui.screen_width;
+        gui.clip.bottom = gui.screen_height;
+    }
+    else
+    {
+        gui.clip.left = RG_MAX(left, 0);
+        gui.clip.top = RG_MAX(top, 0);
+        gui.clip.right = RG_MIN(left + width, gui.screen_width);
+        gui.clip.bottom = RG_MIN(top + height, gui.screen_height);
+    }
 }
 
 void rg_gui_flush(void)
 {
-    if (gui.screen_buffer)
-        rg_display_write(0, 0, gui.screen_width, gui.screen_height, 0, gui.screen_buffer);
+    if (!gui.screen_buffer)
+        return;
+
+    int64_t time_start = rg_system_timer();
+    int pixels = 0;
+
+    // Only send the lines that changed since the last flush, grouping consecutive lines
+    // with a similar span into a single transfer
+    for (int y = 0; y < gui.screen_height;)
+    {
+        int left = gui.dirty_lines[y].left;
+        int right = gui.dirty_lines[y].right;
+        int top = y;
+
+        if (right <= left)
+        {
+            y++;
+            continue;
+        }
+
+        while (++y < gui.screen_height && gui.dirty_lines[y].right > gui.dirty_lines[y].left
+               && abs(gui.dirty_lines[y].left - left) <= 8 && abs(gui.dirty_lines[y].right - right) <= 8)
+        {
+            left = RG_MIN(left, gui.dirty_lines[y].left);
+            right = RG_MAX(right, gui.dirty_lines[y].right);
+        }
+
+        rg_display_write(left, top, right - left, y - top, gui.screen_width * 2,
+                         gui.screen_buffer + top * gui.screen_width + left);
+        pixels += (right - left) * (y - top);
+
+        for (int i = top; i < y; ++i)
+            gui.dirty_lines[i].left = gui.dirty_lines[i].right = 0;
+    }
+
+    if (pixels > 0)
+    {
+        gui.counters.flushes++;
+        gui.counters.pixels += pixels;
+    }
+    gui.counters.busyTime += rg_system_timer() - time_start;
+}
+
+rg_gui_counters_t rg_gui_get_counters(void)
+{
+    return gui.counters;
 }
 
 void rg_gui_copy_buffer(int left, int top, int width, int height, int stride, const void *buffer)
@@ -125,16 +241,30 @@ void rg_gui_copy_buffer(int left, int top, int width, int height, int stride, co
         if (top < 0) top += gui.screen_height;
         if (stride < width) stride = width * 2;
 
-        width = RG_MIN(width, gui.screen_width - left);
-        height = RG_MIN(height, gui.screen_height - top);
+        int x_start = RG_MAX(left, gui.clip.left);
+        int y_start = RG_MAX(top, gui.clip.top);
+        int x_end = RG_MIN(left + width, gui.clip.right);
+        int y_end = RG_MIN(top + height, gui.clip.bottom);
+
+        gui.counters.draws++;
 
-        for (int y = 0; y < height; ++y)
+        for (int y = y_start; y < y_end; ++y)
         {
-            uint16_t *dst = gui.screen_buffer + (top + y) * gui.screen_width + left;
-            const uint16_t *src = (void*)buffer + y * stride;
-            for (int x = 0; x < width; ++x)
-                if (src[x] != C_TRANSPARENT)
-                    dst[x] = src[x];
+            uint16_t *dst = gui.screen_buffer + y * gui.screen_width;
+            const uint16_t *src = (void*)buffer + (y - top) * stride;
+            int changed_left = x_end, changed_right = x_start;
+            for (int x = x_start; x < x_end; ++x)
+            {
+                uint16_t pixel = src[x - left];
+                if (pixel != C_TRANSPARENT && dst[x] != pixel)
+                {
+                    dst[x] = pixel;
+                    changed_left = RG_MIN(changed_left, x);
+                    changed_right = x + 1;
+                }
+            }
+            if (changed_right > changed_left)
+                mark_dirty(changed_left, y, changed_right, y + 1);
         }
     }
     else
@@ -143,71 +273,128 @@ void rg_gui_copy_buffer(int left, int top, int width, int height, int stride, co
     }
 }
 
-static size_t get_glyph(uint16_t *output, const rg_font_t *font, int points, uint8_t c)
+static void build_glyph_index(const rg_font_t *font)
 {
-    size_t glyph_width = 8;
+    // Unknown characters are blank and 8 pixels wide, line breaks have no width
+    memset(glyphs.offsets, 0xFF, sizeof(glyphs.offsets));
+    memset(glyphs.widths, 8, sizeof(glyphs.widths));
 
-    // Some glyphs are always zero width
-    if (c == '\r' || c == '\n')
-        return 0;
+    if (font->type == 0) // Bitmap
+    {
+        for (int c = 0; c < 256; c++)
+        {
+            glyphs.widths[c] = font->width;
+            if (c < font->chars)
+                glyphs.offsets[c] = c * font->height;
+        }
+    }
+    else // Proportional
+    {
+        // Each glyph: charCode, adjYOffset, width, height, xOffset, xDelta, data[(width * height + 7) / 8]
+        const uint8_t *data = font->data;
+        while (data[0] != 0xFF)
+        {
+            int charCode = data[0], width = data[2], height = data[3], xDelta = data[5];
+            glyphs.offsets[charCode] = data - font->data;
+            glyphs.widths[charCode] = (width > xDelta) ? width : xDelta;
+            data += 6 + (width ? (((width * height) - 1) / 8) + 1 : 0);
+        }
+    }
+
+    glyphs.widths['\r'] = glyphs.widths['\n'] = 0;
+}
+
+static void render_glyph(glyph_t *glyph, const rg_font_t *font, int points, uint8_t c)
+{
+    uint16_t *output = glyph->rows;
+
+    memset(output, 0, sizeof(glyph->rows));
+
+    if (glyphs.offsets[c] == 0xFFFF)
+        return;
+
+    const uint8_t *data = font->data + glyphs.offsets[c];
 
     if (font->type == 0) // Bitmap
     {
-        if (output && c < font->chars)
-            for (int y = 0; y < font->height; y++)
-                output[y] = font->data[(c * font->height) + y];
-        glyph_width = font->width;
+        for (int y = 0; y < font->height; y++)
+            output[y] = data[y];
     }
     else // Proportional
     {
         // Based on code by Boris Lovosevic (https://github.com/loboris)
-        int charCode, adjYOffset, width, height, xOffset, xDelta;
-        const uint8_t *data = font->data;
-        do {
-            charCode = *data++;
-            adjYOffset = *data++;
-            width = *data++;
-            height = *data++;
-            xOffset = *data++;
-            xOffset = xOffset < 0x80 ? xOffset : -(0xFF - xOffset);
-            xDelta = *data++;
-
-            if (c != charCode && charCode != 0xFF && width != 0) {
-                data += (((width * height) - 1) / 8) + 1;
-            }
-        } while ((c != charCode) && (charCode != 0xFF));
+        int adjYOffset = data[1], width = data[2], height = data[3];
+        int xOffset = data[4] < 0x80 ? data[4] : -(0xFF - data[4]);
+        uint32_t bits = 0;
+        int count = 0;
+
+        data += 6;
 
-        if (c == charCode)
+        for (int y = 0; y < height; y++)
         {
-            glyph_width = ((width > xDelta) ? width : xDelta);
-            if (output)
+            uint16_t row = 0;
+            for (int x = 0; x < width; x++)
             {
-                int ch = 0, mask = 0x80;
-                for (int y = 0; y < height; y++) {
-                    output[adjYOffset + y] = 0;
-                    for (int x = 0; x < width; x++) {
-                        if (((x + (y * width)) % 8) == 0) {
-                            mask = 0x80;
-                            ch = *data++;
-                        }
-                        if ((ch & mask) != 0)
-                            output[adjYOffset + y] |= (1 << (xOffset + x));
-                        mask >>= 1;
-                    }
+                if (count == 0)
+                {
+                    bits = *data++;
+                    count = 8;
                 }
+                if (bits & 0x80)
+                    row |= (1 << (xOffset + x));
+                bits <<= 1;
+                count--;
             }
+            output[adjYOffset + y] = row;
         }
     }
 
     // Vertical stretching
-    if (output && points && points != font->height)
+    if (points && points != font->height)
     {
-        float scale = (float)points / font->height;
         for (int y = points - 1; y >= 0; y--)
-            output[y] = output[(int)(y / scale)];
+            output[y] = output[y * font->height / points];
     }
+}
+
+static const glyph_t *get_glyph(uint8_t c)
+{
+    int slot = glyphs.slots[c];
 
-    return glyph_width;
+    if (slot < 0)
+    {
+        // Evict the least recently used glyph
+        slot = 0;
+        for (int i = 1; i < GLYPH_CACHE_SIZE; i++)
+        {
+            if (glyphs.cache[i].last_used < glyphs.cache[slot].last_used)
+                slot = i;
+        }
+        if (glyphs.cache[slot].last_used)
+            glyphs.slots[glyphs.cache[slot].chr] = -1;
+        render_glyph(&glyphs.cache[slot], gui.style.font, gui.style.font_points, c);
+        glyphs.cache[slot].chr = c;
+        glyphs.slots[c] = slot;
+        gui.counters.glyphMisses++;
+    }
+
+    glyphs.cache[slot].last_used = ++glyphs.clock;
+    return &glyphs.cache[slot];
+}
+
+static inline void fill_run(uint16_t *dst, uint16_t color, int count)
+{
+    if (count > 0 && ((uintptr_t)dst & 2))
+    {
+        *dst++ = color;
+        count--;
+    }
+    uint32_t *dst32 = (uint32_t *)dst;
+    uint32_t color32 = (color << 16) | color;
+    for (int i = count >> 1; i > 0; i--)
+        *dst32++ = color32;
+    if (count & 1)
+        *(uint16_t *)dst32 = color;
 }
 
 bool rg_gui_set_font_type(int type)
@@ -224,6 +411,12 @@ bool rg_gui_set_font_type(int type)
     gui.style.font_type = type;
     gui.style.font_points = (type < 3) ? (8 + type * 4) : font->height;
 
+    // Both depend on the font and the point size
+    build_glyph_index(font);
+    memset(glyphs.slots, -1, sizeof(glyphs.slots));
+    memset(glyphs.cache, 0, sizeof(glyphs.cache));
+    glyphs.clock = 0;
+
     rg_settings_set_number(NS_GLOBAL, SETTING_FONTTYPE, type);
 
     RG_LOGI("Font set to: points=%d, scaling=%.2f\n",
@@ -245,7 +438,6 @@ rg_rect_t rg_gui_draw_text(int x_pos, int y_pos, int width, const char *text,
     int padding = (flags & RG_TEXT_NO_PADDING) ? 0 : 1;
     int font_height = gui.style.font_points;
     int line_height = font_height + padding * 2;
-    const rg_font_t *font = gui.style.font;
 
     if (width == 0)
     {
@@ -253,8 +445,8 @@ rg_rect_t rg_gui_draw_text(int x_pos, int y_pos, int width, const char *text,
         int line_width = padding * 2;
         for (const char *ptr = text; *ptr; )
         {
-            int chr = *ptr++;
-            line_width += get_glyph(0, font, font_height, chr);
+            uint8_t chr = *ptr++;
+            line_width += glyphs.widths[chr];
 
             if (chr == '\n' || *ptr == 0)
             {
@@ -279,8 +471,7 @@ rg_rect_t rg_gui_draw_text(int x_pos, int y_pos, int width, const char *text,
     {
         int x_offset = padding;
 
-        for (size_t p = draw_width * line_height; p--; )
-            gui.draw_buffer[p] = color_bg;
+        fill_run(gui.draw_buffer, color_bg, draw_width * line_height);
 
         if (flags & (RG_TEXT_ALIGN_LEFT|RG_TEXT_ALIGN_CENTER))
         {
@@ -288,7 +479,7 @@ rg_rect_t rg_gui_draw_text(int x_pos, int y_pos, int width, const char *text,
             const char *line = ptr;
             while (x_offset < draw_width && *line && *line != '\n')
             {
-                int width = get_glyph(0, font, font_height, *line++);
+                int width = glyphs.widths[(uint8_t)*line++];
                 if (draw_width - x_offset < width) // Do not truncate glyphs
                     break;
                 x_offset += width;
@@ -301,8 +492,8 @@ rg_rect_t rg_gui_draw_text(int x_pos, int y_pos, int width, const char *text,
 
         while (x_offset < draw_width)
         {
-            uint16_t bitmap[24] = {0};
-            int width = get_glyph(bitmap, font, font_height, *ptr++);
+            uint8_t chr = *ptr++;
+            int width = glyphs.widths[chr];
 
             if (draw_width - x_offset < width) // Do not truncate glyphs
             {
@@ -311,13 +502,22 @@ rg_rect_t rg_gui_draw_text(int x_pos, int y_pos, int width, const char *text,
                 break;
             }
 
-            if (!(flags & RG_TEXT_DUMMY_DRAW))
+            if (!(flags & RG_TEXT_DUMMY_DRAW) && width > 0)
             {
+                // The background is already filled, only the runs of foreground pixels are drawn
+                const glyph_t *glyph = get_glyph(chr);
+                uint32_t mask = (1 << width) - 1;
                 for (int y = 0; y < font_height; y++)
                 {
                     uint16_t *output = &gui.draw_buffer[(draw_width * (y + padding)) + x_offset];
-                    for (int x = 0; x < width; x++)
-                        output[x] = (bitmap[y] & (1 << x)) ? color_fg : color_bg;
+                    uint32_t bits = glyph->rows[y] & mask;
+                    while (bits)
+                    {
+                        int start = __builtin_ctz(bits);
+                        int length = __builtin_ctz(~(bits >> start));
+                        fill_run(output + start, color_fg, length);
+                        bits &= ~(((1 << length) - 1) << start);
+                    }
                 }
             }
 
@@ -470,12 +670,19 @@ void rg_gui_draw_clock(int x_pos, int y_pos)
 
 void rg_gui_draw_hourglass(void)
 {
-    rg_display_write((gui.screen_width / 2) - (image_hourglass.width / 2),
-        (gui.screen_height / 2) - (image_hourglass.height / 2),
+    int left = (gui.screen_width / 2) - (image_hourglass.width / 2);
+    int top = (gui.screen_height / 2) - (image_hourglass.height / 2);
+
+    rg_display_write(left,
+        top,
         image_hourglass.width,
         image_hourglass.height,
         image_hourglass.width * 2,
         (uint16_t*)image_hourglass.pixel_data);
+
+    // It bypasses the screen buffer, the next flush must restore what was under it
+    gui.counters.draws++;
+    mark_dirty(left, top, left + image_hourglass.width, top + image_hourglass.height);
 }
 
 void rg_gui_clear(rg_color_t color)
@@ -485,6 +692,8 @@ void rg_gui_clear(rg_color_t color)
         size_t pixels = gui.screen_width * gui.screen_height;
         while (pixels > 0)
             gui.screen_buffer[--pixels] = color;
+        gui.counters.draws++;
+        mark_dirty(0, 0, gui.screen_width, gui.screen_height);
     }
     else
         rg_display_clear(color);
@@ -1014,6 +1223,24 @@ static rg_gui_event_t speedup_update_cb(rg_gui_option_t *option, rg_gui_event_t
     return RG_DIALOG_VOID;
 }
 
+static rg_gui_event_t run_ahead_update_cb(rg_gui_option_t *option, rg_gui_event_t event)
+{
+    int max = RG_RUN_AHEAD_MAX_FRAMES;
+    int frames = rg_emu_get_run_ahead();
+    int prev_frames = frames;
+
+    if (event == RG_DIALOG_PREV && --frames < 0) frames = max;
+    if (event == RG_DIALOG_NEXT && ++frames > max) frames = 0;
+
+    if (frames != prev_frames)
+        rg_emu_set_run_ahead(frames);
+
+    if (frames == 0) strcpy(option->value, "Off");
+    else sprintf(option->value, "%d  ", frames);
+
+    return RG_DIALOG_VOID;
+}
+
 static rg_gui_event_t disk_activity_cb(rg_gui_option_t *option, rg_gui_event_t event)
 {
     if (event == RG_DIALOG_PREV || event == RG_DIALOG_NEXT) {
@@ -1076,6 +1303,8 @@ void rg_gui_options_menu(void)
         *opt++ = (rg_gui_option_t){0, "Filter", "None", 1, &filter_update_cb};
         *opt++ = (rg_gui_option_t){0, "Update", "Partial", 1, &update_mode_update_cb};
         *opt++ = (rg_gui_option_t){0, "Speed", "1x", 1, &speedup_update_cb};
+        if (app->handlers.saveSnapshot && app->handlers.loadSnapshot)
+            *opt++ = (rg_gui_option_t){0, "Run-ahead", "Off", 1, &run_ahead_update_cb};
     }
 
     size_t extra_options = get_dialog_items_count(app->options);
@@ -1169,7 +1398,7 @@ void rg_gui_debug_menu(const rg_gui_option_t *extra_options)
 {
     char screen_res[20], source_res[20], scaled_res[20];
     char stack_hwm[20], heap_free[20], block_free[20];
-    char local_time[32], timezone[32], uptime[20];
+    char local_time[32], timezone[32], uptime[20], run_ahead[20];
 
     const rg_gui_option_t options[] = {
         {0, "Screen Res", screen_res, 1, NULL},
@@ -1181,6 +1410,7 @@ void rg_gui_debug_menu(const rg_gui_option_t *extra_options)
         {0, "Local time", local_time, 1, NULL},
         {0, "Timezone  ", timezone, 1, NULL},
         {0, "Uptime    ", uptime, 1, NULL},
+        {0, "Run-ahead ", run_ahead, 1, NULL},
         RG_DIALOG_SEPARATOR,
         {1000, "Save screenshot", NULL, 1, NULL},
         {2000, "Save trace", NULL, 1, NULL},
@@ -1202,6 +1432,7 @@ void rg_gui_debug_menu(const rg_gui_option_t *extra_options)
     snprintf(heap_free, 20, "%d+%d", stats.freeMemoryInt, stats.freeMemoryExt);
     snprintf(block_free, 20, "%d+%d", stats.freeBlockInt, stats.freeBlockExt);
     snprintf(uptime, 20, "%ds", (int)(rg_system_timer() / 1000000));
+    snprintf(run_ahead, 20, "%d (%.1f%%)", rg_emu_get_run_ahead(), stats.runAheadPercent);
 
     switch (rg_gui_dialog("Debugging", options, 0))
     {
@@ -52,6 +52,15 @@ typedef struct
     uint16_t height;
 } rg_rect_t;
 
+typedef struct
+{
+    uint32_t draws;       // Drawing operations into the screen buffer (to detect foreign drawing)
+    uint32_t flushes;     // rg_gui_flush() calls that sent something
+    uint32_t pixels;      // Pixels sent by rg_gui_flush()
+    int64_t busyTime;     // Time spent in rg_gui_flush()
+    uint32_t glyphMisses; // Glyphs rendered because they weren't in the cache
+} rg_gui_counters_t;
+
 typedef struct rg_gui_option_s rg_gui_option_t;
 typedef rg_gui_event_t (*rg_gui_callback_t)(rg_gui_option_t *, rg_gui_event_t);
 
@@ -76,9 +85,11 @@ struct rg_gui_option_s
 #define TEXT_RECT(text, max) rg_gui_draw_text(-(max), 0, 0, (text), 0, 0, RG_TEXT_MULTILINE|RG_TEXT_DUMMY_DRAW)
 
 void rg_gui_init(void);
-void rg_gui_flush(void); // no effect if buffered = false
+void rg_gui_flush(void); // no effect if buffered = false, only sends what changed since the last flush
 void rg_gui_clear(rg_color_t color); // like rg_display_clear but takes gui screen buffering into account
 void rg_gui_set_buffered(bool buffered);
+void rg_gui_set_clip(int left, int top, int width, int height); // buffered only, width or height 0 to disable
+rg_gui_counters_t rg_gui_get_counters(void);
 bool rg_gui_set_font_type(int type);
 bool rg_gui_set_theme(const char *theme_name);
 const char *rg_gui_get_theme(void);
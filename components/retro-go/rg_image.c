@@ -3,13 +3,570 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <unistd.h>
 #include <math.h>
 
 
+// RGB888 to RGB565, rounded to the nearest value
+#define RGB565(r, g, b) ((((r) * 31 + 127) / 255) << 11 | (((g) * 63 + 127) / 255) << 5 | (((b) * 31 + 127) / 255))
+
+/*
+ * Streaming PNG decoder
+ *
+ * The IDAT stream is inflated straight from the file, each row is unfiltered, converted and
+ * box filtered into the final image as soon as it is complete. The working memory is the
+ * inflate window and tables, two rows and one row of accumulators, regardless of the image size.
+ *
+ * Supports 8 and 16 bit non-interlaced images of all color types, anything else goes to lodepng.
+ */
+
+#define HUFFMAN_FAST_BITS 10
+
+static const uint16_t len_base[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t len_extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t dist_base[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129,
+    193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t dist_extra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+typedef struct
+{
+    uint16_t fast[1 << HUFFMAN_FAST_BITS]; // (symbol << 4) | length, 0 for longer codes
+    uint16_t count[16];
+    uint16_t symbol[288];
+} huffman_t;
+
+typedef struct
+{
+    // Source, either a file or a memory buffer
+    FILE *fp;
+    const uint8_t *buf, *buf_end;
+    uint8_t file_buffer[1024];
+    uint32_t chunk_left; // Bytes left in the current IDAT chunk
+    bool overrun;
+
+    // Inflate
+    uint32_t bits;
+    int bit_count;
+    huffman_t lencode, distcode;
+    uint8_t window[32768];
+    uint32_t window_pos;
+
+    // PNG
+    int width, height, color, channels, bytes; // bytes per pixel
+    uint8_t palette[256][3];
+    uint8_t *rows, *row, *prev_row;
+    size_t stride, row_pos;
+    int y;
+
+    // Box filter
+    rg_image_t *img;
+    uint32_t *acc;
+    int out_y;
+} png_decoder_t;
+
+static int src_read(png_decoder_t *d, void *dest, int length)
+{
+    uint8_t *out = dest;
+    while (length > 0)
+    {
+        if (d->buf == d->buf_end)
+        {
+            size_t read = d->fp ? fread(d->file_buffer, 1, sizeof(d->file_buffer), d->fp) : 0;
+            if (read == 0)
+                break;
+            d->buf = d->file_buffer;
+            d->buf_end = d->file_buffer + read;
+        }
+        int count = RG_MIN(length, d->buf_end - d->buf);
+        if (out)
+        {
+            memcpy(out, d->buf, count);
+            out += count;
+        }
+        d->buf += count;
+        length -= count;
+    }
+    return length == 0;
+}
+
+static inline uint32_t read_be32(const uint8_t *data)
+{
+    return (data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+}
+
+static inline uint32_t idat_byte(png_decoder_t *d)
+{
+    while (d->chunk_left == 0)
+    {
+        // Skip the CRC and continue with the next chunk if it's an IDAT too
+        uint8_t header[12];
+        if (d->overrun || !src_read(d, header, 12) || memcmp(header + 8, "IDAT", 4) != 0)
+        {
+            d->overrun = true;
+            return 0;
+        }
+        d->chunk_left = read_be32(header + 4);
+    }
+    d->chunk_left--;
+    if (d->buf < d->buf_end)
+        return *d->buf++;
+    uint8_t byte = 0;
+    if (!src_read(d, &byte, 1))
+        d->overrun = true;
+    return byte;
+}
+
+static inline void need_bits(png_decoder_t *d, int count)
+{
+    while (d->bit_count < count)
+    {
+        d->bits |= idat_byte(d) << d->bit_count;
+        d->bit_count += 8;
+    }
+}
+
+static inline uint32_t get_bits(png_decoder_t *d, int count)
+{
+    need_bits(d, count);
+    uint32_t value = d->bits & ((1 << count) - 1);
+    d->bits >>= count;
+    d->bit_count -= count;
+    return value;
+}
+
+static bool huffman_build(huffman_t *h, const uint8_t *lengths, int count)
+{
+    uint16_t offsets[16];
+    int left = 1;
+
+    memset(h, 0, sizeof(huffman_t));
+
+    for (int i = 0; i < count; i++)
+        h->count[lengths[i]]++;
+
+    // Over-subscribed code sets are invalid, incomplete ones are allowed
+    for (int len = 1; len < 16; len++)
+    {
+        left = (left << 1) - h->count[len];
+        if (left < 0)
+            return false;
+    }
+
+    offsets[1] = 0;
+    for (int len = 1; len < 15; len++)
+        offsets[len + 1] = offsets[len] + h->count[len];
+
+    for (int i = 0; i < count; i++)
+        if (lengths[i])
+            h->symbol[offsets[lengths[i]]++] = i;
+
+    // Canonical codes are read most significant bit first, the lookup table is indexed by the
+    // next bits of the stream (least significant first) so the codes are reversed
+    for (int len = 1, code = 0, index = 0; len <= HUFFMAN_FAST_BITS; len++)
+    {
+        for (int i = 0; i < h->count[len]; i++, code++, index++)
+        {
+            int reversed = 0;
+            for (int bit = 0; bit < len; bit++)
+                reversed |= ((code >> bit) & 1) << (len - 1 - bit);
+            for (int j = reversed; j < (1 << HUFFMAN_FAST_BITS); j += (1 << len))
+                h->fast[j] = (h->symbol[index] << 4) | len;
+        }
+        code <<= 1;
+    }
+
+    return true;
+}
+
+static inline int huffman_decode(png_decoder_t *d, const huffman_t *h)
+{
+    need_bits(d, 15);
+
+    int entry = h->fast[d->bits & ((1 << HUFFMAN_FAST_BITS) - 1)];
+    if (entry)
+    {
+        d->bits >>= (entry & 15);
+        d->bit_count -= (entry & 15);
+        return entry >> 4;
+    }
+
+    // Codes longer than the table, one bit at a time
+    int code = 0, first = 0, index = 0;
+    for (int len = 1; len < 16; len++)
+    {
+        code |= (d->bits >> (len - 1)) & 1;
+        int count = h->count[len];
+        if (code - count < first)
+        {
+            d->bits >>= len;
+            d->bit_count -= len;
+            return h->symbol[index + (code - first)];
+        }
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+
+    return -1;
+}
+
+static void png_process_row(png_decoder_t *d);
+
+static inline void output_byte(png_decoder_t *d, uint8_t value)
+{
+    d->window[d->window_pos++ & 32767] = value;
+    d->row[d->row_pos++] = value;
+    if (d->row_pos == d->stride + 1)
+        png_process_row(d);
+}
+
+static bool inflate_codes(png_decoder_t *d)
+{
+    while (!d->overrun)
+    {
+        int symbol = huffman_decode(d, &d->lencode);
+        if (symbol < 256)
+        {
+            if (symbol < 0)
+                return false;
+            output_byte(d, symbol);
+        }
+        else if (symbol == 256)
+        {
+            return true;
+        }
+        else
+        {
+            if ((symbol -= 257) >= 29)
+                return false;
+            int length = len_base[symbol] + get_bits(d, len_extra[symbol]);
+            if ((symbol = huffman_decode(d, &d->distcode)) < 0 || symbol >= 30)
+                return false;
+            uint32_t distance = dist_base[symbol] + get_bits(d, dist_extra[symbol]);
+            if (distance > d->window_pos)
+                return false;
+            while (length--)
+                output_byte(d, d->window[(d->window_pos - distance) & 32767]);
+        }
+    }
+
+    return false;
+}
+
+static bool inflate_dynamic(png_decoder_t *d)
+{
+    static const uint8_t order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+    uint8_t lengths[288 + 32] = {0};
+
+    int nlen = get_bits(d, 5) + 257;
+    int ndist = get_bits(d, 5) + 1;
+    int ncode = get_bits(d, 4) + 4;
+
+    if (nlen > 286 || ndist > 30)
+        return false;
+
+    for (int i = 0; i < ncode; i++)
+        lengths[order[i]] = get_bits(d, 3);
+
+    if (!huffman_build(&d->lencode, lengths, 19))
+        return false;
+
+    for (int i = 0; i < nlen + ndist;)
+    {
+        int symbol = huffman_decode(d, &d->lencode);
+        int repeat, value = 0;
+
+        if (symbol < 0)
+            return false;
+        if (symbol < 16)
+        {
+            lengths[i++] = symbol;
+            continue;
+        }
+        if (symbol == 16)
+        {
+            if (i == 0)
+                return false;
+            value = lengths[i - 1];
+            repeat = 3 + get_bits(d, 2);
+        }
+        else if (symbol == 17)
+            repeat = 3 + get_bits(d, 3);
+        else
+            repeat = 11 + get_bits(d, 7);
+
+        if (i + repeat > nlen + ndist)
+            return false;
+        while (repeat--)
+            lengths[i++] = value;
+    }
+
+    return huffman_build(&d->lencode, lengths, nlen) && huffman_build(&d->distcode, lengths + nlen, ndist);
+}
+
+static bool inflate_stream(png_decoder_t *d)
+{
+    int cmf = get_bits(d, 8);
+    int flg = get_bits(d, 8);
+
+    if ((cmf & 15) != 8 || ((cmf << 8) | flg) % 31 || (flg & 0x20))
+        return false;
+
+    for (bool last = false; !last;)
+    {
+        last = get_bits(d, 1);
+        int type = get_bits(d, 2);
+
+        if (type == 0) // Stored
+        {
+            // Discard the bits left in the current byte
+            d->bits >>= (d->bit_count & 7);
+            d->bit_count -= (d->bit_count & 7);
+            int length = get_bits(d, 16);
+            if ((length ^ 0xFFFF) != (int)get_bits(d, 16))
+                return false;
+            while (length-- && !d->overrun)
+                output_byte(d, get_bits(d, 8));
+        }
+        else if (type == 1) // Fixed codes
+        {
+            uint8_t lengths[288];
+            memset(lengths, 8, 144);
+            memset(lengths + 144, 9, 112);
+            memset(lengths + 256, 7, 24);
+            memset(lengths + 280, 8, 8);
+            huffman_build(&d->lencode, lengths, 288);
+            memset(lengths, 5, 30);
+            huffman_build(&d->distcode, lengths, 30);
+            if (!inflate_codes(d))
+                return false;
+        }
+        else if (type == 2) // Dynamic codes
+        {
+            if (!inflate_dynamic(d) || !inflate_codes(d))
+                return false;
+        }
+        else
+        {
+            return false;
+        }
+
+        if (d->overrun)
+            return false;
+    }
+
+    return true;
+}
+
+static void png_process_row(png_decoder_t *d)
+{
+    uint8_t *row = d->row + 1, *prev = d->prev_row + 1;
+    size_t stride = d->stride, bpp = d->bytes;
+
+    d->row_pos = 0;
+
+    if (d->y >= d->height)
+        return;
+
+    switch (d->row[0])
+    {
+    case 1: // Sub
+        for (size_t i = bpp; i < stride; i++)
+            row[i] += row[i - bpp];
+        break;
+    case 2: // Up
+        for (size_t i = 0; i < stride; i++)
+            row[i] += prev[i];
+        break;
+    case 3: // Average
+        for (size_t i = 0; i < bpp; i++)
+            row[i] += prev[i] >> 1;
+        for (size_t i = bpp; i < stride; i++)
+            row[i] += (row[i - bpp] + prev[i]) >> 1;
+        break;
+    case 4: // Paeth
+        for (size_t i = 0; i < stride; i++)
+        {
+            int a = i >= bpp ? row[i - bpp] : 0, b = prev[i], c = i >= bpp ? prev[i - bpp] : 0;
+            int p = a + b - c, pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+            row[i] += (pa <= pb && pa <= pc) ? a : (pb <= pc) ? b : c;
+        }
+        break;
+    }
+
+    // Accumulate the row into the box of each destination pixel
+    int width = d->width, dest_width = d->img->width;
+    int sample = d->bytes / d->channels; // 16bit samples only use their most significant byte
+    uint32_t *acc = d->acc;
+    const uint8_t *src = row;
+
+    for (int x = 0, dx = 0, x_end = width / dest_width; x < width; x++, src += bpp)
+    {
+        if (x == x_end)
+        {
+            acc += 3;
+            x_end = (++dx + 1) * width / dest_width;
+        }
+        if (d->color == 3)
+        {
+            const uint8_t *rgb = d->palette[src[0]];
+            acc[0] += rgb[0], acc[1] += rgb[1], acc[2] += rgb[2];
+        }
+        else if (d->channels >= 3)
+            acc[0] += src[0], acc[1] += src[sample], acc[2] += src[sample * 2];
+        else
+            acc[0] += src[0], acc[1] += src[0], acc[2] += src[0];
+    }
+
+    // The last row of a box writes the destination row
+    int height = d->height, dest_height = d->img->height;
+    int y_start = d->out_y * height / dest_height;
+    int y_end = (d->out_y + 1) * height / dest_height;
+
+    if (++d->y == y_end)
+    {
+        uint16_t *dest = d->img->data + d->out_y * dest_width;
+        acc = d->acc;
+        for (int dx = 0; dx < dest_width; dx++, acc += 3)
+        {
+            int count = (y_end - y_start) * ((dx + 1) * width / dest_width - dx * width / dest_width);
+            int r = (acc[0] + count / 2) / count;
+            int g = (acc[1] + count / 2) / count;
+            int b = (acc[2] + count / 2) / count;
+            *dest++ = RGB565(r, g, b);
+        }
+        memset(d->acc, 0, dest_width * 3 * sizeof(uint32_t));
+        d->out_y++;
+    }
+
+    uint8_t *temp = d->row;
+    d->row = d->prev_row;
+    d->prev_row = temp;
+}
+
+#define PNG_MAX_DIMENSION 16384 // Also keeps the row stride math from overflowing on 32-bit
+
+static rg_image_t *png_decode_stream(FILE *fp, const uint8_t *data, size_t data_len, int max_width, int max_height)
+{
+    int64_t start_time = rg_system_timer();
+    png_decoder_t *d = calloc(1, sizeof(png_decoder_t));
+    rg_image_t *img = NULL;
+    uint8_t header[33];
+    size_t work_size = sizeof(png_decoder_t);
+
+    if (!d)
+        return NULL;
+
+    d->fp = fp;
+    d->buf = data;
+    d->buf_end = data + data_len;
+
+    // Signature and IHDR
+    if (!src_read(d, header, 33) || memcmp(header + 12, "IHDR", 4) != 0)
+        goto _cleanup;
+
+    int width = read_be32(header + 16);
+    int height = read_be32(header + 20);
+    int depth = header[24], color = header[25], interlace = header[28];
+    const int channels_tab[7] = {1, 0, 3, 1, 2, 0, 4};
+
+    if ((depth != 8 && depth != 16) || interlace || color > 6 || !channels_tab[color]
+        || (color == 3 && depth != 8) || width <= 0 || height <= 0
+        || width > PNG_MAX_DIMENSION || height > PNG_MAX_DIMENSION)
+    {
+        // The callers only get here with a streamable header, there is no fallback to lodepng
+        RG_LOGE("Unsupported PNG: %dx%d, depth %d, color %d, interlace %d\n", width, height, depth, color, interlace);
+        goto _cleanup;
+    }
+
+    d->width = width;
+    d->height = height;
+    d->color = color;
+    d->channels = channels_tab[color];
+    d->bytes = d->channels * depth / 8;
+    d->stride = (size_t)width * d->bytes;
+
+    // Find the first IDAT, keep the palette on the way
+    while (true)
+    {
+        uint8_t chunk[8];
+        if (!src_read(d, chunk, 8))
+            goto _cleanup;
+        uint32_t length = read_be32(chunk);
+        if (memcmp(chunk + 4, "IDAT", 4) == 0)
+        {
+            d->chunk_left = length;
+            break;
+        }
+        if (memcmp(chunk + 4, "PLTE", 4) == 0 && length <= sizeof(d->palette))
+        {
+            if (!src_read(d, d->palette, length) || !src_read(d, NULL, 4))
+                goto _cleanup;
+        }
+        else if (memcmp(chunk + 4, "IEND", 4) == 0 || !src_read(d, NULL, length + 4))
+            goto _cleanup;
+    }
+
+    // Box filtered down to fit in max_width x max_height, never up
+    int dest_width = width, dest_height = height;
+    if (max_width > 0 && max_height > 0 && (width > max_width || height > max_height))
+    {
+        if ((int64_t)width * max_height > (int64_t)height * max_width)
+            dest_width = max_width, dest_height = RG_MAX(1, (int64_t)height * max_width / width);
+        else
+            dest_height = max_height, dest_width = RG_MAX(1, (int64_t)width * max_height / height);
+    }
+
+    d->rows = calloc(2, d->stride + 1);
+    d->row = d->rows;
+    d->prev_row = d->rows + d->stride + 1;
+    d->acc = calloc(dest_width * 3, sizeof(uint32_t));
+    d->img = rg_image_alloc(dest_width, dest_height);
+    work_size += (d->stride + 1) * 2 + dest_width * 3 * sizeof(uint32_t);
+
+    if (!d->rows || !d->acc || !d->img)
+        goto _cleanup;
+
+    if (!inflate_stream(d) || d->out_y != dest_height)
+    {
+        RG_LOGE("PNG decoding failed at row %d/%d\n", d->y, height);
+        goto _cleanup;
+    }
+
+    img = d->img, d->img = NULL;
+
+    RG_LOGD("%dx%d => %dx%d in %dms, %d bytes of work memory\n", width, height, dest_width, dest_height,
+            (int)((rg_system_timer() - start_time) / 1000), (int)work_size);
+
+_cleanup:
+    rg_image_free(d->img);
+    free(d->rows);
+    free(d->acc);
+    free(d);
+    return img;
+}
+
+static bool is_streamable_png(const uint8_t *header)
+{
+    return memcmp(header, "\x89PNG\r\n\x1a\n", 8) == 0 && (header[24] == 8 || header[24] == 16)
+           && header[28] == 0 && (header[25] != 3 || header[24] == 8);
+}
+
 rg_image_t *rg_image_load_from_file(const char *filename, uint32_t flags)
+{
+    return rg_image_load_from_file_scaled(filename, 0, 0, flags);
+}
+
+rg_image_t *rg_image_load_from_file_scaled(const char *filename, int max_width, int max_height, uint32_t flags)
 {
     RG_ASSERT(filename, "bad param");
 
+    rg_image_t *img = NULL;
+    uint8_t header[33] = {0};
+
     FILE *fp = fopen(filename, "rb");
     if (!fp)
     {
@@ -17,6 +574,14 @@ rg_image_t *rg_image_load_from_file(const char *filename, uint32_t flags)
         return NULL;
     }
 
+    if (fread(header, 1, sizeof(header), fp) == sizeof(header) && is_streamable_png(header))
+    {
+        fseek(fp, 0, SEEK_SET);
+        img = png_decode_stream(fp, NULL, 0, max_width, max_height);
+        fclose(fp);
+        return img;
+    }
+
     fseek(fp, 0, SEEK_END);
 
     size_t data_len = ftell(fp);
@@ -32,9 +597,21 @@ rg_image_t *rg_image_load_from_file(const char *filename, uint32_t flags)
     fread(data, data_len, 1, fp);
     fclose(fp);
 
-    rg_image_t *img = rg_image_load_from_memory(data, data_len, flags);
+    img = rg_image_load_from_memory(data, data_len, flags);
     free(data);
 
+    // Formats that can't be streamed are scaled after the fact
+    if (img && max_width > 0 && max_height > 0 && (img->width > max_width || img->height > max_height))
+    {
+        float scale = RG_MIN((float)max_width / img->width, (float)max_height / img->height);
+        rg_image_t *temp = rg_image_copy_resampled(img, RG_MAX(1, img->width * scale), RG_MAX(1, img->height * scale), 0);
+        if (temp)
+        {
+            rg_image_free(img);
+            img = temp;
+        }
+    }
+
     return img;
 }
 
@@ -42,7 +619,11 @@ rg_image_t *rg_image_load_from_memory(const uint8_t *data, size_t data_len, uint
 {
     RG_ASSERT(data && data_len >= 16, "bad param");
 
-    if (memcmp(data, "\x89PNG", 4) == 0)
+    if (data_len >= 33 && is_streamable_png(data))
+    {
+        return png_decode_stream(NULL, data, data_len, 0, 0);
+    }
+    else if (memcmp(data, "\x89PNG", 4) == 0)
     {
         unsigned error, width, height;
         uint8_t *image = NULL;
@@ -64,10 +645,7 @@ rg_image_t *rg_image_load_from_memory(const uint8_t *data, size_t data_len, uint
             // RGB888 or RGBA8888 to RGB565
             for (size_t i = 0; i < pixel_count; ++i)
             {
-                // TO DO: Properly scale values instead of discarding extra bits
-                *dest++ = (((src[0] >> 3) & 0x1F) << 11)  // Red
-                          | (((src[1] >> 2) & 0x3F) << 5) // Green
-                          | (((src[2] >> 3) & 0x1F));     // Blue
+                *dest++ = RGB565(src[0], src[1], src[2]);
                 src += 3;
             }
         }
@@ -97,10 +675,251 @@ rg_image_t *rg_image_load_from_memory(const uint8_t *data, size_t data_len, uint
     return NULL;
 }
 
+/*
+ * Fast PNG encoder
+ *
+ * One row at a time with the Sub filter, deflated with the fixed huffman codes and a greedy single
+ * probe LZ77 (like LZ4) whose window is the previous and current rows. There is no RGB888 copy of
+ * the image, the files are bigger than lodepng's but it takes a fraction of the time.
+ */
+
+#define PNG_HASH_BITS 12
+
+typedef struct
+{
+    FILE *fp;
+    bool failed;                             // An IDAT chunk couldn't be written
+    uint32_t bits;
+    int bit_count;
+    uint32_t adler_a, adler_b;
+    uint32_t position;                       // Stream position of the current row
+    uint32_t hash_table[1 << PNG_HASH_BITS]; // Stream position of the last occurrence of 4 bytes
+    size_t length;
+    uint8_t buffer[4096 + 8]; // "IDAT" + pending data
+} png_encoder_t;
+
+static uint16_t fixed_codes[288]; // Bit reversed, ready to be written
+static uint8_t fixed_lengths[288];
+
+static inline uint32_t reverse_bits(uint32_t code, int length)
+{
+    uint32_t reversed = 0;
+    while (length--)
+    {
+        reversed = (reversed << 1) | (code & 1);
+        code >>= 1;
+    }
+    return reversed;
+}
+
+static bool png_write_chunk(FILE *fp, const void *type_and_data, size_t length)
+{
+    uint8_t header[4] = {length >> 24, length >> 16, length >> 8, length};
+    uint32_t crc = rg_crc32(0, type_and_data, length + 4);
+    uint8_t footer[4] = {crc >> 24, crc >> 16, crc >> 8, crc};
+    return fwrite(header, 4, 1, fp) && fwrite(type_and_data, length + 4, 1, fp) && fwrite(footer, 4, 1, fp);
+}
+
+static inline void put_bits(png_encoder_t *e, uint32_t value, int count)
+{
+    e->bits |= value << e->bit_count;
+    e->bit_count += count;
+    while (e->bit_count >= 8)
+    {
+        e->buffer[4 + e->length++] = e->bits;
+        e->bits >>= 8;
+        e->bit_count -= 8;
+        if (e->length == sizeof(e->buffer) - 8)
+        {
+            if (!png_write_chunk(e->fp, e->buffer, e->length))
+                e->failed = true;
+            e->length = 0;
+        }
+    }
+}
+
+static inline void put_match(png_encoder_t *e, int length, int distance)
+{
+    int code = 28;
+    while (len_base[code] > length)
+        code--;
+    put_bits(e, fixed_codes[257 + code], fixed_lengths[257 + code]);
+    put_bits(e, length - len_base[code], len_extra[code]);
+    code = 29;
+    while (dist_base[code] > distance)
+        code--;
+    put_bits(e, reverse_bits(code, 5), 5);
+    put_bits(e, distance - dist_base[code], dist_extra[code]);
+}
+
+// window holds the previous row followed by the current one
+static void put_row(png_encoder_t *e, const uint8_t *window, size_t stride)
+{
+    const uint8_t *data = window + stride;
+    uint32_t window_start = e->position > stride ? e->position - stride : 0;
+
+    for (size_t i = 0; i < stride;)
+    {
+        size_t max = RG_MIN(stride - i, 258), length = 0;
+        uint32_t position = e->position + i, distance = 0;
+
+        if (max >= 4)
+        {
+            uint32_t key = data[i] | (data[i + 1] << 8) | (data[i + 2] << 16) | ((uint32_t)data[i + 3] << 24);
+            uint32_t *slot = &e->hash_table[(key * 2654435761u) >> (32 - PNG_HASH_BITS)];
+            uint32_t candidate = *slot;
+            *slot = position;
+
+            if (candidate < position && candidate >= window_start && position - candidate <= 32768)
+            {
+                distance = position - candidate;
+                while (length < max && data[i + length - distance] == data[i + length])
+                    length++;
+            }
+        }
+
+        if (length >= 4)
+        {
+            put_match(e, length, distance);
+            i += length;
+        }
+        else
+        {
+            put_bits(e, fixed_codes[data[i]], fixed_lengths[data[i]]);
+            i++;
+        }
+    }
+
+    // Adler-32, the modulo can be deferred for up to 5552 bytes
+    for (size_t i = 0; i < stride;)
+    {
+        size_t end = RG_MIN(stride, i + 5552);
+        for (; i < end; i++)
+        {
+            e->adler_a += data[i];
+            e->adler_b += e->adler_a;
+        }
+        e->adler_a %= 65521;
+        e->adler_b %= 65521;
+    }
+
+    e->position += stride;
+}
+
+static bool png_encode_fast(FILE *fp, const rg_image_t *img)
+{
+    size_t stride = img->width * 3 + 1; // Filter type + RGB888
+    uint8_t *window = calloc(2, stride);
+    png_encoder_t *e = calloc(1, sizeof(png_encoder_t));
+    bool success = false;
+
+    if (!window || !e)
+        goto _cleanup;
+
+    if (!fixed_lengths[0])
+    {
+        for (int i = 0; i < 288; i++)
+        {
+            if (i < 144)
+                fixed_codes[i] = reverse_bits(0x30 + i, 8), fixed_lengths[i] = 8;
+            else if (i < 256)
+                fixed_codes[i] = reverse_bits(0x190 + i - 144, 9), fixed_lengths[i] = 9;
+            else if (i < 280)
+                fixed_codes[i] = reverse_bits(i - 256, 7), fixed_lengths[i] = 7;
+            else
+                fixed_codes[i] = reverse_bits(0xC0 + i - 280, 8), fixed_lengths[i] = 8;
+        }
+    }
+
+    uint8_t ihdr[17] = {'I', 'H', 'D', 'R', 0, 0, img->width >> 8, img->width,
+        0, 0, img->height >> 8, img->height, 8, 2, 0, 0, 0};
+    if (!fwrite("\x89PNG\r\n\x1a\n", 8, 1, fp) || !png_write_chunk(fp, ihdr, 13))
+        goto _cleanup;
+
+    e->fp = fp;
+    e->adler_a = 1;
+    memset(e->hash_table, 0xFF, sizeof(e->hash_table));
+    memcpy(e->buffer, "IDAT", 4);
+    put_bits(e, 0x78, 8); // zlib header: deflate, 32K window, no dictionary
+    put_bits(e, 0x01, 8);
+    put_bits(e, 1, 1);    // Final block
+    put_bits(e, 1, 2);    // Fixed huffman codes
+
+    for (int y = 0; y < img->height; y++)
+    {
+        const uint16_t *src = img->data + y * img->width;
+        uint8_t *row = window + stride;
+        int prev_r = 0, prev_g = 0, prev_b = 0;
+
+        memcpy(window, row, stride);
+
+        row[0] = 1; // Sub
+        for (int x = 0; x < img->width; x++)
+        {
+            int r = (src[x] >> 11) & 0x1F, g = (src[x] >> 5) & 0x3F, b = src[x] & 0x1F;
+            r = (r << 3) | (r >> 2), g = (g << 2) | (g >> 4), b = (b << 3) | (b >> 2);
+            row[1 + x * 3 + 0] = r - prev_r;
+            row[1 + x * 3 + 1] = g - prev_g;
+            row[1 + x * 3 + 2] = b - prev_b;
+            prev_r = r, prev_g = g, prev_b = b;
+        }
+
+        put_row(e, window, stride);
+
+        if (e->failed)
+            goto _cleanup;
+    }
+
+    put_bits(e, fixed_codes[256], fixed_lengths[256]);
+    put_bits(e, 0, (8 - e->bit_count) & 7);
+    put_bits(e, e->adler_b >> 8, 8);
+    put_bits(e, e->adler_b & 0xFF, 8);
+    put_bits(e, e->adler_a >> 8, 8);
+    put_bits(e, e->adler_a & 0xFF, 8);
+
+    success = !e->failed && (!e->length || png_write_chunk(fp, e->buffer, e->length)) && png_write_chunk(fp, "IEND", 0);
+
+_cleanup:
+    free(window);
+    free(e);
+    return success;
+}
+
 bool rg_image_save_to_file(const char *filename, const rg_image_t *img, uint32_t flags)
 {
     RG_ASSERT(filename && img, "bad param");
 
+    if (flags & (RG_IMAGE_SAVE_FAST | RG_IMAGE_SAVE_RAW565))
+    {
+        int64_t start_time = rg_system_timer();
+        FILE *fp = fopen(filename, "wb");
+        if (!fp)
+        {
+            RG_LOGE("Unable to create image file '%s'!\n", filename);
+            return false;
+        }
+
+        bool success;
+        if (flags & RG_IMAGE_SAVE_RAW565)
+            success = fwrite(img, sizeof(rg_image_t) + img->width * img->height * 2, 1, fp);
+        else
+            success = png_encode_fast(fp, img);
+
+        long size = ftell(fp);
+        fclose(fp);
+
+        if (!success)
+        {
+            RG_LOGE("Image write failed!\n");
+            unlink(filename);
+            return false;
+        }
+
+        RG_LOGD("%dx%d saved in %dms, %d bytes\n", img->width, img->height,
+                (int)((rg_system_timer() - start_time) / 1000), (int)size);
+        return true;
+    }
+
     size_t pixel_count = img->width * img->height;
     uint8_t *image = malloc(pixel_count * 3);
     uint8_t *dest = image;
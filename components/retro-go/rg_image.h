@@ -12,7 +12,14 @@ typedef struct
     uint16_t data[];
 } rg_image_t;
 
+enum
+{
+    RG_IMAGE_SAVE_FAST   = (1 << 0), // PNG with a fixed filter and a fast deflate, bigger files
+    RG_IMAGE_SAVE_RAW565 = (1 << 1), // The RAW565 format read by rg_image_load_from_memory
+};
+
 rg_image_t *rg_image_load_from_file(const char *filename, uint32_t flags);
+rg_image_t *rg_image_load_from_file_scaled(const char *filename, int max_width, int max_height, uint32_t flags);
 rg_image_t *rg_image_load_from_memory(const uint8_t *data, size_t data_len, uint32_t flags);
 rg_image_t *rg_image_alloc(size_t width, size_t height);
 rg_image_t *rg_image_copy_resampled(const rg_image_t *img, int new_width, int new_height, int new_format);
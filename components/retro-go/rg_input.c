@@ -8,6 +8,8 @@
 #ifdef RG_TARGET_SDL2
 #include <SDL2/SDL.h>
 #else
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 #include <driver/gpio.h>
 #endif
 
@@ -16,9 +18,36 @@
 #include <driver/adc.h>
 #endif
 
+#define EVENT_QUEUE_SIZE 32
+
 static bool input_task_running = false;
 static uint32_t gamepad_state = -1; // _Atomic
 static int battery_level = -1;
+
+// The debounce state is shared by the background task and rg_input_sample()
+static struct
+{
+    rg_input_debounce_t mode;
+    uint8_t samples;
+    uint8_t history[RG_KEY_COUNT];  // One bit per sample, most recent in bit 0
+    int64_t raw_since[RG_KEY_COUNT]; // Time of the first sample of the current raw state
+    int64_t pressed_at[RG_KEY_COUNT];
+    uint32_t unconsumed;            // Presses that no reader has seen yet
+    uint32_t state;
+    rg_input_event_t events[EVENT_QUEUE_SIZE];
+    uint32_t events_head, events_tail;
+    rg_input_counters_t counters;
+} input = {RG_INPUT_DEBOUNCE_SAMPLES, 2};
+
+#ifdef RG_TARGET_SDL2
+static SDL_mutex *input_lock;
+#define LOCK_INPUT()   (input_lock ? SDL_LockMutex(input_lock) : 0)
+#define UNLOCK_INPUT() (input_lock ? SDL_UnlockMutex(input_lock) : 0)
+#else
+static SemaphoreHandle_t input_lock;
+#define LOCK_INPUT()   (input_lock ? xSemaphoreTake(input_lock, portMAX_DELAY) : 0)
+#define UNLOCK_INPUT() (input_lock ? xSemaphoreGive(input_lock) : 0)
+#endif
 #if defined(RG_BATTERY_ADC_CHANNEL)
 static esp_adc_cal_characteristics_t adc_chars;
 #endif
@@ -182,36 +211,128 @@ static inline uint32_t gamepad_read(void)
     return state;
 }
 
-static void input_task(void *arg)
+// Must be called with the lock held
+static void push_event(int key, bool pressed, int64_t time)
 {
-    const uint8_t debounce_level = 0x03;
-    uint8_t debounce[RG_KEY_COUNT];
-    uint32_t local_gamepad_state = 0;
-    uint32_t loop_count = 0;
+    input.counters.events++;
 
-    memset(debounce, debounce_level, sizeof(debounce));
-    input_task_running = true;
+    if (input.events_head - input.events_tail >= EVENT_QUEUE_SIZE)
+    {
+        input.counters.eventsDropped++;
+        return;
+    }
 
-    while (input_task_running)
+    input.events[input.events_head++ % EVENT_QUEUE_SIZE] = (rg_input_event_t){time, 1 << key, pressed};
+}
+
+// Must be called with the lock held. Only the background task's samples go in the history, so that
+// N samples always means N timer periods. A sample taken by rg_input_sample() can only report an
+// eager press early.
+static uint32_t update_state(bool from_task)
+{
+    int64_t now = rg_system_timer();
+    uint32_t raw = gamepad_read();
+    uint8_t mask = (1 << input.samples) - 1;
+
+    input.counters.samples++;
+
+    for (int i = 0; i < RG_KEY_COUNT; ++i)
     {
-        uint32_t state = gamepad_read();
+        uint8_t history = (input.history[i] << 1) | ((raw >> i) & 1);
+        bool was_pressed = input.state & (1 << i);
+        bool pressed = was_pressed;
 
-        for (int i = 0; i < RG_KEY_COUNT; ++i)
+        if (!from_task)
         {
-            debounce[i] = ((debounce[i] << 1) | ((state >> i) & 1));
-            debounce[i] &= debounce_level;
-
-            if (debounce[i] == debounce_level) // Pressed
-            {
-                local_gamepad_state |= (1 << i);
-            }
-            else if (debounce[i] == 0x00) // Released
-            {
-                local_gamepad_state &= ~(1 << i);
-            }
+            if (was_pressed || input.mode != RG_INPUT_DEBOUNCE_EAGER || !(history & 1))
+                continue;
+            if (!(input.history[i] & 1))
+                input.raw_since[i] = now;
+            pressed = true;
         }
+        else
+        {
+            if ((history ^ input.history[i]) & 1)
+                input.raw_since[i] = now;
+            input.history[i] = history;
+
+            if ((history & mask) == 0)
+                pressed = false;
+            else if ((history & mask) == mask || (input.mode == RG_INPUT_DEBOUNCE_EAGER && (history & 1)))
+                pressed = true;
+        }
+
+        if (pressed == was_pressed)
+            continue;
+
+        if (pressed)
+        {
+            input.state |= (1 << i);
+            input.unconsumed |= (1 << i);
+            input.pressed_at[i] = input.raw_since[i];
+        }
+        else
+        {
+            input.state &= ~(1 << i);
+            input.unconsumed &= ~(1 << i);
+        }
+
+        push_event(i, pressed, input.raw_since[i]);
+    }
+
+    gamepad_state = input.state;
+
+    return input.state;
+}
+
+// Must be called with the lock held
+static void consume_state(uint32_t state)
+{
+    uint32_t fresh = state & input.unconsumed;
+
+    if (!fresh)
+        return;
+
+    int64_t now = rg_system_timer();
+
+    for (int i = 0; i < RG_KEY_COUNT; ++i)
+    {
+        if (!(fresh & (1 << i)))
+            continue;
+
+        int latency = now - input.pressed_at[i];
+        int bucket = 0;
+        while (bucket < RG_INPUT_LATENCY_BUCKETS - 1 && latency >= (1000 << bucket))
+            bucket++;
+
+        input.counters.presses++;
+        input.counters.latency[bucket]++;
+        input.counters.latencyTotal += latency;
+        input.counters.latencyMax = RG_MAX(input.counters.latencyMax, latency);
+    }
+
+    input.unconsumed &= ~fresh;
+}
+
+static void input_task(void *arg)
+{
+    uint32_t loop_count = 0;
+
+    // Keys held at boot are reported on the first sample, like the old debounce did
+    LOCK_INPUT();
+    memset(input.history, 0xFF, sizeof(input.history));
+    input.state = 0;
+    input.unconsumed = 0;
+    update_state(true);
+    UNLOCK_INPUT();
+
+    input_task_running = true;
 
-        gamepad_state = local_gamepad_state;
+    while (input_task_running)
+    {
+        LOCK_INPUT();
+        update_state(true);
+        UNLOCK_INPUT();
 
         if ((loop_count % 100) == 0)
         {
@@ -236,6 +357,15 @@ void rg_input_init(void)
     if (input_task_running)
         return;
 
+    if (!input_lock)
+    {
+    #ifdef RG_TARGET_SDL2
+        input_lock = SDL_CreateMutex();
+    #else
+        input_lock = xSemaphoreCreateMutex();
+    #endif
+    }
+
 #if RG_GAMEPAD_DRIVER == 1  // GPIO
 
     const char *driver = "GPIO";
@@ -331,7 +461,58 @@ uint32_t rg_input_read_gamepad(void)
 #ifdef RG_TARGET_SDL2
     SDL_PumpEvents();
 #endif
-    return gamepad_state;
+    uint32_t state = gamepad_state;
+    if (input_task_running)
+    {
+        LOCK_INPUT();
+        consume_state(state);
+        UNLOCK_INPUT();
+    }
+    return state;
+}
+
+uint32_t rg_input_sample(void)
+{
+    if (!input_task_running)
+        return rg_input_read_gamepad();
+#ifdef RG_TARGET_SDL2
+    SDL_PumpEvents();
+#endif
+    LOCK_INPUT();
+    uint32_t state = update_state(false);
+    consume_state(state);
+    UNLOCK_INPUT();
+    return state;
+}
+
+bool rg_input_read_event(rg_input_event_t *event)
+{
+    bool found = false;
+    LOCK_INPUT();
+    if (input.events_tail != input.events_head)
+    {
+        *event = input.events[input.events_tail++ % EVENT_QUEUE_SIZE];
+        found = true;
+    }
+    UNLOCK_INPUT();
+    return found;
+}
+
+void rg_input_set_debounce(rg_input_debounce_t mode, int samples)
+{
+    LOCK_INPUT();
+    input.mode = mode;
+    input.samples = RG_MAX(1, RG_MIN(samples, 8));
+    UNLOCK_INPUT();
+    RG_LOGI("Debounce mode: %d, samples: %d\n", mode, input.samples);
+}
+
+rg_input_counters_t rg_input_get_counters(void)
+{
+    LOCK_INPUT();
+    rg_input_counters_t counters = input.counters;
+    UNLOCK_INPUT();
+    return counters;
 }
 
 bool rg_input_key_is_pressed(rg_key_t key)
@@ -24,9 +24,39 @@ typedef enum
     RG_KEY_COUNT   = 14,
 } rg_key_t;
 
+typedef enum
+{
+    RG_INPUT_DEBOUNCE_SAMPLES, // A key changes state after N identical samples of the background task
+    RG_INPUT_DEBOUNCE_EAGER,   // A press is reported on the first sample (any), a release after N samples
+} rg_input_debounce_t;
+
+typedef struct
+{
+    int64_t time;   // rg_system_timer() of the first sample showing the change
+    uint16_t key;   // rg_key_t
+    bool pressed;
+} rg_input_event_t;
+
+#define RG_INPUT_LATENCY_BUCKETS 8
+
+typedef struct
+{
+    uint32_t samples;       // Gamepad reads (background task + rg_input_sample)
+    uint32_t events;        // Edges detected
+    uint32_t eventsDropped; // Edges lost because the event queue was full
+    uint32_t presses;       // Presses seen by a reader
+    int64_t latencyTotal;   // Sum of press-to-consumed times (us)
+    int32_t latencyMax;     // Longest press-to-consumed time (us)
+    uint32_t latency[RG_INPUT_LATENCY_BUCKETS]; // Histogram: <1ms, <2ms, <4ms, ..., >=64ms
+} rg_input_counters_t;
+
 void rg_input_init(void);
 void rg_input_deinit(void);
 bool rg_input_key_is_pressed(rg_key_t key);
 void rg_input_wait_for_key(rg_key_t key, bool pressed);
 uint32_t rg_input_read_gamepad(void);
+uint32_t rg_input_sample(void); // Reads the gamepad now instead of using the last polled state
+bool rg_input_read_event(rg_input_event_t *event);
+void rg_input_set_debounce(rg_input_debounce_t mode, int samples);
+rg_input_counters_t rg_input_get_counters(void);
 bool rg_input_read_battery(float *percent, float *volts);
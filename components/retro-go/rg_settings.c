@@ -1,32 +1,339 @@
 #include "rg_system.h"
 
+#include <sys/stat.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
 #include <cJSON.h>
 
-static cJSON *config_root = NULL;
+// Each namespace is stored in its own append-only log (<name>.kv). A change appends one record,
+// the file is only rewritten (compacted) when stale records make up most of it. Legacy (or user
+// edited, like wifi.json) <name>.json files are imported whenever they differ from the last import.
+//
+// File format (little endian):
+//   header: magic "RGKV", json_mtime:U32, json_size:U32
+//   record: type:U8, key_len:U8, value_len:U16, key, value (double or string without terminator)
 
+#define KV_MAGIC 0x564B4752 // "RGKV"
 
-static FILE *open_config_file(const char *name, const char *mode)
+enum
+{
+    KV_EMPTY = 0,
+    KV_NUMBER,
+    KV_STRING,
+    KV_NULL,
+    KV_DELETED,
+};
+
+typedef struct __attribute__((packed))
+{
+    uint32_t magic;
+    uint32_t json_mtime;
+    uint32_t json_size;
+} kv_header_t;
+
+typedef struct __attribute__((packed))
+{
+    uint8_t type;
+    uint8_t key_len;
+    uint16_t value_len;
+} kv_record_t;
+
+typedef struct
+{
+    char *key;
+    uint32_t hash;
+    uint8_t type;
+    bool dirty;
+    union {
+        double number;
+        char *string;
+    };
+} kv_entry_t;
+
+typedef struct kv_ns_s
+{
+    char *name;
+    kv_entry_t *entries; // Open addressing, capacity is a power of two
+    size_t capacity, count;
+    size_t file_size;
+    kv_header_t header;
+    bool dirty, compact;
+    struct kv_ns_s *next;
+} kv_ns_t;
+
+static kv_ns_t *namespaces = NULL;
+static bool initialized = false;
+
+
+static uint32_t hash_key(const char *key)
+{
+    uint32_t hash = 0x811C9DC5; // FNV-1a
+    while (*key)
+        hash = (hash ^ (uint8_t)*key++) * 0x01000193;
+    return hash;
+}
+
+static kv_entry_t *find_entry(kv_ns_t *ns, const char *key, uint32_t hash)
+{
+    size_t mask = ns->capacity - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask)
+    {
+        kv_entry_t *entry = &ns->entries[i];
+        if (!entry->key || (entry->hash == hash && strcmp(entry->key, key) == 0))
+            return entry;
+    }
+}
+
+static void free_value(kv_entry_t *entry)
+{
+    if (entry->type == KV_STRING)
+        free(entry->string);
+    entry->string = NULL;
+}
+
+static kv_entry_t *insert_entry(kv_ns_t *ns, const char *key)
+{
+    uint32_t hash = hash_key(key);
+    kv_entry_t *entry = ns->capacity ? find_entry(ns, key, hash) : NULL;
+
+    if (entry && entry->key)
+        return entry;
+
+    if ((ns->count + 1) * 4 > ns->capacity * 3)
+    {
+        kv_entry_t *old_entries = ns->entries;
+        size_t old_capacity = ns->capacity;
+        ns->capacity = RG_MAX(old_capacity * 2, 32);
+        ns->entries = calloc(ns->capacity, sizeof(kv_entry_t));
+        RG_ASSERT(ns->entries, "Out of memory");
+        for (size_t i = 0; i < old_capacity; i++)
+        {
+            if (old_entries[i].key)
+                *find_entry(ns, old_entries[i].key, old_entries[i].hash) = old_entries[i];
+        }
+        free(old_entries);
+        entry = find_entry(ns, key, hash);
+    }
+
+    *entry = (kv_entry_t){strdup(key), hash, KV_DELETED, false, {0}};
+    ns->count++;
+    return entry;
+}
+
+static kv_entry_t *lookup(kv_ns_t *ns, const char *key)
+{
+    if (!ns || !key || !ns->count)
+        return NULL;
+    kv_entry_t *entry = find_entry(ns, key, hash_key(key));
+    return (entry->key && entry->type != KV_DELETED) ? entry : NULL;
+}
+
+// Returns NULL if the value was already there (so that nothing needs to be written)
+static kv_entry_t *update_entry(kv_ns_t *ns, const char *key, int type, double number, const char *string)
+{
+    kv_entry_t *entry = insert_entry(ns, key);
+
+    if (entry->type == type)
+    {
+        if (type == KV_NUMBER && entry->number == number)
+            return NULL;
+        if (type == KV_STRING && strcmp(entry->string, string) == 0)
+            return NULL;
+        if (type == KV_NULL || type == KV_DELETED)
+            return NULL;
+    }
+
+    free_value(entry);
+    entry->type = type;
+    if (type == KV_NUMBER)
+        entry->number = number;
+    else if (type == KV_STRING)
+        entry->string = strdup(string);
+    return entry;
+}
+
+static void get_path(char *pathbuf, const char *name, const char *ext)
+{
+    snprintf(pathbuf, RG_PATH_MAX, "%s/%s.%s", RG_BASE_PATH_CONFIG, name, ext);
+}
+
+static size_t record_size(const kv_entry_t *entry)
+{
+    size_t size = sizeof(kv_record_t) + strlen(entry->key);
+    if (entry->type == KV_NUMBER)
+        size += sizeof(double);
+    else if (entry->type == KV_STRING)
+        size += strlen(entry->string);
+    return size;
+}
+
+static bool write_record(FILE *fp, const kv_entry_t *entry)
+{
+    size_t key_len = strlen(entry->key);
+    size_t value_len = entry->type == KV_NUMBER ? sizeof(double) : entry->type == KV_STRING ? strlen(entry->string) : 0;
+    kv_record_t record = {entry->type, key_len, value_len};
+    const void *value = entry->type == KV_NUMBER ? (void *)&entry->number : entry->string;
+
+    if (key_len > 255 || value_len > 65535)
+    {
+        RG_LOGW("Key '%.32s' too long, not saved.\n", entry->key);
+        return true;
+    }
+
+    return fwrite(&record, sizeof(record), 1, fp)
+        && fwrite(entry->key, key_len, 1, fp)
+        && (!value_len || fwrite(value, value_len, 1, fp));
+}
+
+static void load_records(kv_ns_t *ns, const uint8_t *data, size_t length)
+{
+    const uint8_t *ptr = data + sizeof(kv_header_t), *end = data + length;
+    char key[256];
+
+    while (ptr + sizeof(kv_record_t) <= end)
+    {
+        kv_record_t record;
+        memcpy(&record, ptr, sizeof(record));
+        const uint8_t *value = ptr + sizeof(record) + record.key_len;
+
+        if (value + record.value_len > end || record.type < KV_NUMBER || record.type > KV_DELETED
+            || (record.type == KV_NUMBER && record.value_len != sizeof(double)))
+            break;
+
+        memcpy(key, ptr + sizeof(record), record.key_len);
+        key[record.key_len] = 0;
+
+        if (record.type == KV_NUMBER)
+        {
+            double number;
+            memcpy(&number, value, sizeof(number));
+            update_entry(ns, key, KV_NUMBER, number, NULL);
+        }
+        else if (record.type == KV_STRING)
+        {
+            char *string = strndup((const char *)value, record.value_len);
+            update_entry(ns, key, KV_STRING, 0, string);
+            free(string);
+        }
+        else
+        {
+            update_entry(ns, key, record.type, 0, NULL);
+        }
+
+        ptr = value + record.value_len;
+    }
+
+    if (ptr != end)
+    {
+        // Most likely a write interrupted by a power loss, keep what's valid
+        RG_LOGW("Config file '%s' is truncated at %d/%d.\n", ns->name, (int)(ptr - data), (int)length);
+        ns->dirty = ns->compact = true;
+    }
+}
+
+static void import_json(kv_ns_t *ns, const struct stat *statbuf)
 {
     char pathbuf[RG_PATH_MAX];
-    snprintf(pathbuf, RG_PATH_MAX, "%s/%s.json", RG_BASE_PATH_CONFIG, name);
-    RG_LOGI("Opening %s for %s", pathbuf, mode);
-    FILE *fp = fopen(pathbuf, mode);
+    get_path(pathbuf, ns->name, "json");
+
+    FILE *fp = fopen(pathbuf, "rb");
     if (!fp)
+        return;
+
+    RG_LOGI("Importing %s\n", pathbuf);
+    char *buffer = calloc(1, statbuf->st_size + 1);
+    cJSON *values = NULL;
+    if (buffer && fread(buffer, 1, statbuf->st_size, fp))
+        values = cJSON_Parse(buffer);
+    free(buffer);
+    fclose(fp);
+
+    if (!cJSON_IsObject(values))
+        RG_LOGE("Parse failed in config file '%s'", ns->name);
+
+    for (cJSON *item = cJSON_IsObject(values) ? values->child : NULL; item; item = item->next)
     {
-        rg_storage_mkdir(rg_dirname(pathbuf));
-        rg_storage_delete(pathbuf);
-        fp = fopen(pathbuf, mode);
+        if (cJSON_IsNumber(item))
+            update_entry(ns, item->string, KV_NUMBER, item->valuedouble, NULL);
+        else if (cJSON_IsBool(item))
+            update_entry(ns, item->string, KV_NUMBER, cJSON_IsTrue(item), NULL);
+        else if (cJSON_IsString(item))
+            update_entry(ns, item->string, KV_STRING, 0, item->valuestring);
+        else if (cJSON_IsNull(item))
+            update_entry(ns, item->string, KV_NULL, 0, NULL);
+    }
+    cJSON_Delete(values);
+
+    ns->header.json_mtime = statbuf->st_mtime;
+    ns->header.json_size = statbuf->st_size;
+    ns->compact = true; // The header must be updated
+    ns->dirty = true;
+}
+
+static kv_ns_t *load_namespace(const char *name)
+{
+    char pathbuf[RG_PATH_MAX];
+    struct stat statbuf;
+
+    kv_ns_t *ns = calloc(1, sizeof(kv_ns_t));
+    RG_ASSERT(ns, "Out of memory");
+    ns->name = strdup(name);
+    ns->header.magic = KV_MAGIC;
+    ns->next = namespaces;
+    namespaces = ns;
+
+    get_path(pathbuf, name, "kv");
+    FILE *fp = fopen(pathbuf, "rb");
+    if (!fp)
+    {
+        // A compaction was interrupted after removing the old file, the new one is complete
+        char tmppath[RG_PATH_MAX];
+        get_path(tmppath, name, "kv.tmp");
+        if (rename(tmppath, pathbuf) == 0)
+        {
+            RG_LOGW("Recovered config file '%s' from an interrupted compaction.\n", name);
+            fp = fopen(pathbuf, "rb");
+        }
     }
-    return fp;
+    if (fp)
+    {
+        fseek(fp, 0, SEEK_END);
+        long length = ftell(fp);
+        fseek(fp, 0, SEEK_SET);
+        uint8_t *buffer = malloc(RG_MAX(length, 1));
+        if (buffer && length >= (long)sizeof(kv_header_t) && fread(buffer, length, 1, fp))
+        {
+            memcpy(&ns->header, buffer, sizeof(kv_header_t));
+            if (ns->header.magic == KV_MAGIC)
+            {
+                load_records(ns, buffer, length);
+                ns->file_size = length;
+            }
+            else
+            {
+                RG_LOGE("Bad magic in config file '%s'", name);
+                memset(&ns->header, 0, sizeof(kv_header_t));
+                ns->header.magic = KV_MAGIC;
+                ns->dirty = ns->compact = true;
+            }
+        }
+        free(buffer);
+        fclose(fp);
+    }
+
+    get_path(pathbuf, name, "json");
+    if (stat(pathbuf, &statbuf) == 0 && ((uint32_t)statbuf.st_mtime != ns->header.json_mtime
+        || (uint32_t)statbuf.st_size != ns->header.json_size))
+        import_json(ns, &statbuf);
+
+    return ns;
 }
 
-static cJSON *json_root(const char *name, bool mode)
+static kv_ns_t *get_namespace(const char *name)
 {
-    if (!config_root)
+    if (!initialized)
         return NULL;
 
     if (name == NS_GLOBAL)
@@ -40,93 +347,157 @@ static cJSON *json_root(const char *name, bool mode)
     else if (name == NS_BOOT)
         name = "boot";
 
-    cJSON *branch = cJSON_GetObjectItem(config_root, name);
-    if (!branch)
+    if (!name)
+        return NULL;
+
+    for (kv_ns_t *ns = namespaces; ns; ns = ns->next)
     {
-        branch = cJSON_AddObjectToObject(config_root, name);
-        cJSON_AddStringToObject(branch, "namespace", name);
-        cJSON_AddNumberToObject(branch, "changed", 0);
-        FILE *fp = open_config_file(name, "rb");
-        if (fp)
+        if (strcmp(ns->name, name) == 0)
+            return ns;
+    }
+
+    return load_namespace(name);
+}
+
+static void free_namespaces(void)
+{
+    while (namespaces)
+    {
+        kv_ns_t *ns = namespaces;
+        namespaces = ns->next;
+        for (size_t i = 0; i < ns->capacity; i++)
         {
-            fseek(fp, 0, SEEK_END);
-            long length = ftell(fp);
-            fseek(fp, 0, SEEK_SET);
-            char *buffer = calloc(1, length + 1);
-            if (fread(buffer, 1, length, fp))
-            {
-                cJSON *values = cJSON_Parse(buffer);
-                if (!values)
-                {
-                    RG_LOGE("Parse failed in config file '%s'", name);
-                    values = cJSON_CreateObject();
-                }
-                cJSON_AddItemToObject(branch, "values", values);
-            }
-            free(buffer);
-            fclose(fp);
+            free_value(&ns->entries[i]);
+            free(ns->entries[i].key);
         }
+        free(ns->entries);
+        free(ns->name);
+        free(ns);
     }
+}
+
+static bool compact_namespace(kv_ns_t *ns)
+{
+    char pathbuf[RG_PATH_MAX], tmppath[RG_PATH_MAX];
+    bool success = true;
+
+    get_path(pathbuf, ns->name, "kv");
+    get_path(tmppath, ns->name, "kv.tmp");
 
-    cJSON *root = cJSON_GetObjectItem(branch, "values");
-    if (!cJSON_IsObject(root))
+    FILE *fp = fopen(tmppath, "wb");
+    if (!fp)
     {
-        cJSON_DeleteItemFromObject(branch, "values");
-        root = cJSON_AddObjectToObject(branch, "values");
+        rg_storage_mkdir(RG_BASE_PATH_CONFIG);
+        fp = fopen(tmppath, "wb");
     }
+    if (!fp)
+        return false;
 
-    if (mode)
+    success = fwrite(&ns->header, sizeof(kv_header_t), 1, fp);
+    for (size_t i = 0; i < ns->capacity && success; i++)
     {
-       cJSON_SetNumberHelper(cJSON_GetObjectItem(branch, "changed"), 1);
+        kv_entry_t *entry = &ns->entries[i];
+        if (entry->key && entry->type != KV_DELETED)
+            success = write_record(fp, entry);
     }
+    ns->file_size = ftell(fp);
+    success = (fclose(fp) == 0) && success;
 
-    return root;
+    // FAT can't rename over an existing file. If we die between the delete and the rename,
+    // load_namespace picks up the complete .kv.tmp.
+    if (success && rename(tmppath, pathbuf) != 0)
+    {
+        rg_storage_delete(pathbuf);
+        success = rename(tmppath, pathbuf) == 0;
+    }
+
+    return success;
 }
 
-static void update_value(const char *section, const char *key, cJSON *new_value)
+static bool append_namespace(kv_ns_t *ns)
 {
-    cJSON *obj = cJSON_GetObjectItem(json_root(section, 0), key);
-    if (obj == NULL)
-        cJSON_AddItemToObject(json_root(section, 1), key, new_value);
-    else if (!cJSON_Compare(obj, new_value, true))
-        cJSON_ReplaceItemInObject(json_root(section, 1), key, new_value);
-    else
-        cJSON_Delete(new_value);
+    char pathbuf[RG_PATH_MAX];
+    bool success = true;
+
+    get_path(pathbuf, ns->name, "kv");
+    FILE *fp = fopen(pathbuf, "ab");
+    if (!fp)
+        return false;
+
+    for (size_t i = 0; i < ns->capacity && success; i++)
+    {
+        kv_entry_t *entry = &ns->entries[i];
+        if (entry->key && entry->dirty)
+            success = write_record(fp, entry);
+    }
+    ns->file_size = ftell(fp);
+    success = (fclose(fp) == 0) && success;
+
+    return success;
+}
+
+static void set_value(const char *section, const char *key, int type, double number, const char *string)
+{
+    kv_ns_t *ns = get_namespace(section);
+    if (!ns || !key)
+        return;
+
+    kv_entry_t *entry = update_entry(ns, key, type, number, string);
+    if (entry)
+    {
+        entry->dirty = true;
+        ns->dirty = true;
+    }
 }
 
 void rg_settings_init(void)
 {
-    config_root = cJSON_CreateObject();
-    json_root(NS_GLOBAL, 0);
-    json_root(NS_BOOT, 0);
+    free_namespaces();
+    initialized = true;
+    get_namespace(NS_GLOBAL);
+    get_namespace(NS_BOOT);
 }
 
 void rg_settings_commit(void)
 {
-    if (!config_root)
+    if (!initialized)
         return;
 
-    for (cJSON *branch = config_root->child; branch; branch = branch->next)
+    for (kv_ns_t *ns = namespaces; ns; ns = ns->next)
     {
-        char *name = cJSON_GetStringValue(cJSON_GetObjectItem(branch, "namespace"));
-        int changed = cJSON_GetNumberValue(cJSON_GetObjectItem(branch, "changed"));
-
-        if (!changed)
+        if (!ns->dirty)
             continue;
 
-        char *buffer = cJSON_Print(cJSON_GetObjectItem(branch, "values"));
-        if (!buffer)
-            continue;
+        // Rewrite the whole file once stale records make up more than half of it
+        size_t live_size = sizeof(kv_header_t);
+        for (size_t i = 0; i < ns->capacity; i++)
+        {
+            if (ns->entries[i].key && ns->entries[i].type != KV_DELETED)
+                live_size += record_size(&ns->entries[i]);
+        }
+        if (ns->file_size < sizeof(kv_header_t) || ns->file_size > live_size * 2 + 512)
+            ns->compact = true;
 
-        FILE *fp = open_config_file(name, "wb");
-        if (fp)
+        bool success;
+        if (ns->compact)
+        {
+            RG_LOGI("Compacting '%s' (%d => %d bytes)\n", ns->name, (int)ns->file_size, (int)live_size);
+            success = compact_namespace(ns);
+        }
+        else
         {
-            if (fputs(buffer, fp) >= 0)
-                cJSON_SetNumberHelper(cJSON_GetObjectItem(branch, "changed"), 0);
-            fclose(fp);
+            success = append_namespace(ns);
         }
 
-        cJSON_free(buffer);
+        if (!success)
+        {
+            RG_LOGE("Failed to save config file '%s'\n", ns->name);
+            continue;
+        }
+
+        for (size_t i = 0; i < ns->capacity; i++)
+            ns->entries[i].dirty = false;
+        ns->dirty = ns->compact = false;
     }
 
     rg_storage_commit();
@@ -137,38 +508,35 @@ void rg_settings_reset(void)
     RG_LOGI("Clearing settings...\n");
     rg_storage_delete(RG_BASE_PATH_CONFIG);
     rg_storage_mkdir(RG_BASE_PATH_CONFIG);
-    if (config_root)
-    {
-        cJSON_Delete(config_root);
-        config_root = cJSON_CreateObject();
-    }
+    free_namespaces();
 }
 
 double rg_settings_get_number(const char *section, const char *key, double default_value)
 {
-    cJSON *obj = cJSON_GetObjectItem(json_root(section, 0), key);
-    return obj ? obj->valuedouble : default_value;
+    kv_entry_t *entry = lookup(get_namespace(section), key);
+    return (entry && entry->type == KV_NUMBER) ? entry->number : default_value;
 }
 
 void rg_settings_set_number(const char *section, const char *key, double value)
 {
-    update_value(section, key, cJSON_CreateNumber(value));
+    set_value(section, key, KV_NUMBER, value, NULL);
 }
 
 char *rg_settings_get_string(const char *section, const char *key, const char *default_value)
 {
-    cJSON *obj = cJSON_GetObjectItem(json_root(section, 0), key);
-    if (cJSON_IsString(obj))
-        return strdup(obj->valuestring);
+    kv_entry_t *entry = lookup(get_namespace(section), key);
+    if (entry && entry->type == KV_STRING)
+        return strdup(entry->string);
     return default_value ? strdup(default_value) : NULL;
 }
 
 void rg_settings_set_string(const char *section, const char *key, const char *value)
 {
-    update_value(section, key, value ? cJSON_CreateString(value) : cJSON_CreateNull());
+    set_value(section, key, value ? KV_STRING : KV_NULL, 0, value);
 }
 
 void rg_settings_delete(const char *section, const char *key)
 {
-    cJSON_DeleteItemFromObject(json_root(section, 1), key);
+    if (lookup(get_namespace(section), key))
+        set_value(section, key, KV_DELETED, 0, NULL);
 }
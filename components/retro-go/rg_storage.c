@@ -16,6 +16,9 @@
 
 #if defined(__MINGW32__) || defined(__MINGW64__)
 #define mkdir(A, B) mkdir(A)
+#elif defined(RG_TARGET_SDL2)
+#include <sys/mman.h>
+#define USE_MMAP 1
 #endif
 
 static bool disk_mounted = false;
@@ -347,3 +350,271 @@ rg_scandir_t *rg_storage_scandir(const char *path, bool (*validator)(const char
 
     return results;
 }
+
+// Block compressed container, produced by tools/rgz.py (little endian):
+//   header:  magic "RGZB", version:U8, block_shift:U8, reserved:U16, size:U32, crc32:U32
+//   offsets: U32 * (block_count + 1), file offset of each block (the last one marks the end)
+//   blocks:  LZ4 blocks, or raw data when a block didn't compress (stored size == block size)
+#define RGZ_MAGIC 0x425A4752
+typedef struct __attribute__((packed))
+{
+    uint32_t magic;
+    uint8_t version;
+    uint8_t block_shift;
+    uint16_t reserved;
+    uint32_t size;
+    uint32_t crc32;
+} rgz_header_t;
+
+struct rg_reader_s
+{
+    FILE *fp;
+    size_t size;
+    uint32_t *offsets; // NULL when the file isn't compressed
+    size_t block_size, block_count;
+    uint8_t *block;    // Last decompressed block, for partial reads
+    int cached_block;
+    uint8_t *packed;
+};
+
+rg_reader_t *rg_storage_reader_open(const char *path)
+{
+    RG_ASSERT(path, "Bad param");
+    rgz_header_t header = {0};
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return NULL;
+
+    rg_reader_t *reader = calloc(1, sizeof(rg_reader_t));
+    if (!reader)
+    {
+        RG_LOGE("Memory allocation failed!\n");
+        fclose(fp);
+        return NULL;
+    }
+    reader->fp = fp;
+    reader->cached_block = -1;
+
+    if (fread(&header, sizeof(header), 1, fp) && header.magic == RGZ_MAGIC)
+    {
+        if (header.version != 1 || header.block_shift < 10 || header.block_shift > 20)
+        {
+            RG_LOGE("Unsupported container '%s' (version %d, block_shift %d)\n", path,
+                    header.version, header.block_shift);
+            rg_storage_reader_close(reader);
+            return NULL;
+        }
+        reader->size = header.size;
+        reader->block_size = 1 << header.block_shift;
+        reader->block_count = (header.size + reader->block_size - 1) >> header.block_shift;
+        reader->offsets = malloc((reader->block_count + 1) * 4);
+        reader->block = malloc(reader->block_size);
+        reader->packed = malloc(reader->block_size);
+        if (!reader->offsets || !reader->block || !reader->packed
+            || fread(reader->offsets, 4, reader->block_count + 1, fp) != reader->block_count + 1)
+        {
+            RG_LOGE("Failed to read the block table of '%s'\n", path);
+            rg_storage_reader_close(reader);
+            return NULL;
+        }
+        RG_LOGI("Opened '%s': %d bytes in %d blocks of %dKB\n", path, (int)reader->size,
+                (int)reader->block_count, (int)reader->block_size / 1024);
+    }
+    else
+    {
+        fseek(fp, 0, SEEK_END);
+        reader->size = ftell(fp);
+    }
+
+    return reader;
+}
+
+// Decompresses block into dest, which must hold block_size bytes
+static bool reader_load_block(rg_reader_t *reader, size_t block, uint8_t *dest)
+{
+    size_t offset = reader->offsets[block];
+    size_t packed_size = reader->offsets[block + 1] - offset;
+    size_t block_size = RG_MIN(reader->block_size, reader->size - block * reader->block_size);
+
+    if (packed_size > reader->block_size || fseek(reader->fp, offset, SEEK_SET) != 0)
+        return false;
+
+    // A block that didn't compress is stored as is
+    if (packed_size == block_size)
+        return fread(dest, block_size, 1, reader->fp) == 1;
+
+    if (fread(reader->packed, packed_size, 1, reader->fp) != 1)
+        return false;
+
+    return rg_lz4_decompress(reader->packed, packed_size, dest, block_size) == (int)block_size;
+}
+
+size_t rg_storage_reader_read(rg_reader_t *reader, size_t offset, void *buffer, size_t length)
+{
+    RG_ASSERT(reader && buffer, "Bad param");
+
+    if (offset >= reader->size)
+        return 0;
+
+    length = RG_MIN(length, reader->size - offset);
+
+    if (!reader->offsets)
+    {
+        if (fseek(reader->fp, offset, SEEK_SET) != 0)
+            return 0;
+        return fread(buffer, 1, length, reader->fp);
+    }
+
+    uint8_t *dest = buffer;
+    size_t remaining = length;
+
+    while (remaining > 0)
+    {
+        size_t block = offset / reader->block_size;
+        size_t block_offset = offset % reader->block_size;
+        size_t block_size = RG_MIN(reader->block_size, reader->size - block * reader->block_size);
+        size_t count = RG_MIN(remaining, block_size - block_offset);
+
+        if (count == block_size && (int)block != reader->cached_block)
+        {
+            // Whole block (bank loads are usually aligned), decompress straight into the buffer
+            if (!reader_load_block(reader, block, dest))
+                break;
+        }
+        else
+        {
+            if ((int)block != reader->cached_block)
+            {
+                reader->cached_block = -1;
+                if (!reader_load_block(reader, block, reader->block))
+                    break;
+                reader->cached_block = block;
+            }
+            memcpy(dest, reader->block + block_offset, count);
+        }
+
+        dest += count;
+        offset += count;
+        remaining -= count;
+    }
+
+    if (remaining > 0)
+        RG_LOGE("Failed to read block at offset %d\n", (int)offset);
+
+    return length - remaining;
+}
+
+size_t rg_storage_reader_size(rg_reader_t *reader)
+{
+    return reader ? reader->size : 0;
+}
+
+bool rg_storage_reader_is_compressed(rg_reader_t *reader)
+{
+    return reader && reader->offsets;
+}
+
+void rg_storage_reader_close(rg_reader_t *reader)
+{
+    if (!reader)
+        return;
+    if (reader->fp)
+        fclose(reader->fp);
+    free(reader->offsets);
+    free(reader->block);
+    free(reader->packed);
+    free(reader);
+}
+
+// Files mapped by rg_storage_map, so that rg_storage_unmap knows how to release them
+#define MAX_MAPPINGS 8
+static struct
+{
+    void *data;
+    size_t size;
+    bool mmapped;
+} mappings[MAX_MAPPINGS];
+
+void *rg_storage_map(const char *path, size_t *size, uint32_t flags)
+{
+    RG_ASSERT(path, "Bad param");
+    void *data = NULL;
+    size_t data_len = 0;
+    bool mmapped = false;
+    int slot = 0;
+
+    while (slot < MAX_MAPPINGS && mappings[slot].data)
+        slot++;
+    if (slot == MAX_MAPPINGS)
+    {
+        RG_LOGE("Too many mapped files, can't map '%s'\n", path);
+        return NULL;
+    }
+
+    rg_reader_t *reader = rg_storage_reader_open(path);
+    if (!reader)
+        return NULL;
+
+    data_len = rg_storage_reader_size(reader);
+
+#ifdef USE_MMAP
+    // Private and writable so that cores patching their ROM get copy-on-write pages
+    if (!rg_storage_reader_is_compressed(reader) && data_len > 0)
+    {
+        data = mmap(NULL, data_len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(reader->fp), 0);
+        if (data == MAP_FAILED)
+            data = NULL;
+        mmapped = data != NULL;
+    }
+#endif
+
+    if (!data && !(flags & RG_MAP_NO_COPY))
+    {
+        if (!(data = malloc(RG_MAX(data_len, 1))))
+            RG_LOGE("Memory allocation failed (%d bytes)!\n", (int)data_len);
+        else if (rg_storage_reader_read(reader, 0, data, data_len) != data_len)
+        {
+            RG_LOGE("Read failed for '%s'\n", path);
+            free(data);
+            data = NULL;
+        }
+    }
+
+    rg_storage_reader_close(reader);
+
+    if (!data)
+        return NULL;
+
+    mappings[slot].data = data;
+    mappings[slot].size = data_len;
+    mappings[slot].mmapped = mmapped;
+
+    RG_LOGI("Mapped '%s' (%d bytes, %s)\n", path, (int)data_len, mmapped ? "mmap" : "copy");
+
+    if (size)
+        *size = data_len;
+    return data;
+}
+
+void rg_storage_unmap(void *data)
+{
+    if (!data)
+        return;
+
+    for (int i = 0; i < MAX_MAPPINGS; i++)
+    {
+        if (mappings[i].data != data)
+            continue;
+    #ifdef USE_MMAP
+        if (mappings[i].mmapped)
+            munmap(data, mappings[i].size);
+        else
+    #endif
+            free(data);
+        mappings[i].data = NULL;
+        return;
+    }
+
+    RG_LOGE("%p isn't a mapped file!\n", data);
+}
@@ -24,12 +24,20 @@ typedef struct __attribute__((packed))
     int32_t mtime, size;
 } rg_scandir_t;
 
+// Random access reader that transparently handles block compressed ROMs (see tools/rgz.py)
+typedef struct rg_reader_s rg_reader_t;
+
 enum
 {
     RG_SCANDIR_STAT = 1, // This will populate file size
     RG_SCANDIR_SORT = 2, // This will sort using natural order
 };
 
+enum
+{
+    RG_MAP_NO_COPY = 1, // Fail instead of reading the file into memory when it can't be mapped
+};
+
 void rg_storage_init(void);
 void rg_storage_deinit(void);
 bool rg_storage_format(void);
@@ -42,3 +50,11 @@ bool rg_storage_write_file(const char *path, const void *data_ptr, const size_t
 bool rg_storage_delete(const char *path);
 bool rg_storage_mkdir(const char *dir);
 rg_scandir_t *rg_storage_scandir(const char *path, bool (*validator)(const char *path), uint32_t flags);
+rg_reader_t *rg_storage_reader_open(const char *path);
+size_t rg_storage_reader_read(rg_reader_t *reader, size_t offset, void *buffer, size_t length);
+size_t rg_storage_reader_size(rg_reader_t *reader);
+bool rg_storage_reader_is_compressed(rg_reader_t *reader);
+void rg_storage_reader_close(rg_reader_t *reader);
+// Maps a whole file (mmap on POSIX hosts, else a copy in memory). Writes are private to the process.
+void *rg_storage_map(const char *path, size_t *size, uint32_t flags);
+void rg_storage_unmap(void *data);
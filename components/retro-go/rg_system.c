@@ -44,10 +44,36 @@ typedef struct
     logbuf_t logbuf;
 } panic_trace_t;
 
+// Log messages are queued by the caller and written out by the rg_log task, so that a slow
+// console (115200 baud UART on device) never stalls emulation. Records never wrap around the
+// end of the ring, a padding record fills the gap instead.
+#define RG_LOGRING_SIZE 4096
+#define RG_LOGRING_MAX_ARGS 12
+typedef union
+{
+    long long i;
+    double d;
+    const void *p;
+} logarg_t;
+
+typedef struct
+{
+    uint32_t seq;   // Position of the record in the ring (| 1), written last by the producer
+    uint16_t size;  // Whole record, including padding
+    uint8_t level;
+    uint8_t nargs;  // LOGREC_TEXT: payload is a formatted string, LOGREC_PAD: skip
+    const char *context;
+    const char *format;
+    logarg_t args[];
+} logrec_t;
+
+#define LOGREC_TEXT 0xFF
+#define LOGREC_PAD 0xFE
+
 typedef struct
 {
     int32_t totalFrames, fullFrames, ticks;
-    int64_t busyTime, updateTime;
+    int64_t busyTime, runAheadTime, renderTime, updateTime;
 } counters_t;
 
 typedef struct
@@ -73,13 +99,44 @@ static struct
 } *profile;
 #endif
 
+#ifdef RG_ENABLE_MEMTRACE
+#ifndef RG_MEMTRACE_WINDOW
+#define RG_MEMTRACE_WINDOW 60
+#endif
+typedef struct
+{
+    const char *name;
+    uint32_t base;
+    int shift;
+    uint32_t outside; // Accesses beyond the last slot
+    uint32_t reads[RG_MEMTRACE_SLOTS];
+    uint32_t writes[RG_MEMTRACE_SLOTS];
+} memtrace_region_t;
+
+static memtrace_region_t *memtrace;
+#endif
+
 // The trace will survive a software reset
 static RTC_NOINIT_ATTR panic_trace_t panicTrace;
 static RTC_NOINIT_ATTR time_t rtcValue;
 static rg_stats_t statistics;
 static rg_app_t app;
 static logbuf_t logbuf;
+static struct
+{
+    uint32_t head, tail, dropped, draining;
+    bool running;
+    char last[300];
+    int repeats;
+    int64_t lastTime;
+    __attribute__((aligned(8))) uint8_t buffer[RG_LOGRING_SIZE];
+} logring;
 static rg_task_t tasks[8];
+static struct
+{
+    void *buffer;
+    size_t size;
+} snapshot;
 static int ledValue = -1;
 static int wdtCounter = 0;
 static bool exitCalled = false;
@@ -88,6 +145,10 @@ static const char *SETTING_BOOT_NAME = "BootName";
 static const char *SETTING_BOOT_ARGS = "BootArgs";
 static const char *SETTING_BOOT_FLAGS = "BootFlags";
 static const char *SETTING_TIMEZONE = "Timezone";
+static const char *SETTING_RUN_AHEAD = "RunAhead";
+
+#define SNAPSHOT_MIN_SIZE (64 * 1024)
+#define SNAPSHOT_MAX_SIZE (1024 * 1024)
 
 #define WDT_TIMEOUT 10000000
 #define WDT_RELOAD(val) wdtCounter = (val)
@@ -95,6 +156,300 @@ static const char *SETTING_TIMEZONE = "Timezone";
 #define logbuf_putc(buf, c) (buf)->buffer[(buf)->cursor++] = c, (buf)->cursor %= RG_LOGBUF_SIZE;
 #define logbuf_puts(buf, str) for (const char *ptr = str; *ptr; ptr++) logbuf_putc(buf, *ptr);
 
+typedef struct
+{
+    const char *start, *end; // Conversion spec, including the '%'
+    char conv;
+    char length; // 0, 'h', 'l', 'q' (ll), 'z', 'j', 't', 'L'
+    int stars;
+} logspec_t;
+
+// Finds the next conversion in format, returns false at the end of the string.
+static bool log_next_spec(const char **format, logspec_t *spec)
+{
+    const char *ptr = *format;
+
+    while ((ptr = strchr(ptr, '%')) && ptr[1] == '%')
+        ptr += 2;
+    if (!ptr)
+        return false;
+
+    *spec = (logspec_t){ptr++, NULL, 0, 0, 0};
+    while (*ptr && strchr("-+ #0'", *ptr))
+        ptr++;
+    for (; *ptr == '*' || *ptr == '.' || (*ptr >= '0' && *ptr <= '9'); ptr++)
+        spec->stars += (*ptr == '*');
+    if (*ptr == 'h' || *ptr == 'l')
+    {
+        spec->length = (ptr[1] == *ptr) ? (*ptr == 'l' ? 'q' : 'h') : *ptr;
+        ptr += (ptr[1] == *ptr) ? 2 : 1;
+    }
+    else if (*ptr && strchr("qzjtL", *ptr))
+        spec->length = *ptr++;
+    spec->conv = *ptr;
+    spec->end = *ptr ? ptr + 1 : ptr;
+    *format = spec->end;
+    return true;
+}
+
+// Captures the arguments of a constant format string so that it can be formatted later by the
+// log task. Strings (and anything else that may not outlive the call) can't be deferred.
+static int log_capture_args(const char *format, va_list va, logarg_t *args)
+{
+    logspec_t spec;
+    int nargs = 0;
+
+    while (log_next_spec(&format, &spec))
+    {
+        if (nargs + spec.stars + 1 > RG_LOGRING_MAX_ARGS)
+            return -1;
+        for (int i = 0; i < spec.stars; i++)
+            args[nargs++].i = va_arg(va, int);
+        if (spec.conv && strchr("diouxXc", spec.conv))
+        {
+            switch (spec.length)
+            {
+            case 'l': args[nargs++].i = va_arg(va, long); break;
+            case 'q': args[nargs++].i = va_arg(va, long long); break;
+            case 'z': args[nargs++].i = va_arg(va, size_t); break;
+            case 'j': args[nargs++].i = va_arg(va, intmax_t); break;
+            case 't': args[nargs++].i = va_arg(va, ptrdiff_t); break;
+            case 'L': return -1;
+            default:  args[nargs++].i = va_arg(va, int); break;
+            }
+        }
+        else if (spec.conv && strchr("fFeEgGaA", spec.conv) && spec.length != 'L')
+            args[nargs++].d = va_arg(va, double);
+        else if (spec.conv == 'p')
+            args[nargs++].p = va_arg(va, void *);
+        else
+            return -1;
+    }
+
+    return nargs;
+}
+
+static size_t log_render_args(char *buffer, size_t size, const char *format, const logarg_t *args)
+{
+    const char *prev = format;
+    size_t len = 0;
+    logspec_t spec;
+    char conv[32];
+
+    while (len < size - 1)
+    {
+        bool more = log_next_spec(&format, &spec);
+        const char *end = more ? spec.start : prev + strlen(prev);
+
+        // Copy the literal text up to the conversion, "%%" included
+        for (; prev < end && len < size - 1; prev++)
+        {
+            buffer[len++] = *prev;
+            if (prev[0] == '%' && prev[1] == '%')
+                prev++;
+        }
+        buffer[len] = 0;
+
+        if (!more || len >= size - 1)
+            break;
+        prev = spec.end;
+
+        // Inline the '*' width/precision arguments, snprintf then only needs the value
+        size_t pos = 0;
+        for (const char *ptr = spec.start; ptr < spec.end && pos < sizeof(conv) - 12; ptr++)
+        {
+            if (*ptr == '*')
+            {
+                int value = (int)(args++)->i;
+                if (ptr[-1] != '.' || value >= 0)
+                    pos += sprintf(conv + pos, "%d", value);
+                else
+                    pos--; // A negative precision is the same as none
+            }
+            else
+                conv[pos++] = *ptr;
+        }
+        conv[pos] = 0;
+
+        if (spec.conv == 'p')
+            len += snprintf(buffer + len, size - len, conv, args->p);
+        else if (strchr("fFeEgGaA", spec.conv))
+            len += snprintf(buffer + len, size - len, conv, args->d);
+        else if (spec.length == 'l')
+            len += snprintf(buffer + len, size - len, conv, (long)args->i);
+        else if (spec.length == 'q')
+            len += snprintf(buffer + len, size - len, conv, (long long)args->i);
+        else if (spec.length == 'z')
+            len += snprintf(buffer + len, size - len, conv, (size_t)args->i);
+        else if (spec.length == 'j')
+            len += snprintf(buffer + len, size - len, conv, (intmax_t)args->i);
+        else if (spec.length == 't')
+            len += snprintf(buffer + len, size - len, conv, (ptrdiff_t)args->i);
+        else
+            len += snprintf(buffer + len, size - len, conv, (int)args->i);
+        args++;
+    }
+
+    return RG_MIN(len, size - 1);
+}
+
+static size_t log_prefix(char *buffer, size_t size, int level, const char *context)
+{
+    const char *levels[RG_LOG_MAX] = {NULL, "=", "error", "warn", "info", "debug"};
+    size_t len = 0;
+
+    if (level > RG_LOG_PRINT && level < RG_LOG_MAX)
+    {
+        if (levels[level])
+            len += snprintf(buffer + len, size - len, "[%s] ", levels[level]);
+        if (context)
+            len += snprintf(buffer + len, size - len, "%.64s: ", context);
+    }
+
+    return len;
+}
+
+static size_t log_terminate(char *buffer, size_t len, size_t size)
+{
+    len = RG_MIN(len, size - 2);
+
+    // Append a newline if needed only when possible
+    if (len > 0 && buffer[len - 1] != '\n')
+    {
+        buffer[len++] = '\n';
+        buffer[len] = 0;
+    }
+
+    return len;
+}
+
+static void log_write(const char *line)
+{
+    int64_t now = rg_system_timer();
+
+    // Collapse identical consecutive lines (a core logging every bank switch, for example)
+    if (line && strcmp(line, logring.last) == 0)
+    {
+        if (logring.repeats++ == 0)
+            logring.lastTime = now;
+        if (now - logring.lastTime < 1000000)
+            return;
+    }
+
+    if (logring.repeats > 0)
+    {
+        char buffer[48];
+        snprintf(buffer, sizeof(buffer), "(last message repeated %d times)\n", logring.repeats);
+        logbuf_puts(&logbuf, buffer);
+        fputs(buffer, stdout);
+        logring.repeats = 0;
+        logring.lastTime = now;
+    }
+
+    if (line && strcmp(line, logring.last) != 0)
+    {
+        logbuf_puts(&logbuf, line);
+        fputs(line, stdout);
+        strcpy(logring.last, line);
+    }
+}
+
+// Reserves a record in the ring, returns NULL if the message must be dropped.
+static logrec_t *log_reserve(size_t payload, uint32_t *seq)
+{
+    size_t size = (sizeof(logrec_t) + payload + 7) & ~7;
+    uint32_t head, pad;
+
+    do
+    {
+        head = __atomic_load_n(&logring.head, __ATOMIC_RELAXED);
+        uint32_t tail = __atomic_load_n(&logring.tail, __ATOMIC_ACQUIRE);
+        uint32_t offset = head % RG_LOGRING_SIZE;
+        pad = (offset + size > RG_LOGRING_SIZE) ? RG_LOGRING_SIZE - offset : 0;
+        if (head + pad + size - tail > RG_LOGRING_SIZE)
+        {
+            __atomic_add_fetch(&logring.dropped, 1, __ATOMIC_RELAXED);
+            return NULL;
+        }
+    } while (!__atomic_compare_exchange_n(&logring.head, &head, head + pad + size, true,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+    if (pad)
+    {
+        logrec_t *rec = (logrec_t *)&logring.buffer[head % RG_LOGRING_SIZE];
+        rec->size = pad;
+        rec->nargs = LOGREC_PAD;
+        __atomic_store_n(&rec->seq, head | 1, __ATOMIC_RELEASE);
+        head += pad;
+    }
+
+    logrec_t *rec = (logrec_t *)&logring.buffer[head % RG_LOGRING_SIZE];
+    rec->size = size;
+    *seq = head | 1;
+    return rec;
+}
+
+// Writes out everything queued so far. Only one thread drains at a time, unless force is set
+// (panic), in which case whoever holds the ring is about to die anyway.
+static void log_flush(bool force)
+{
+    if (__atomic_exchange_n(&logring.draining, 1, __ATOMIC_ACQUIRE) && !force)
+        return;
+
+    char buffer[300];
+    uint32_t tail = logring.tail;
+    uint32_t dropped = 0;
+
+    while (tail != __atomic_load_n(&logring.head, __ATOMIC_ACQUIRE))
+    {
+        logrec_t *rec = (logrec_t *)&logring.buffer[tail % RG_LOGRING_SIZE];
+        if (__atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE) != (tail | 1))
+            break; // The producer hasn't finished writing it yet
+
+        if (rec->nargs == LOGREC_TEXT)
+            log_write((const char *)rec->args);
+        else if (rec->nargs != LOGREC_PAD)
+        {
+            size_t len = log_prefix(buffer, sizeof(buffer), rec->level, rec->context);
+            len += log_render_args(buffer + len, sizeof(buffer) - len, rec->format, rec->args);
+            log_terminate(buffer, len, sizeof(buffer));
+            log_write(buffer);
+        }
+
+        // Clear it so that leftovers can't pass for a record header on the next lap
+        tail += rec->size;
+        memset(rec, 0, rec->size);
+        __atomic_store_n(&logring.tail, tail, __ATOMIC_RELEASE);
+    }
+
+    if ((dropped = __atomic_exchange_n(&logring.dropped, 0, __ATOMIC_RELAXED)))
+    {
+        statistics.droppedLogs += dropped;
+        snprintf(buffer, sizeof(buffer), "(%d log messages dropped)\n", (int)dropped);
+        log_write(buffer);
+    }
+    else if (logring.repeats > 0 && rg_system_timer() - logring.lastTime > 1000000)
+        log_write(NULL);
+
+    #ifdef RG_TARGET_SDL2
+    fflush(stdout);
+    #endif
+
+    __atomic_store_n(&logring.draining, 0, __ATOMIC_RELEASE);
+}
+
+static void log_task(void *arg)
+{
+    while (!exitCalled)
+    {
+        log_flush(false);
+        rg_task_delay(10);
+    }
+    logring.running = false;
+    log_flush(false);
+    rg_task_delete(NULL);
+}
+
 
 void rg_system_load_time(void)
 {
@@ -194,11 +549,15 @@ static void update_statistics(void)
     counters.totalFrames = display.totalFrames;
     counters.fullFrames = display.fullFrames;
     counters.busyTime = statistics.busyTime;
+    counters.runAheadTime = statistics.runAheadTime;
+    counters.renderTime = display.renderTime;
     counters.ticks = statistics.ticks;
     counters.updateTime = rg_system_timer();
 
     float elapsedTime = (counters.updateTime - previous.updateTime) / 1000000.f;
     statistics.busyPercent = RG_MIN((counters.busyTime - previous.busyTime) / (elapsedTime * 1000000.f) * 100.f, 100.f);
+    statistics.runAheadPercent = RG_MIN((counters.runAheadTime - previous.runAheadTime) / (elapsedTime * 1000000.f) * 100.f, 100.f);
+    statistics.renderPercent = RG_MIN((counters.renderTime - previous.renderTime) / (elapsedTime * 1000000.f) * 100.f, 100.f);
     statistics.totalFPS = (counters.ticks - previous.ticks) / elapsedTime;
     statistics.skippedFPS = statistics.totalFPS - ((counters.totalFrames - previous.totalFrames) / elapsedTime);
     statistics.fullFPS = (counters.fullFrames - previous.fullFrames) / elapsedTime;
@@ -234,19 +593,32 @@ static void system_monitor_task(void *arg)
                 rg_system_set_led((ledState = 0));
         }
 
-        RG_LOGX("STACK:%d, HEAP:%d+%d (%d+%d), BUSY:%.2f, FPS:%.2f (SKIP:%d, PART:%d, FULL:%d), BATT:%.2f\n",
+        RG_LOGX("STACK:%d, HEAP:%d+%d (%d+%d), BUSY:%.2f (AHEAD:%.2f, LCD:%.2f), FPS:%.2f (SKIP:%d, PART:%d, FULL:%d), BATT:%.2f\n",
             statistics.freeStackMain,
             statistics.freeMemoryInt / 1024,
             statistics.freeMemoryExt / 1024,
             statistics.freeBlockInt / 1024,
             statistics.freeBlockExt / 1024,
             statistics.busyPercent,
+            statistics.runAheadPercent,
+            statistics.renderPercent,
             statistics.totalFPS,
             (int)(statistics.skippedFPS + 0.9f),
             (int)(statistics.totalFPS - statistics.skippedFPS - statistics.fullFPS + 0.9f),
             (int)(statistics.fullFPS + 0.9f),
             batteryPercent);
 
+        if ((numLoop % 10) == 9)
+        {
+            rg_input_counters_t input = rg_input_get_counters();
+            if (input.presses > 0)
+                RG_LOGX("INPUT: PRESSES:%d, LATENCY:%.2fms (MAX:%.2fms), HIST:%d/%d/%d/%d/%d/%d/%d/%d, DROPPED:%d\n",
+                    (int)input.presses, input.latencyTotal / input.presses / 1000.f, input.latencyMax / 1000.f,
+                    (int)input.latency[0], (int)input.latency[1], (int)input.latency[2], (int)input.latency[3],
+                    (int)input.latency[4], (int)input.latency[5], (int)input.latency[6], (int)input.latency[7],
+                    (int)input.eventsDropped);
+        }
+
         if ((wdtCounter -= loopTime_us) <= 0)
         {
             if ((lastLoop - statistics.lastTick) > WDT_TIMEOUT)
@@ -410,6 +782,7 @@ rg_app_t *rg_system_init(int sampleRate, const rg_handlers_t *handlers, const rg
     app.bootFlags = rg_settings_get_number(NS_BOOT, SETTING_BOOT_FLAGS, 0);
     app.saveSlot = (app.bootFlags & RG_BOOT_SLOT_MASK) >> 4;
     app.romPath = app.bootArgs;
+    app.runAhead = rg_settings_get_number(NS_APP, SETTING_RUN_AHEAD, 0);
 
     rg_display_init();
     rg_gui_init();
@@ -459,7 +832,13 @@ rg_app_t *rg_system_init(int sampleRate, const rg_handlers_t *handlers, const rg
     profile->lock = xSemaphoreCreateMutex();
 #endif
 
+#ifdef RG_ENABLE_MEMTRACE
+    RG_LOGI("Memory tracing has been enabled at compile time!\n");
+    memtrace = rg_alloc(sizeof(memtrace_region_t) * RG_MEMTRACE_REGIONS, MEM_ANY);
+#endif
+
     rg_task_create("rg_system", &system_monitor_task, NULL, 3 * 1024, RG_TASK_PRIORITY, -1);
+    logring.running = rg_task_create("rg_log", &log_task, NULL, 3 * 1024, 1, 1);
 
     app.initialized = true;
 
@@ -548,6 +927,10 @@ IRAM_ATTR void rg_system_tick(int busyTime)
     statistics.busyTime += busyTime;
     statistics.ticks++;
     // WDT_RELOAD(WDT_TIMEOUT);
+#ifdef RG_ENABLE_MEMTRACE
+    if ((statistics.ticks % RG_MEMTRACE_WINDOW) == 0)
+        rg_memtrace_dump();
+#endif
 }
 
 IRAM_ATTR int64_t rg_system_timer(void)
@@ -803,6 +1186,90 @@ rg_emu_state_t *rg_emu_get_states(const char *romPath, size_t slots)
     return result;
 }
 
+static bool emu_save_snapshot(void)
+{
+    size_t length = snapshot.size;
+
+    while (!snapshot.buffer || !app.handlers.saveSnapshot(snapshot.buffer, &length))
+    {
+        // The state size isn't known in advance, grow the buffer until it fits
+        size_t size = snapshot.size ? snapshot.size * 2 : SNAPSHOT_MIN_SIZE;
+        if (size > SNAPSHOT_MAX_SIZE)
+        {
+            RG_LOGE("Snapshot doesn't fit in %d bytes!\n", (int)snapshot.size);
+            return false;
+        }
+        free(snapshot.buffer);
+        if (!(snapshot.buffer = malloc(size)))
+        {
+            RG_LOGE("Unable to allocate %d bytes for the snapshot!\n", (int)size);
+            snapshot.size = 0;
+            return false;
+        }
+        RG_LOGI("Snapshot buffer resized to %d bytes.\n", (int)size);
+        snapshot.size = length = size;
+    }
+
+    return true;
+}
+
+void rg_emu_run_frame(rg_frame_handler_t run_frame, bool draw)
+{
+    RG_ASSERT(run_frame, "No frame handler");
+
+    // A skipped frame means we're already late, running ahead would only make it worse
+    if (!draw || app.runAhead < 1 || !app.handlers.saveSnapshot || !app.handlers.loadSnapshot)
+    {
+        run_frame(draw, true);
+        return;
+    }
+
+    // The real frame produces the audio but its video is never shown. We then
+    // snapshot, emulate the next few frames silently to display the last one,
+    // and rewind. The input thus appears on screen runAhead frames earlier.
+    run_frame(false, true);
+
+    int64_t startTime = rg_system_timer();
+
+    if (!emu_save_snapshot())
+    {
+        RG_LOGW("Snapshot failed, run-ahead disabled.\n");
+        app.runAhead = 0;
+        return;
+    }
+
+    for (int i = 1; i <= app.runAhead; i++)
+        run_frame(i == app.runAhead, false);
+
+    size_t length = snapshot.size;
+    if (!app.handlers.loadSnapshot(snapshot.buffer, &length))
+    {
+        // We can't recover from a bad rewind, the game will just run ahead of time...
+        RG_LOGE("Snapshot restore failed, run-ahead disabled.\n");
+        app.runAhead = 0;
+    }
+
+    statistics.runAheadTime += rg_system_timer() - startTime;
+}
+
+void rg_emu_set_run_ahead(int frames)
+{
+    app.runAhead = RG_MIN(RG_MAX(0, frames), RG_RUN_AHEAD_MAX_FRAMES);
+    rg_settings_set_number(NS_APP, SETTING_RUN_AHEAD, app.runAhead);
+
+    if (app.runAhead == 0)
+    {
+        free(snapshot.buffer);
+        snapshot.buffer = NULL;
+        snapshot.size = 0;
+    }
+}
+
+int rg_emu_get_run_ahead(void)
+{
+    return app.runAhead;
+}
+
 bool rg_emu_reset(bool hard)
 {
     if (app.handlers.reset)
@@ -822,6 +1289,7 @@ static void shutdown_cleanup(void)
     rg_input_deinit();                        // Now we can shutdown input
     rg_i2c_deinit();                          // Must be after input, sound, and rtc
     rg_display_deinit();                      // Do this very last to reduce flicker time
+    log_flush(false);                         // Whatever the log task didn't get to
 }
 
 void rg_system_shutdown(void)
@@ -886,6 +1354,9 @@ bool rg_system_have_app(const char *app)
 
 void rg_system_panic(const char *context, const char *message)
 {
+    // Queued messages must make it to the console and the trace before the panic message
+    logring.running = false;
+    log_flush(true);
     // Call begin_panic_trace first, it will normalize context and message for us
     begin_panic_trace(context, message);
     // Avoid using printf functions in case we're crashing because of a busted stack
@@ -899,36 +1370,55 @@ void rg_system_panic(const char *context, const char *message)
 
 void rg_system_vlog(int level, const char *context, const char *format, va_list va)
 {
-    const char *levels[RG_LOG_MAX] = {NULL, "=", "error", "warn", "info", "debug"};
-    char buffer[300];
-    size_t len = 0;
+    logarg_t args[RG_LOGRING_MAX_ARGS];
+    uint32_t seq;
+    int nargs = -1;
 
-    if (app.logLevel && level > app.logLevel)
+    if (app.logLevel && (level & ~RG_LOG_CONST) > app.logLevel)
         return;
 
-    if (level > RG_LOG_PRINT && level < RG_LOG_MAX)
+    // Constant format strings outlive us, formatting them is left to the log task
+    if ((level & RG_LOG_CONST) && logring.running)
     {
-        if (levels[level])
-            len += sprintf(buffer + len, "[%s] ", levels[level]);
-        if (context)
-            len += sprintf(buffer + len, "%s: ", context);
+        va_list copy;
+        va_copy(copy, va);
+        nargs = log_capture_args(format, copy, args);
+        va_end(copy);
     }
+    level &= ~RG_LOG_CONST;
 
-    len += vsnprintf(buffer + len, sizeof(buffer) - len, format, va);
-
-    // Append a newline if needed only when possible
-    if (len > 0 && buffer[len - 1] != '\n')
+    if (nargs >= 0)
     {
-        buffer[len++] = '\n';
-        buffer[len] = 0;
+        logrec_t *rec = log_reserve(nargs * sizeof(logarg_t), &seq);
+        if (rec)
+        {
+            rec->level = level;
+            rec->nargs = nargs;
+            rec->context = context;
+            rec->format = format;
+            memcpy(rec->args, args, nargs * sizeof(logarg_t));
+            __atomic_store_n(&rec->seq, seq, __ATOMIC_RELEASE);
+        }
+    }
+    else
+    {
+        char buffer[300];
+        size_t len = log_prefix(buffer, sizeof(buffer), level, context);
+        len += vsnprintf(buffer + len, sizeof(buffer) - len, format, va);
+        len = log_terminate(buffer, len, sizeof(buffer));
+        logrec_t *rec = log_reserve(len + 1, &seq);
+        if (rec)
+        {
+            rec->level = level;
+            rec->nargs = LOGREC_TEXT;
+            memcpy(rec->args, buffer, len + 1);
+            __atomic_store_n(&rec->seq, seq, __ATOMIC_RELEASE);
+        }
     }
 
-    logbuf_puts(&logbuf, buffer);
-    fputs(buffer, stdout);
-
-    #ifdef RG_TARGET_SDL2
-    fflush(stdout);
-    #endif
+    // Until the log task runs (boot) or once it has stopped (shutdown), the caller writes
+    if (!logring.running)
+        log_flush(false);
 }
 
 void rg_system_log(int level, const char *context, const char *format, ...)
@@ -991,6 +1481,87 @@ int rg_system_get_led(void)
     return ledValue;
 }
 
+#ifdef RG_ENABLE_MEMTRACE
+// The counters are only touched by the emulation task (accesses and the dump in rg_system_tick),
+// so no locking is needed.
+
+void rg_memtrace_region(int region, const char *name, uint32_t base, int shift)
+{
+    RG_ASSERT(memtrace && region >= 0 && region < RG_MEMTRACE_REGIONS, "Bad region");
+    memtrace_region_t *r = &memtrace[region];
+    memset(r, 0, sizeof(*r));
+    r->name = name;
+    r->base = base;
+    r->shift = shift;
+}
+
+IRAM_ATTR void rg_memtrace_access(int region, uint32_t addr, bool write)
+{
+    if (!memtrace)
+        return;
+
+    memtrace_region_t *r = &memtrace[region % RG_MEMTRACE_REGIONS];
+    uint32_t slot = (addr - r->base) >> r->shift;
+
+    if (slot >= RG_MEMTRACE_SLOTS)
+        r->outside++;
+    else if (write)
+        r->writes[slot]++;
+    else
+        r->reads[slot]++;
+}
+
+void rg_memtrace_dump(void)
+{
+    if (!memtrace)
+        return;
+
+    for (int i = 0; i < RG_MEMTRACE_REGIONS; ++i)
+    {
+        memtrace_region_t *r = &memtrace[i];
+        uint32_t reads = 0, writes = 0;
+        int top[8] = {-1, -1, -1, -1, -1, -1, -1, -1};
+
+        if (!r->name)
+            continue;
+
+        // Keep the 8 busiest slots, sorted by total accesses
+        for (int slot = 0; slot < RG_MEMTRACE_SLOTS; ++slot)
+        {
+            uint32_t count = r->reads[slot] + r->writes[slot];
+            reads += r->reads[slot];
+            writes += r->writes[slot];
+            if (count == 0)
+                continue;
+            for (int j = 0; j < 8; ++j)
+            {
+                if (top[j] < 0 || count > r->reads[top[j]] + r->writes[top[j]])
+                {
+                    memmove(&top[j + 1], &top[j], (7 - j) * sizeof(int));
+                    top[j] = slot;
+                    break;
+                }
+            }
+        }
+
+        RG_LOGX("MEMTRACE %s: reads:%u writes:%u outside:%u (%d frames)\n", r->name,
+            (unsigned)reads, (unsigned)writes, (unsigned)r->outside, RG_MEMTRACE_WINDOW);
+
+        for (int j = 0; j < 8 && top[j] >= 0; ++j)
+        {
+            uint32_t start = r->base + (top[j] << r->shift);
+            uint32_t count = r->reads[top[j]] + r->writes[top[j]];
+            RG_LOGX("  %06X-%06X  R:%-8u W:%-8u %5.1f%%\n", (unsigned)start, (unsigned)(start + (1 << r->shift) - 1),
+                (unsigned)r->reads[top[j]], (unsigned)r->writes[top[j]], count * 100.f / (reads + writes));
+        }
+
+        memset(r->reads, 0, sizeof(r->reads));
+        memset(r->writes, 0, sizeof(r->writes));
+        r->outside = 0;
+    }
+}
+#endif
+
 #ifdef RG_ENABLE_PROFILING
 // Note this profiler might be inaccurate because of:
 // https://gcc.gnu.org/bugzilla/show_bug.cgi?id=28205
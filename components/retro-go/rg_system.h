@@ -74,6 +74,7 @@ enum
     RG_LOG_INFO,
     RG_LOG_DEBUG,
     RG_LOG_MAX,
+    RG_LOG_CONST = 0x100, // Flag: the format string is a literal, formatting can be deferred
 };
 
 typedef enum
@@ -114,6 +115,10 @@ typedef void (*rg_event_handler_t)(int event, void *data);
 typedef bool (*rg_screenshot_handler_t)(const char *filename, int width, int height);
 typedef int  (*rg_mem_read_handler_t)(int addr);
 typedef int  (*rg_mem_write_handler_t)(int addr, int value);
+#define RG_RUN_AHEAD_MAX_FRAMES 4
+
+typedef bool (*rg_snapshot_handler_t)(void *buffer, size_t *length);
+typedef void (*rg_frame_handler_t)(bool draw, bool audio);
 
 typedef struct
 {
@@ -124,6 +129,8 @@ typedef struct
     rg_event_handler_t event;           // listen to retro-go system events
     rg_mem_read_handler_t memRead;      // Used by for cheats and debugging
     rg_mem_write_handler_t memWrite;    // Used by for cheats and debugging
+    rg_snapshot_handler_t saveSnapshot; // In-memory state for run-ahead (length: in=capacity, out=used)
+    rg_snapshot_handler_t loadSnapshot; // In-memory state for run-ahead (length: in=size, out=consumed)
 } rg_handlers_t;
 
 typedef struct
@@ -163,6 +170,7 @@ typedef struct
     int logLevel;
     int isLauncher;
     int saveSlot;
+    int runAhead;
     const char *romPath;
     const rg_gui_option_t *options;
     rg_handlers_t handlers;
@@ -175,7 +183,10 @@ typedef struct
     float fullFPS;
     float totalFPS;
     float busyPercent;
+    float runAheadPercent;
+    float renderPercent;
     int64_t busyTime;
+    int64_t runAheadTime;
     int64_t lastTick;
     int ticks;
     int totalMemoryInt;
@@ -185,6 +196,7 @@ typedef struct
     int freeBlockInt;
     int freeBlockExt;
     int freeStackMain;
+    int droppedLogs;
 } rg_stats_t;
 
 rg_app_t *rg_system_init(int sampleRate, const rg_handlers_t *handlers, const rg_gui_option_t *options);
@@ -222,6 +234,9 @@ bool rg_emu_load_state(uint8_t slot);
 bool rg_emu_reset(bool hard);
 bool rg_emu_screenshot(const char *filename, int width, int height);
 rg_emu_state_t *rg_emu_get_states(const char *romPath, size_t slots);
+void rg_emu_run_frame(rg_frame_handler_t run_frame, bool draw);
+void rg_emu_set_run_ahead(int frames);
+int  rg_emu_get_run_ahead(void);
 
 /* Utilities */
 
@@ -237,11 +252,21 @@ rg_emu_state_t *rg_emu_get_states(const char *romPath, size_t slots);
 #define RG_LOG_TAG __func__
 #endif
 
-#define RG_LOGX(x, ...) rg_system_log(RG_LOG_PRINT, RG_LOG_TAG, x, ## __VA_ARGS__)
-#define RG_LOGE(x, ...) rg_system_log(RG_LOG_ERROR, RG_LOG_TAG, x, ## __VA_ARGS__)
-#define RG_LOGW(x, ...) rg_system_log(RG_LOG_WARN, RG_LOG_TAG, x, ## __VA_ARGS__)
-#define RG_LOGI(x, ...) rg_system_log(RG_LOG_INFO, RG_LOG_TAG, x, ## __VA_ARGS__)
-#define RG_LOGD(x, ...) rg_system_log(RG_LOG_DEBUG, RG_LOG_TAG, x, ## __VA_ARGS__)
+#define RG_LOG_FLAGS(x) (__builtin_constant_p(x) ? RG_LOG_CONST : 0)
+#define RG_LOGX(x, ...) rg_system_log(RG_LOG_PRINT | RG_LOG_FLAGS(x), RG_LOG_TAG, x, ## __VA_ARGS__)
+#define RG_LOGE(x, ...) rg_system_log(RG_LOG_ERROR | RG_LOG_FLAGS(x), RG_LOG_TAG, x, ## __VA_ARGS__)
+#define RG_LOGW(x, ...) rg_system_log(RG_LOG_WARN | RG_LOG_FLAGS(x), RG_LOG_TAG, x, ## __VA_ARGS__)
+#define RG_LOGI(x, ...) rg_system_log(RG_LOG_INFO | RG_LOG_FLAGS(x), RG_LOG_TAG, x, ## __VA_ARGS__)
+#define RG_LOGD(x, ...) rg_system_log(RG_LOG_DEBUG | RG_LOG_FLAGS(x), RG_LOG_TAG, x, ## __VA_ARGS__)
+
+// Memory access tracing (RG_ENABLE_MEMTRACE builds only). A core registers a few regions (its whole
+// bus in coarse pages, its I/O registers one by one) and reports accesses from its bus handlers. The
+// counters are logged and cleared every RG_MEMTRACE_WINDOW frames.
+#define RG_MEMTRACE_REGIONS 8
+#define RG_MEMTRACE_SLOTS 256
+void rg_memtrace_region(int region, const char *name, uint32_t base, int shift);
+void rg_memtrace_access(int region, uint32_t addr, bool write);
+void rg_memtrace_dump(void);
 
 void __cyg_profile_func_enter(void *this_fn, void *call_site);
 void __cyg_profile_func_exit(void *this_fn, void *call_site);
@@ -106,6 +106,69 @@ uint32_t rg_crc32(uint32_t crc, const uint8_t *buf, uint32_t len)
 #endif
 }
 
+// Decodes a raw LZ4 block (no frame header). Returns the decoded size, or -1 if the block
+// is malformed or doesn't fit in dst.
+int rg_lz4_decompress(const void *src, size_t src_len, void *dst, size_t dst_len)
+{
+    const uint8_t *ip = src, *ip_end = ip + src_len;
+    uint8_t *op = dst, *op_end = op + dst_len;
+
+    while (ip < ip_end)
+    {
+        unsigned token = *ip++;
+        size_t length = token >> 4;
+
+        if (length == 15)
+        {
+            for (uint8_t byte = 255; byte == 255; length += byte)
+            {
+                if (ip >= ip_end)
+                    return -1;
+                byte = *ip++;
+            }
+        }
+
+        if (length > (size_t)(ip_end - ip) || length > (size_t)(op_end - op))
+            return -1;
+        memcpy(op, ip, length);
+        op += length;
+        ip += length;
+
+        // The last sequence only contains literals
+        if (ip >= ip_end)
+            break;
+
+        if (ip_end - ip < 2)
+            return -1;
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+
+        if (offset == 0 || offset > (size_t)(op - (uint8_t *)dst))
+            return -1;
+
+        length = token & 15;
+        if (length == 15)
+        {
+            for (uint8_t byte = 255; byte == 255; length += byte)
+            {
+                if (ip >= ip_end)
+                    return -1;
+                byte = *ip++;
+            }
+        }
+        length += 4;
+
+        if (length > (size_t)(op_end - op))
+            return -1;
+
+        // Matches can overlap the output, byte by byte is required
+        for (const uint8_t *match = op - offset; length > 0; --length)
+            *op++ = *match++;
+    }
+
+    return op - (uint8_t *)dst;
+}
+
 const char *const_string(const char *str)
 {
     static const char **strings = NULL;
@@ -22,6 +22,7 @@ const char *rg_extension(const char *path);
 const char *rg_relpath(const char *path);
 const char *const_string(const char *str);
 uint32_t rg_crc32(uint32_t crc, const uint8_t* buf, uint32_t len);
+int rg_lz4_decompress(const void *src, size_t src_len, void *dst, size_t dst_len);
 void *rg_alloc(size_t size, uint32_t caps);
 
 #define MEM_ANY   (0)
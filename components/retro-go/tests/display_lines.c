@@ -0,0 +1,117 @@
+// Host test of the specialized line renderers in rg_display_lines.h against the generic renderer.
+// It covers every source format, rotation and horizontal scaling (including the exact ratios).
+//
+// Build and run from this folder:
+//   gcc -O2 -Wall -o /tmp/display_lines display_lines.c && /tmp/display_lines
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../rg_display_lines.h"
+
+#define SRC_WIDTH 320
+#define SRC_HEIGHT 320
+
+// The renderer used by rg_display before the fetchers and scalers, one pixel at a time
+static int render_line_generic(uint16_t *dst, const uint8_t *src, int x_step, const uint16_t *palette,
+                               int format, int width, int x_inc, int screen_width, int ix_acc)
+{
+    uint16_t *start = dst;
+
+    #define RENDER_LINE(pixel) { \
+        for (int x = 0, x_acc = ix_acc; x < width;) { \
+            *dst++ = (pixel); \
+            x_acc += x_inc; \
+            while (x_acc >= screen_width) { \
+                x_acc -= screen_width; \
+                ++x; \
+            } \
+        } \
+    }
+    #define SRC_U16(x) (*(const uint16_t *)(src + (x) * x_step))
+    if (format & RG_PIXEL_PAL)
+        RENDER_LINE(palette[src[x * x_step]])
+    else if (format & RG_PIXEL_LE)
+        RENDER_LINE((uint16_t)((SRC_U16(x) << 8) | (SRC_U16(x) >> 8)))
+    else
+        RENDER_LINE(SRC_U16(x))
+    #undef SRC_U16
+    #undef RENDER_LINE
+
+    return dst - start;
+}
+
+int main(void)
+{
+    static uint8_t frame[SRC_WIDTH * SRC_HEIGHT * 2];
+    static uint16_t expected[1024], actual[1024], palette[256];
+    const int formats[] = {RG_PIXEL_565_BE, RG_PIXEL_565_LE, RG_PIXEL_PAL565_BE, RG_PIXEL_PAL565_LE};
+    const int rotations[] = {RG_DISPLAY_ROTATION_OFF, RG_DISPLAY_ROTATION_LEFT, RG_DISPLAY_ROTATION_RIGHT};
+    const int screen_widths[] = {320, 240};
+    int kernels_used[SCALE_2X + 1] = {0};
+    int cases = 0, failures = 0;
+
+    srand(1);
+    for (size_t i = 0; i < sizeof(frame); i++)
+        frame[i] = rand();
+    for (int i = 0; i < 256; i++)
+        palette[i] = rand();
+
+    for (int f = 0; f < 4; f++)
+    for (int r = 0; r < 3; r++)
+    for (int s = 0; s < 2; s++)
+    {
+        const int format = formats[f], rotation = rotations[r], screen_width = screen_widths[s];
+        const int pixlen = (format & RG_PIXEL_PAL) ? 1 : 2;
+        const int stride = SRC_WIDTH * pixlen;
+        // Same steps as source_origin() in rg_display.c, from the middle of the frame so that
+        // negative steps stay inside it
+        const int x_step = rotation == RG_DISPLAY_ROTATION_LEFT ? stride
+                         : rotation == RG_DISPLAY_ROTATION_RIGHT ? -stride : pixlen;
+        const uint8_t *origin = frame + (SRC_HEIGHT / 2) * stride + 7 * pixlen;
+
+        // From 1/3 to 3/2 of the screen per source pixel, this includes every exact ratio
+        for (int x_inc = screen_width / 3; x_inc <= screen_width * 3 / 2; x_inc++)
+        {
+            select_line_renderers(format, rotation != RG_DISPLAY_ROTATION_OFF, x_inc, screen_width);
+            kernels_used[scale_kernel]++;
+
+            // Partial updates start anywhere in the line, with the matching x_acc
+            for (int left = 0; left < 40; left += 3)
+            for (int width = 1; left + width <= 150; width += 11)
+            {
+                const int scaled_left = (screen_width * left + x_inc - 1) / x_inc;
+                const int ix_acc = (x_inc * scaled_left) % screen_width;
+                const uint8_t *src = origin + left * x_step;
+
+                int expected_len = render_line_generic(expected, src, x_step, palette, format, width,
+                                                       x_inc, screen_width, ix_acc);
+                const uint16_t *line = line_fetcher(src, x_step, width, palette);
+                int actual_len = line_scaler(actual, line, width, ix_acc) - actual;
+
+                cases++;
+                if (actual_len != expected_len || memcmp(actual, expected, expected_len * 2) != 0)
+                {
+                    if (failures++ < 10)
+                        printf("FAIL: format=%d rotation=%d screen_width=%d x_inc=%d left=%d width=%d\n",
+                               format, rotation, screen_width, x_inc, left, width);
+                }
+            }
+        }
+    }
+
+    printf("%d cases, %d failures (kernels: any=%d 1x=%d 5:4=%d 3:2=%d 2x=%d)\n", cases, failures,
+           kernels_used[SCALE_ANY], kernels_used[SCALE_1X], kernels_used[SCALE_5_4],
+           kernels_used[SCALE_3_2], kernels_used[SCALE_2X]);
+
+    for (int i = 0; i <= SCALE_2X; i++)
+    {
+        if (!kernels_used[i])
+        {
+            printf("FAIL: scale kernel %d was never selected\n", i);
+            failures++;
+        }
+    }
+
+    return failures ? 1 : 0;
+}
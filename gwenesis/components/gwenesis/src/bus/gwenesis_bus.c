@@ -57,6 +57,22 @@ void bus_log(const char *subs, const char *fmt, ...) {
 	#define bus_log(...)  do {} while(0)
 #endif
 
+#ifdef RG_ENABLE_MEMTRACE
+#include <rg_system.h>
+enum {TRACE_BUS, TRACE_VDP, TRACE_IO};
+
+static inline void bus_trace(unsigned int address, bool write) {
+  address &= 0xFFFFFF;
+  rg_memtrace_access(TRACE_BUS, address, write);
+  if ((address & 0xFF0000) == 0xC00000)
+    rg_memtrace_access(TRACE_VDP, address & 0xFF001F, write);
+  else if ((address & 0xFF0000) == 0xA10000)
+    rg_memtrace_access(TRACE_IO, address, write);
+}
+#else
+  #define bus_trace(address, write)
+#endif
+
 // Setup M68k memories ROM & RAM
 #if GNW_TARGET_MARIO != 0 | GNW_TARGET_ZELDA != 0
 
@@ -184,6 +200,12 @@ void power_on() {
   
   gwenesis_SN76489_Init(3579545, 888*60,AUDIO_FREQ_DIVISOR);
 
+#ifdef RG_ENABLE_MEMTRACE
+  rg_memtrace_region(TRACE_BUS, "68k bus", 0x000000, 16);
+  rg_memtrace_region(TRACE_VDP, "vdp ports", 0xC00000, 0);
+  rg_memtrace_region(TRACE_IO, "io/z80 ctrl", 0xA10000, 5);
+#endif
+
 }
 
 /******************************************************************************
@@ -612,6 +634,7 @@ static inline void gwenesis_bus_write_memory_16(unsigned int address,
  ******************************************************************************/
 unsigned int m68k_read_memory_8(unsigned int address)
 {
+  bus_trace(address, false);
       //  if ((address &  0xFF0000 ) == 0xFF0000) return FETCH8RAM(address);
     return gwenesis_bus_read_memory_8(address);
 }
@@ -624,6 +647,7 @@ unsigned int m68k_read_memory_8(unsigned int address)
  ******************************************************************************/
  unsigned int m68k_read_memory_16(unsigned int address)
 {
+  bus_trace(address, false);
      //   if ((address &  0xFF0000 ) == 0xFF0000) return FETCH16RAM(address);
     return gwenesis_bus_read_memory_16(address);
 }
@@ -636,6 +660,7 @@ unsigned int m68k_read_memory_8(unsigned int address)
  ******************************************************************************/
  unsigned int m68k_read_memory_32(unsigned int address)
 {
+  bus_trace(address, false);
   //  if ((address &  0xFF0000 ) == 0xFF0000) return FETCH32RAM(address);
     return (gwenesis_bus_read_memory_16(address) << 16) | gwenesis_bus_read_memory_16(address + 2);
 }
@@ -647,6 +672,7 @@ unsigned int m68k_read_memory_8(unsigned int address)
  *
  ******************************************************************************/
 void m68k_write_memory_8(unsigned int address, unsigned int value) {
+  bus_trace(address, true);
   // if ((address & 0xFF0000) == 0xFF0000) {
   //   WRITE8RAM(address, value);
   //   return;
@@ -662,6 +688,7 @@ void m68k_write_memory_8(unsigned int address, unsigned int value) {
  *
  ******************************************************************************/
 void m68k_write_memory_16(unsigned int address, unsigned int value) {
+  bus_trace(address, true);
   // if ((address & 0xFF0000) == 0xFF0000) {
   //   WRITE16RAM(address, value);
   //   return;
@@ -676,6 +703,7 @@ void m68k_write_memory_16(unsigned int address, unsigned int value) {
  *
  ******************************************************************************/
 void m68k_write_memory_32(unsigned int address, unsigned int value) {
+  bus_trace(address, true);
 
   // if ((address & 0xFF0000) == 0xFF0000) {
   //   WRITE32RAM(address, value);
@@ -701,6 +701,58 @@ void draw_line_aw(int line) {
   }
 }
 
+/******************************************************************************
+ *
+ *  Sprite to line index
+ *  Sprites are bucketed by the lines they cover, in link order, so that each
+ *  line only visits the sprites touching it. Only the Y, size and link fields
+ *  from SAT_CACHE decide the buckets: the index is rebuilt on the next line
+ *  drawn after one of them is written (see gwenesis_vdp_vram_write).
+ *
+ ******************************************************************************/
+enum { SPRITE_LINES = 240, SPRITE_LINE_SLOTS = 20 };
+
+static uint8_t sprite_lines[SPRITE_LINES][SPRITE_LINE_SLOTS];
+static uint8_t sprite_lines_count[SPRITE_LINES];
+static int sprite_lines_width;
+bool sprite_lines_dirty = true;
+
+static void build_sprite_lines(void)
+{
+  // This is both the size of the table as seen by the VDP
+  // *and* the maximum number of sprites that are processed
+  // (important in case of infinite loops in links).
+  const int SPRITE_TABLE_SIZE = (screen_width == 320) ? 80 : 64;
+  const int MAX_SPRITES_PER_LINE = (screen_width == 320) ? 20 : 16;
+
+  memset(sprite_lines_count, 0, sizeof(sprite_lines_count));
+
+  int sidx = 0;
+  for (int i = 0; i < SPRITE_TABLE_SIZE && sidx < SPRITE_TABLE_SIZE; ++i) {
+    uint8_t *cache = SAT_CACHE + sidx * 8;
+
+    int sy = (((cache[0] & 0x3) << 8) | cache[1]) - 128;
+    int sh = BITS(cache[2], 0, 2) + 1;
+    int link = BITS(cache[3], 0, 7);
+
+    int first = sy < 0 ? 0 : sy;
+    int last = sy + sh * 8 > SPRITE_LINES ? SPRITE_LINES : sy + sh * 8;
+
+    // Sprites past the per line limit are never processed, not even for overflow
+    for (int line = first; line < last; line++) {
+      if (sprite_lines_count[line] < MAX_SPRITES_PER_LINE)
+        sprite_lines[line][sprite_lines_count[line]++] = sidx;
+    }
+
+    if (link == 0)
+      break;
+    sidx = link;
+  }
+
+  sprite_lines_width = screen_width;
+  sprite_lines_dirty = false;
+}
+
 /******************************************************************************
  *
  *  Render SPRITES on screen line
@@ -720,17 +772,22 @@ void draw_sprites_over_planes(int line)
 
     uint8_t *start_table = VRAM + REG5_SAT_ADDRESS;
 
-    // This is both the size of the table as seen by the VDP
-    // *and* the maximum number of sprites that are processed
-    // (important in case of infinite loops in links).
-    const int SPRITE_TABLE_SIZE     = (screen_width == 320) ?  80 :  64;
-    const int MAX_SPRITES_PER_LINE  = (screen_width == 320) ?  20 :  16;
     const int MAX_PIXELS_PER_LINE   = (screen_width == 320) ? 320 : 256;
 
+    if (sprite_lines_dirty || sprite_lines_width != screen_width)
+        build_sprite_lines();
+
+    if (line < 0 || line >= SPRITE_LINES)
+        return;
+
+    const uint8_t *bucket = sprite_lines[line];
+    const int count = sprite_lines_count[line];
+
     bool masking = false, one_sprite_nonzero = false; // overdraw = false;
-    int sidx = 0, num_sprites = 0, num_pixels = 0;
-    for (int i = 0; (i < SPRITE_TABLE_SIZE) && sidx < (SPRITE_TABLE_SIZE); ++i)
+    int num_pixels = 0;
+    for (int n = 0; n < count; ++n)
     {
+        int sidx = bucket[n];
         uint8_t *table = start_table + sidx*8;
         uint8_t *cache = SAT_CACHE + sidx*8;
         //uint8_t *cache = start_table + sidx*8;
@@ -742,7 +799,6 @@ void draw_sprites_over_planes(int line)
 
 
         int sh = BITS(cache[2], 0, 2) + 1;
-        int link = BITS(cache[3], 0, 7);
 
         int isflipv = table[4] & 0x10;
         int isfliph = table[4] & 0x8;
@@ -750,67 +806,60 @@ void draw_sprites_over_planes(int line)
         int sw = BITS(table[2], 2, 2) + 1;
 
         sy -= 128;
-        if ((line >= sy) && (line < sy+sh*8))
-        {
-            // Sprite masking: a sprite on column 0 masks
-            // any lower-priority sprite, but with the following conditions
-            //   * it only works from the second visible sprite on each line
-            //   * if the previous line had a sprite pixel overflow, it
-            //     works even on the first sprite
-            // Notice that we need to continue parsing the table after masking
-            // to see if we reach a pixel overflow (because it would affect masking
-            // on next line).
-            if (sx == 0)
-            {
-                if (one_sprite_nonzero || (sprite_overflow == line-1))
-                    masking = true;
-            }
-            else
-                one_sprite_nonzero = true;
 
-            int row = (line - sy) >> 3;
-            int paty = (line - sy) & 7;
-            if (isflipv)
-                row = sh - row - 1;
-
-            sx -= 128;
-            if ((sx > (-sw * 8)) && (sx < screen_width) && !masking) {
+        // Sprite masking: a sprite on column 0 masks
+        // any lower-priority sprite, but with the following conditions
+        //   * it only works from the second visible sprite on each line
+        //   * if the previous line had a sprite pixel overflow, it
+        //     works even on the first sprite
+        // Notice that we need to continue parsing the table after masking
+        // to see if we reach a pixel overflow (because it would affect masking
+        // on next line).
+        if (sx == 0)
+        {
+            if (one_sprite_nonzero || (sprite_overflow == line-1))
+                masking = true;
+        }
+        else
+            one_sprite_nonzero = true;
 
-              name += row;
+        int row = (line - sy) >> 3;
+        int paty = (line - sy) & 7;
+        if (isflipv)
+            row = sh - row - 1;
 
-              if (isfliph) {
-                name += sh * (sw - 1);
-                for (int p = 0; (p < sw) && (num_pixels < MAX_PIXELS_PER_LINE); p++) {
+        sx -= 128;
+        if ((sx > (-sw * 8)) && (sx < screen_width) && !masking) {
 
-                  draw_pattern_sprite_over_planes(scr + sx + p * 8, name, paty);
-                  name -= sh;
-                  num_pixels += 8;
+          name += row;
 
-                }
-              } else {
-                for (int p = 0; (p < sw) && (num_pixels < MAX_PIXELS_PER_LINE); p++) {
+          if (isfliph) {
+            name += sh * (sw - 1);
+            for (int p = 0; (p < sw) && (num_pixels < MAX_PIXELS_PER_LINE); p++) {
 
-                  draw_pattern_sprite_over_planes(scr + sx + p * 8, name, paty);
-                  name += sh;
-                  num_pixels += 8;
+              draw_pattern_sprite_over_planes(scr + sx + p * 8, name, paty);
+              name -= sh;
+              num_pixels += 8;
 
-                }
-              }
             }
-            else
-                num_pixels += sw*8;
+          } else {
+            for (int p = 0; (p < sw) && (num_pixels < MAX_PIXELS_PER_LINE); p++) {
+
+              draw_pattern_sprite_over_planes(scr + sx + p * 8, name, paty);
+              name += sh;
+              num_pixels += 8;
 
-            if (num_pixels >= MAX_PIXELS_PER_LINE)
-            {
-                sprite_overflow = line;
-                break;
             }
-            if (++num_sprites >= MAX_SPRITES_PER_LINE)
-                break;
+          }
         }
+        else
+            num_pixels += sw*8;
 
-        if (link == 0) break;
-        sidx = link;
+        if (num_pixels >= MAX_PIXELS_PER_LINE)
+        {
+            sprite_overflow = line;
+            break;
+        }
     }
 
   //  if (overdraw)
@@ -828,27 +877,29 @@ void draw_sprites(int line)
 
   uint8_t *start_table = VRAM + REG5_SAT_ADDRESS;
 
-  // This is both the size of the table as seen by the VDP
-  // *and* the maximum number of sprites that are processed
-  // (important in case of infinite loops in links).
-  const int SPRITE_TABLE_SIZE = (screen_width == 320) ? 80 : 64;
-  const int MAX_SPRITES_PER_LINE = (screen_width == 320) ? 20 : 16;
   const int MAX_PIXELS_PER_LINE = (screen_width == 320) ? 320 : 256;
 
+  if (sprite_lines_dirty || sprite_lines_width != screen_width)
+    build_sprite_lines();
+
+  if (line < 0 || line >= SPRITE_LINES)
+    return;
+
+  const uint8_t *bucket = sprite_lines[line];
+  const int count = sprite_lines_count[line];
+
   bool masking = false, one_sprite_nonzero = false; // overdraw = false;
-  int sidx = 0, num_sprites = 0, num_pixels = 0;
-  for (int i = 0; i < SPRITE_TABLE_SIZE && sidx < SPRITE_TABLE_SIZE; ++i) {
+  int num_pixels = 0;
+  for (int n = 0; n < count; ++n) {
+    int sidx = bucket[n];
     uint8_t *table = start_table + sidx * 8;
-    uint8_t *cache = start_table + sidx * 8;
-
-    //uint8_t *cache = SAT_CACHE + sidx * 8;
+    uint8_t *cache = SAT_CACHE + sidx * 8;
 
     int sy = ((cache[0] & 0x3) << 8) | cache[1];
     int sx = ((table[6] & 0x3) << 8) | table[7];
     uint16_t name = (table[4] << 8) | table[5];
 
     int sh = BITS(cache[2], 0, 2) + 1;
-    int link = BITS(cache[3], 0, 7);
 
     int isflipv = table[4] & 0x10;
     int isfliph = table[4] & 0x8;
@@ -856,62 +907,55 @@ void draw_sprites(int line)
     int sw = BITS(table[2], 2, 2) + 1;
 
     sy -= 128;
-    if (line >= sy && line < sy + sh * 8) {
-      // Sprite masking: a sprite on column 0 masks
-      // any lower-priority sprite, but with the following conditions
-      //   * it only works from the second visible sprite on each line
-      //   * if the previous line had a sprite pixel overflow, it
-      //     works even on the first sprite
-      // Notice that we need to continue parsing the table after masking
-      // to see if we reach a pixel overflow (because it would affect masking
-      // on next line).
-      if (sx == 0) {
-        if (one_sprite_nonzero || sprite_overflow == line - 1)
-          masking = true;
-      } else
-        one_sprite_nonzero = true;
-
-      int row = (line - sy) >> 3;
-      int paty = (line - sy) & 7;
-      if (isflipv)
-        row = sh - row - 1;
-
-      sx -= 128;
-      if (sx > -sw * 8 && sx < screen_width && !masking) {
-
-        name += row;
-
-        if (isfliph) {
-          name += sh * (sw - 1);
-          for (int p = 0; p < sw && num_pixels < MAX_PIXELS_PER_LINE; p++) {
-
-            draw_pattern_sprite(scr + sx + p * 8, name, paty);
-            name -= sh;
-            num_pixels += 8;
-          }
-        } else {
-          for (int p = 0; p < sw && num_pixels < MAX_PIXELS_PER_LINE; p++) {
 
-            draw_pattern_sprite(scr + sx + p * 8, name, paty);
-            name += sh;
-            num_pixels += 8;
-          }
+    // Sprite masking: a sprite on column 0 masks
+    // any lower-priority sprite, but with the following conditions
+    //   * it only works from the second visible sprite on each line
+    //   * if the previous line had a sprite pixel overflow, it
+    //     works even on the first sprite
+    // Notice that we need to continue parsing the table after masking
+    // to see if we reach a pixel overflow (because it would affect masking
+    // on next line).
+    if (sx == 0) {
+      if (one_sprite_nonzero || sprite_overflow == line - 1)
+        masking = true;
+    } else
+      one_sprite_nonzero = true;
+
+    int row = (line - sy) >> 3;
+    int paty = (line - sy) & 7;
+    if (isflipv)
+      row = sh - row - 1;
+
+    sx -= 128;
+    if (sx > -sw * 8 && sx < screen_width && !masking) {
+
+      name += row;
+
+      if (isfliph) {
+        name += sh * (sw - 1);
+        for (int p = 0; p < sw && num_pixels < MAX_PIXELS_PER_LINE; p++) {
+
+          draw_pattern_sprite(scr + sx + p * 8, name, paty);
+          name -= sh;
+          num_pixels += 8;
         }
-      } else
-        num_pixels += sw * 8;
+      } else {
+        for (int p = 0; p < sw && num_pixels < MAX_PIXELS_PER_LINE; p++) {
 
-      if (num_pixels >= MAX_PIXELS_PER_LINE) {
-        sprite_overflow = line;
-        break;
+          draw_pattern_sprite(scr + sx + p * 8, name, paty);
+          name += sh;
+          num_pixels += 8;
+        }
       }
-      if (++num_sprites >= MAX_SPRITES_PER_LINE)
-        break;
-    }
+    } else
+      num_pixels += sw * 8;
 
-    if (link == 0)
+    if (num_pixels >= MAX_PIXELS_PER_LINE) {
+      sprite_overflow = line;
       break;
-    sidx = link;
     }
+  }
 
   //  if (overdraw)
   //      sprite_collision = true;
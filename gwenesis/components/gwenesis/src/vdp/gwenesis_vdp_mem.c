@@ -104,6 +104,7 @@ extern int mode_pal;
 
 extern int sprite_overflow;
 extern bool sprite_collision;
+extern bool sprite_lines_dirty;
 
 // Store last address r/w
 //static unsigned int gwenesis_vdp_laddress_r=0;
@@ -152,6 +153,7 @@ int m68k_irq_acked(int irq) {
 void gwenesis_vdp_reset() {
   memset(VRAM, 0, VRAM_MAX_SIZE);
   memset(SAT_CACHE, 0, sizeof(SAT_CACHE));
+  sprite_lines_dirty = true;
   memset(CRAM, 0, sizeof(CRAM));
   memset(CRAM565, 0, sizeof(CRAM565));
   memset(VSRAM, 0, sizeof(VSRAM));
@@ -341,8 +343,13 @@ void gwenesis_vdp_vram_write(unsigned int address, unsigned int value)
 
   // Update internal SAT Cache
   // used in Castlevania Bloodlines
-  if (address >= REG5_SAT_ADDRESS && address < REG5_SAT_ADDRESS + REG5_SAT_SIZE)
-    SAT_CACHE[address - REG5_SAT_ADDRESS] = value;
+  if (address >= REG5_SAT_ADDRESS && address < REG5_SAT_ADDRESS + REG5_SAT_SIZE) {
+    unsigned int offset = address - REG5_SAT_ADDRESS;
+    // Y, size and link (bytes 0-3 of each entry) decide the sprite line buckets
+    if ((offset & 7) < 4 && SAT_CACHE[offset] != value)
+      sprite_lines_dirty = true;
+    SAT_CACHE[offset] = value;
+  }
 }
 
 static inline __attribute__((always_inline)) 
@@ -1018,6 +1025,7 @@ void gwenesis_vdp_mem_load_state() {
   saveGwenesisStateGetBuffer(state, "VRAM", VRAM, VRAM_MAX_SIZE);
   saveGwenesisStateGetBuffer(state, "CRAM", CRAM, sizeof(CRAM));
   saveGwenesisStateGetBuffer(state, "SAT_CACHE", SAT_CACHE, sizeof(SAT_CACHE));
+  sprite_lines_dirty = true;
   saveGwenesisStateGetBuffer(state, "gwenesis_vdp_regs", gwenesis_vdp_regs, sizeof(gwenesis_vdp_regs));
   saveGwenesisStateGetBuffer(state, "fifo", fifo, sizeof(fifo));
   saveGwenesisStateGetBuffer(state, "CRAM565", CRAM565, sizeof(CRAM565));
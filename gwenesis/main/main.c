@@ -258,15 +258,13 @@ void app_main(void)
 
     RG_LOGI("Genesis start\n");
 
-    FILE *fp = fopen(app->romPath, "rb");
-    if (!fp)
+    rg_reader_t *reader = rg_storage_reader_open(app->romPath);
+    if (!reader)
         RG_PANIC("Rom load failed");
-    fseek(fp, 0, SEEK_END);
-    size_t rom_size = ftell(fp);
+    size_t rom_size = rg_storage_reader_size(reader);
     void *rom_data = malloc((rom_size & ~0xFFFF) + 0x10000);
-    fseek(fp, 0, SEEK_SET);
-    fread(rom_data, 1, rom_size, fp);
-    fclose(fp);
+    rg_storage_reader_read(reader, 0, rom_data, rom_size);
+    rg_storage_reader_close(reader);
 
     RG_LOGI("load_cartridge(%p, %d)\n", rom_data, rom_size);
     load_cartridge(rom_data, rom_size);
@@ -301,7 +299,7 @@ void app_main(void)
     while (true)
     {
         joystick_old = joystick;
-        joystick = rg_input_read_gamepad();
+        joystick = rg_input_sample();
 
         if (joystick & (RG_KEY_MENU | RG_KEY_OPTION))
         {
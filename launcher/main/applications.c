@@ -24,6 +24,61 @@ static struct __attribute__((__packed__))
 } *crc_cache;
 static bool crc_cache_dirty = true;
 
+#define LIBRARY_INDEX_MAGIC 0x21112301
+#define LIBRARY_INDEX_PATH RG_BASE_PATH_CACHE "/library_%s.bin"
+// File format: {header} {folder, ...} {file, ...} {strings}
+typedef struct __attribute__((__packed__))
+{
+    uint32_t magic;
+    uint32_t folders_count;
+    uint32_t files_count;
+    uint32_t strings_size;
+} library_header_t;
+
+typedef struct __attribute__((__packed__))
+{
+    uint32_t path; // Offset in strings
+    int32_t mtime;
+    uint32_t first;
+    uint32_t count;
+} library_folder_t;
+
+typedef struct __attribute__((__packed__))
+{
+    uint32_t name; // Offset in strings
+    uint32_t checksum;
+    uint8_t type;
+    uint8_t padding[3];
+} library_file_t;
+
+typedef struct
+{
+    retro_folder_t *folders;
+    size_t folders_count;
+    retro_file_t *files;
+    size_t files_count;
+} library_t;
+
+#define COVER_PACK_MAGIC "RGCP"
+#define COVER_PACK_VERSION 1
+// File format: {magic:4 version:U32 count:U32 reserved:U32} {entry, ...} {data}
+// Each data blob is a rg_image_t, LZ4 compressed if size != original_size (see tools/mkcovers.py)
+typedef struct __attribute__((__packed__))
+{
+    uint32_t crc;
+    uint32_t offset;
+    uint32_t size;
+    uint32_t original_size;
+} cover_entry_t;
+
+static struct
+{
+    retro_app_t *app;
+    FILE *fp;
+    cover_entry_t *index; // Sorted by crc
+    uint32_t count;
+} cover_pack;
+
 static retro_app_t *apps[24];
 static int apps_count = 0;
 
@@ -35,73 +90,360 @@ static const char *get_file_path(retro_file_t *file)
     return strcat(strcat(strcpy(buffer, file->folder), "/"), file->name);
 }
 
-static void scan_folder(retro_app_t *app, const char* path, void *parent)
+static void get_file_label(const retro_file_t *file, char *out, size_t len)
 {
-    RG_ASSERT(app && path, "Bad param");
+    char *ext;
 
-    RG_LOGI("Scanning directory %s\n", path);
+    if (file->type == 0xFF)
+    {
+        snprintf(out, len, "[%s]", file->name);
+    }
+    else
+    {
+        snprintf(out, len, "%s", file->name);
+        if ((ext = strrchr(out, '.')))
+            *ext = 0;
+    }
+}
 
-    const char *folder = const_string(path);
-    rg_scandir_t *files = rg_storage_scandir(path, NULL, false);
+static int file_comp_label(const void *a, const void *b)
+{
+    char label_a[128], label_b[128];
+    get_file_label(a, label_a, sizeof(label_a));
+    get_file_label(b, label_b, sizeof(label_b));
+    return strcasecmp(label_a, label_b);
+}
 
-    for (rg_scandir_t *entry = files; entry && entry->is_valid; ++entry)
+static const retro_folder_t *find_folder(const retro_folder_t *folders, size_t count, const char *path)
+{
+    // Paths are always const_string
+    for (size_t i = 0; i < count; ++i)
     {
-        uint8_t is_valid = false;
-        uint8_t type = 0x00;
+        if (folders[i].path == path)
+            return &folders[i];
+    }
+    return NULL;
+}
 
-        if (entry->is_file)
-        {
-            char buffer[RG_PATH_MAX];
-            snprintf(buffer, RG_PATH_MAX, " %s ", rg_extension(entry->name));
-            is_valid = strstr(app->extensions, rg_strtolower(buffer)) != NULL;
-            type = 0x00;
-        }
-        else if (entry->is_dir)
+static retro_file_t *append_file(retro_app_t *app)
+{
+    if (app->files_count + 1 > app->files_capacity)
+    {
+        size_t new_capacity = RG_MAX(app->files_capacity * 1.5, 100);
+        retro_file_t *new_buf = realloc(app->files, new_capacity * sizeof(retro_file_t));
+        if (!new_buf)
+            return NULL;
+        app->files = new_buf;
+        app->files_capacity = new_capacity;
+    }
+    return &app->files[app->files_count++];
+}
+
+static retro_folder_t *append_folder(retro_app_t *app)
+{
+    if (app->folders_count + 1 > app->folders_capacity)
+    {
+        size_t new_capacity = app->folders_capacity + 16;
+        retro_folder_t *new_buf = realloc(app->folders, new_capacity * sizeof(retro_folder_t));
+        if (!new_buf)
+            return NULL;
+        app->folders = new_buf;
+        app->folders_capacity = new_capacity;
+    }
+    return &app->folders[app->folders_count++];
+}
+
+static bool library_load(retro_app_t *app, library_t *out)
+{
+    char path[RG_PATH_MAX];
+    library_header_t header = {0};
+    library_folder_t *folders = NULL;
+    library_file_t *files = NULL;
+    char *strings = NULL;
+    bool success = false;
+
+    snprintf(path, RG_PATH_MAX, LIBRARY_INDEX_PATH, app->short_name);
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return false;
+
+    if (!fread(&header, sizeof(header), 1, fp) || header.magic != LIBRARY_INDEX_MAGIC
+        || header.folders_count > 0x10000 || header.files_count > 0x100000)
+        goto cleanup;
+
+    folders = malloc(header.folders_count * sizeof(library_folder_t) + 1);
+    files = malloc(header.files_count * sizeof(library_file_t) + 1);
+    strings = malloc(header.strings_size + 1);
+    out->folders = calloc(header.folders_count + 1, sizeof(retro_folder_t));
+    out->files = calloc(header.files_count + 1, sizeof(retro_file_t));
+
+    if (!folders || !files || !strings || !out->folders || !out->files)
+        goto cleanup;
+
+    if (fread(folders, sizeof(library_folder_t), header.folders_count, fp) != header.folders_count
+        || fread(files, sizeof(library_file_t), header.files_count, fp) != header.files_count
+        || fread(strings, 1, header.strings_size, fp) != header.strings_size)
+        goto cleanup;
+
+    strings[header.strings_size] = 0;
+
+    for (size_t i = 0; i < header.folders_count; ++i)
+    {
+        library_folder_t *folder = &folders[i];
+        if (folder->path >= header.strings_size || folder->first + folder->count > header.files_count)
+            goto cleanup;
+
+        out->folders[i] = (retro_folder_t) {
+            .path = const_string(strings + folder->path),
+            .mtime = folder->mtime,
+            .first = folder->first,
+            .count = folder->count,
+        };
+
+        for (size_t j = folder->first; j < folder->first + folder->count; ++j)
         {
-            is_valid = true;
-            type = 0xFF;
+            if (files[j].name >= header.strings_size)
+                goto cleanup;
+
+            // The names are never freed, just like the strdup'ed ones from scan_folder
+            out->files[j] = (retro_file_t) {
+                .name = strings + files[j].name,
+                .folder = out->folders[i].path,
+                .checksum = files[j].checksum,
+                .app = (void*)app,
+                .type = files[j].type,
+                .is_valid = true,
+            };
         }
+    }
 
-        if (!is_valid)
+    out->folders_count = header.folders_count;
+    out->files_count = header.files_count;
+    success = true;
+
+    RG_LOGI("Loaded library index '%s' (folders: %d, files: %d)\n", path,
+        (int)header.folders_count, (int)header.files_count);
+
+cleanup:
+    if (!success)
+    {
+        RG_LOGW("Library index '%s' is invalid, ignoring it\n", path);
+        free(out->folders);
+        free(out->files);
+        free(strings);
+        memset(out, 0, sizeof(*out));
+    }
+    free(folders);
+    free(files);
+    fclose(fp);
+    return success;
+}
+
+static void library_save(retro_app_t *app)
+{
+    char path[RG_PATH_MAX];
+    library_header_t header = {LIBRARY_INDEX_MAGIC, app->folders_count, 0, 0};
+    uint32_t offset = 0, first = 0;
+
+    if (!app->initialized || !app->index_dirty)
+        return;
+
+    snprintf(path, RG_PATH_MAX, LIBRARY_INDEX_PATH, app->short_name);
+
+    FILE *fp = fopen(path, "wb");
+    if (!fp)
+    {
+        RG_LOGE("Failed to save library index '%s'\n", path);
+        return;
+    }
+
+    // Deleted files are dropped here, so the folder ranges have to be recomputed
+    for (size_t i = 0; i < app->folders_count; ++i)
+        header.strings_size += strlen(app->folders[i].path) + 1;
+    for (size_t i = 0; i < app->files_count; ++i)
+    {
+        if (!app->files[i].is_valid)
             continue;
+        header.strings_size += strlen(app->files[i].name) + 1;
+        header.files_count++;
+    }
+
+    fwrite(&header, sizeof(header), 1, fp);
+
+    for (size_t i = 0; i < app->folders_count; ++i)
+    {
+        const retro_folder_t *folder = &app->folders[i];
+        library_folder_t entry = {offset, folder->mtime, first, 0};
+        for (size_t j = folder->first; j < folder->first + folder->count; ++j)
+            entry.count += app->files[j].is_valid;
+        fwrite(&entry, sizeof(entry), 1, fp);
+        offset += strlen(folder->path) + 1;
+        first += entry.count;
+    }
+
+    for (size_t i = 0; i < app->files_count; ++i)
+    {
+        const retro_file_t *file = &app->files[i];
+        if (!file->is_valid)
+            continue;
+        library_file_t entry = {offset, file->checksum, file->type, {0}};
+        fwrite(&entry, sizeof(entry), 1, fp);
+        offset += strlen(file->name) + 1;
+    }
+
+    for (size_t i = 0; i < app->folders_count; ++i)
+        fwrite(app->folders[i].path, strlen(app->folders[i].path) + 1, 1, fp);
+    for (size_t i = 0; i < app->files_count; ++i)
+    {
+        if (app->files[i].is_valid)
+            fwrite(app->files[i].name, strlen(app->files[i].name) + 1, 1, fp);
+    }
+
+    fclose(fp);
+    app->index_dirty = false;
+
+    RG_LOGI("Saved library index '%s' (folders: %d, files: %d)\n", path,
+        (int)header.folders_count, (int)header.files_count);
+}
+
+static void library_invalidate_folder(retro_app_t *app, const char *path)
+{
+    char index_path[RG_PATH_MAX];
+
+    // The index wasn't loaded this session, we can't update it
+    if (!app->initialized)
+    {
+        snprintf(index_path, RG_PATH_MAX, LIBRARY_INDEX_PATH, app->short_name);
+        unlink(index_path);
+        return;
+    }
+
+    // FAT doesn't necessarily update the folder's mtime when we change it ourselves,
+    // a zero mtime never matches so the folder will be rescanned on the next boot
+    for (size_t i = 0; i < app->folders_count; ++i)
+    {
+        if (app->folders[i].path == path)
+            app->folders[i].mtime = 0;
+    }
+    app->index_dirty = true;
+}
 
-        if (app->files_count + 1 > app->files_capacity)
+static void scan_folder(retro_app_t *app, const char *path, const library_t *index)
+{
+    RG_ASSERT(app && path, "Bad param");
+
+    const char *folder = const_string(path);
+    const retro_folder_t *indexed = index ? find_folder(index->folders, index->folders_count, folder) : NULL;
+    size_t first = app->files_count;
+    struct stat statbuf;
+    int32_t mtime = 0;
+
+    if (stat(folder, &statbuf) == 0)
+        mtime = statbuf.st_mtime;
+
+    // The folder's mtime changes when entries are added or removed, so the index is still
+    // good if it matches. Subfolders have their own mtime and are checked separately.
+    if (indexed && mtime && indexed->mtime == mtime)
+    {
+        for (size_t i = indexed->first; i < indexed->first + indexed->count; ++i)
         {
-            size_t new_capacity = app->files_capacity * 1.5;
-            retro_file_t *new_buf = realloc(app->files, new_capacity * sizeof(retro_file_t));
-            if (!new_buf)
+            retro_file_t *file = append_file(app);
+            if (!file)
             {
                 RG_LOGW("Ran out of memory, file scanning stopped at %d entries ...\n", app->files_count);
                 break;
             }
-            app->files = new_buf;
-            app->files_capacity = new_capacity;
+            *file = index->files[i];
         }
+    }
+    else
+    {
+        RG_LOGI("Scanning directory %s\n", folder);
 
-        app->files[app->files_count++] = (retro_file_t) {
-            .name = strdup(entry->name),
-            .folder = folder,
-            .app = (void*)app,
-            .type = type,
-            .is_valid = true,
-        };
+        rg_scandir_t *files = rg_storage_scandir(folder, NULL, false);
 
-        if (type == 0xFF)
+        for (rg_scandir_t *entry = files; entry && entry->is_valid; ++entry)
         {
-            retro_file_t *file = &app->files[app->files_count-1];
-            scan_folder(app, get_file_path(file), file);
+            uint8_t is_valid = false;
+            uint8_t type = 0x00;
+
+            if (entry->is_file)
+            {
+                char buffer[RG_PATH_MAX];
+                snprintf(buffer, RG_PATH_MAX, " %s ", rg_extension(entry->name));
+                is_valid = strstr(app->extensions, rg_strtolower(buffer)) != NULL;
+                type = 0x00;
+            }
+            else if (entry->is_dir)
+            {
+                is_valid = true;
+                type = 0xFF;
+            }
+
+            if (!is_valid)
+                continue;
+
+            retro_file_t *file = append_file(app);
+            if (!file)
+            {
+                RG_LOGW("Ran out of memory, file scanning stopped at %d entries ...\n", app->files_count);
+                break;
+            }
+
+            *file = (retro_file_t) {
+                .name = strdup(entry->name),
+                .folder = folder,
+                .app = (void*)app,
+                .type = type,
+                .is_valid = true,
+            };
         }
+
+        free(files);
+
+        // Sorting here means tab_refresh doesn't have to do it on every navigation
+        qsort(&app->files[first], app->files_count - first, sizeof(retro_file_t), file_comp_label);
+        app->index_dirty = true;
     }
 
-    free(files);
+    retro_folder_t *entry = append_folder(app);
+    if (!entry)
+        return;
+
+    *entry = (retro_folder_t) {
+        .path = folder,
+        .mtime = mtime,
+        .first = first,
+        .count = app->files_count - first,
+    };
+
+    // Subfolders are scanned once this folder is complete, to keep its range contiguous
+    for (size_t i = first, last = app->files_count; i < last; ++i)
+    {
+        if (app->files[i].type == 0xFF)
+            scan_folder(app, get_file_path(&app->files[i]), index);
+    }
 }
 
 static void application_init(retro_app_t *app)
 {
     RG_LOGI("Initializing application '%s' (%s)\n", app->description, app->partition);
 
+    library_t index = {0};
+    bool use_index = false;
+
+    // A reinit means that the files were changed through the launcher (the webui, usually).
+    // FAT doesn't always update the folders' mtime in that case, so we do a full rescan.
     if (app->initialized)
+    {
         app->files_count = 0;
+        app->folders_count = 0;
+    }
+    else
+    {
+        use_index = library_load(app, &index);
+    }
 
     // This checks if we have crc cover folders, the idea is to skip the crc later on if we don't!
     // It adds very little delay but it could become an issue if someone has thousands of named files...
@@ -115,11 +457,111 @@ static void application_init(retro_app_t *app)
         free(files);
     }
 
+    // A cover pack only contains crc covers
+    char pack_path[RG_PATH_MAX + 8];
+    snprintf(pack_path, sizeof(pack_path), "%s.pack", app->paths.covers);
+    if (access(pack_path, F_OK) == 0)
+        app->use_crc_covers = true;
+
     rg_storage_mkdir(app->paths.saves);
     rg_storage_mkdir(app->paths.roms);
-    scan_folder(app, app->paths.roms, 0);
+    scan_folder(app, app->paths.roms, use_index ? &index : NULL);
+
+    // Folders might have been removed
+    if (index.folders_count != app->folders_count)
+        app->index_dirty = true;
+
+    free(index.folders);
+    free(index.files);
 
     app->initialized = true;
+
+    library_save(app);
+}
+
+static bool cover_pack_open(retro_app_t *app)
+{
+    struct __attribute__((__packed__)) {char magic[4]; uint32_t version, count, reserved;} header;
+    char path[RG_PATH_MAX + 8];
+
+    if (cover_pack.app == app)
+        return cover_pack.fp != NULL;
+
+    // Only the current system's pack is kept open
+    if (cover_pack.fp)
+        fclose(cover_pack.fp);
+    free(cover_pack.index);
+    memset(&cover_pack, 0, sizeof(cover_pack));
+    cover_pack.app = app;
+
+    snprintf(path, sizeof(path), "%s.pack", app->paths.covers);
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return false;
+
+    if (fread(&header, sizeof(header), 1, fp) && memcmp(header.magic, COVER_PACK_MAGIC, 4) == 0
+        && header.version == COVER_PACK_VERSION && header.count < 0x100000
+        && (cover_pack.index = malloc(header.count * sizeof(cover_entry_t) + 1))
+        && fread(cover_pack.index, sizeof(cover_entry_t), header.count, fp) == header.count)
+    {
+        RG_LOGI("Loaded cover pack '%s' (covers: %d)\n", path, (int)header.count);
+        cover_pack.fp = fp;
+        cover_pack.count = header.count;
+        return true;
+    }
+
+    RG_LOGE("Invalid cover pack '%s'\n", path);
+    free(cover_pack.index);
+    cover_pack.index = NULL;
+    fclose(fp);
+    return false;
+}
+
+rg_image_t *application_load_cover(retro_app_t *app, uint32_t crc)
+{
+    if (!cover_pack_open(app))
+        return NULL;
+
+    size_t low = 0, high = cover_pack.count;
+    while (low < high)
+    {
+        size_t mid = (low + high) / 2;
+        if (cover_pack.index[mid].crc < crc)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    if (low >= cover_pack.count || cover_pack.index[low].crc != crc)
+        return NULL;
+
+    const cover_entry_t *entry = &cover_pack.index[low];
+    void *data = malloc(entry->size);
+    void *image = NULL;
+
+    // One seek and one read, the blob is already a rg_image_t when uncompressed
+    if (data && fseek(cover_pack.fp, entry->offset, SEEK_SET) == 0 && fread(data, entry->size, 1, cover_pack.fp))
+    {
+        if (entry->size == entry->original_size)
+            image = data, data = NULL;
+        else if ((image = malloc(entry->original_size)))
+        {
+            if (rg_lz4_decompress(data, entry->size, image, entry->original_size) != entry->original_size)
+                free(image), image = NULL;
+        }
+    }
+    free(data);
+
+    rg_image_t *img = image;
+    if (img && (entry->original_size < sizeof(rg_image_t)
+        || sizeof(rg_image_t) + img->width * img->height * 2 != entry->original_size))
+        free(img), img = NULL;
+
+    if (!img)
+        RG_LOGE("Failed to load cover %08X from pack\n", crc);
+
+    return img;
 }
 
 static void application_start(retro_file_t *file, int load_state)
@@ -307,46 +749,34 @@ static void tab_refresh(tab_t *tab)
 
     const char *basepath = const_string(app->paths.roms);
     const char *folder = const_string(tab->navpath ?: basepath);
+    const retro_folder_t *range = find_folder(app->folders, app->folders_count, folder);
     size_t items_count = 0;
-    char *ext = NULL;
 
     if (folder == basepath)
         tab->navpath = NULL;
 
-    if (app->files_count > 0)
+    if (range && range->count > 0)
     {
-        gui_resize_list(tab, app->files_count);
+        gui_resize_list(tab, range->count);
 
-        for (size_t i = 0; i < app->files_count; i++)
+        for (size_t i = range->first; i < range->first + range->count; i++)
         {
             retro_file_t *file = &app->files[i];
 
             if (!file->is_valid)
                 continue;
 
-            if (file->folder != folder && strcmp(file->folder, folder) != 0)
-                continue;
-
             listbox_item_t *item = &tab->listbox.items[items_count++];
-
-            if (file->type == 0xFF)
-            {
-                snprintf(item->text, 128, "[%s]", file->name);
-                // snprintf(item->text, 128, "/%s/", file->name);
-            }
-            else
-            {
-                snprintf(item->text, 128, "%s", file->name);
-                if ((ext = strrchr(item->text, '.')))
-                    *ext = 0;
-            }
-
+            get_file_label(file, item->text, sizeof(item->text));
             item->arg = file;
         }
     }
 
     gui_resize_list(tab, items_count);
-    gui_sort_list(tab);
+
+    // The folder's files are already sorted by label
+    if (tab->listbox.sort_mode != SORT_TEXT_ASC)
+        gui_sort_list(tab);
 
     if (items_count == 0)
     {
@@ -478,7 +908,7 @@ bool application_get_file_crc32(retro_file_t *file)
     uint8_t buffer[0x800];
     uint32_t crc_tmp = 0;
     int count = -1;
-    FILE *fp;
+    rg_reader_t *reader;
 
     if (file == NULL)
         return false;
@@ -489,6 +919,7 @@ bool application_get_file_crc32(retro_file_t *file)
     if ((crc_tmp = crc_cache_lookup(file)))
     {
         file->checksum = crc_tmp;
+        file->app->index_dirty = true;
     }
     else
     {
@@ -496,9 +927,10 @@ bool application_get_file_crc32(retro_file_t *file)
         gui_set_status(tab, NULL, "CRC32...");
         gui_redraw(); // gui_draw_status(tab);
 
-        if ((fp = fopen(get_file_path(file), "rb")))
+        // Go through the reader so that compressed ROMs get the crc of their content
+        if ((reader = rg_storage_reader_open(get_file_path(file))))
         {
-            fseek(fp, file->app->crc_offset, SEEK_SET);
+            size_t offset = file->app->crc_offset;
 
             while (count != 0)
             {
@@ -506,17 +938,19 @@ bool application_get_file_crc32(retro_file_t *file)
                 if ((gui.joystick = rg_input_read_gamepad()))
                     break;
 
-                count = fread(buffer, 1, sizeof(buffer), fp);
+                count = rg_storage_reader_read(reader, offset, buffer, sizeof(buffer));
                 crc_tmp = rg_crc32(crc_tmp, buffer, count);
+                offset += count;
             }
 
-            if (feof(fp))
+            if (offset >= rg_storage_reader_size(reader))
             {
                 file->checksum = crc_tmp;
+                file->app->index_dirty = true;
                 crc_cache_update(file);
             }
 
-            fclose(fp);
+            rg_storage_reader_close(reader);
         }
 
         gui_set_status(tab, NULL, "");
@@ -566,9 +1000,12 @@ static void show_file_info(retro_file_t *file)
             {
                 if (unlink(get_file_path(file)) == 0)
                 {
+                    library_invalidate_folder(file->app, file->folder);
                     bookmark_remove(BOOK_TYPE_FAVORITE, file);
                     bookmark_remove(BOOK_TYPE_RECENT, file);
                     file->is_valid = false;
+                    // Save now, the launcher may be powered off before it exits cleanly
+                    library_save(file->app);
                     gui_event(TAB_REFRESH, gui_get_current_tab());
                     return;
                 }
@@ -610,6 +1047,7 @@ void application_show_file_menu(retro_file_t *file, bool advanced)
         /* fallthrough */
     case 1:
         crc_cache_save();
+        library_save(file->app);
         gui_save_config();
         application_start(file, slot);
         break;
@@ -669,8 +1107,6 @@ static void application(const char *desc, const char *name, const char *exts, co
     snprintf(app->paths.saves, RG_PATH_MAX, RG_BASE_PATH_SAVES "/%s", app->short_name);
     snprintf(app->paths.roms, RG_PATH_MAX, RG_BASE_PATH_ROMS "/%s", app->short_name);
     app->available = rg_system_have_app(app->partition);
-    app->files = calloc(100, sizeof(retro_file_t));
-    app->files_capacity = 100;
     app->crc_offset = crc_offset;
 
     gui_add_tab(app->short_name, app->description, app, event_handler);
@@ -698,3 +1134,21 @@ void applications_init(void)
 
     crc_cache_init();
 }
+
+void applications_rescan(void)
+{
+    char index_path[RG_PATH_MAX];
+
+    // The index can't tell when files were replaced without the folder's mtime changing.
+    // Indexes not loaded yet are dropped, loaded ones are replaced by the full rescan that
+    // application_init always does when reinitializing.
+    for (int i = 0; i < apps_count; i++)
+    {
+        if (apps[i]->initialized)
+            continue;
+        snprintf(index_path, RG_PATH_MAX, LIBRARY_INDEX_PATH, apps[i]->short_name);
+        unlink(index_path);
+    }
+
+    gui_invalidate();
+}
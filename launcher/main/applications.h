@@ -18,6 +18,14 @@ typedef struct
     retro_app_t *app;
 } retro_file_t;
 
+typedef struct
+{
+    const char *path;
+    int32_t mtime;
+    uint32_t first; // Range of files[] in this folder, sorted like the list
+    uint32_t count;
+} retro_folder_t;
+
 typedef struct retro_app_s
 {
     char description[64];
@@ -33,6 +41,10 @@ typedef struct retro_app_s
     retro_file_t *files;
     size_t files_capacity;
     size_t files_count;
+    retro_folder_t *folders;
+    size_t folders_capacity;
+    size_t folders_count;
+    bool index_dirty;
     bool use_crc_covers;
     bool crc_scan_done;
     bool initialized;
@@ -42,7 +54,9 @@ typedef struct retro_app_s
 typedef struct tab_s tab_t;
 
 void applications_init(void);
+void applications_rescan(void);
 void application_show_file_menu(retro_file_t *file, bool simplified);
 bool application_get_file_crc32(retro_file_t *file);
 bool application_path_to_file(const char *path, retro_file_t *out_file);
+rg_image_t *application_load_cover(retro_app_t *app, uint32_t crc);
 void crc_cache_idle_task(tab_t *tab);
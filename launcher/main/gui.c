@@ -4,6 +4,7 @@
 #include <dirent.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <time.h>
 
 #include "applications.h"
 #include "gui.h"
@@ -23,6 +24,47 @@ const int gui_themes_count = RG_COUNT(gui_themes);
 
 retro_gui_t gui;
 
+// The scene remembers where each widget was painted and a key of what it showed, so that
+// gui_redraw() only repaints the areas that actually changed (rg_gui_flush() then only
+// sends the pixels that differ).
+#define LIST_LINES_MAX      (32)
+
+// Widgets are painted in this order
+enum {
+    WIDGET_HEADER,
+    WIDGET_STATUS,
+    WIDGET_BATTERY,
+    WIDGET_RADIO,
+    WIDGET_CLOCK,
+    WIDGET_NAVPATH,
+    WIDGET_LIST, // One widget per visible line
+    WIDGET_PREVIEW = WIDGET_LIST + LIST_LINES_MAX,
+    WIDGET_COUNT,
+};
+
+typedef struct {
+    int x, y, width, height;
+    uint32_t key;
+} widget_t;
+
+static struct {
+    widget_t widgets[WIDGET_COUNT];
+    uint32_t key;
+    uint32_t draws;
+    bool valid;
+    uint32_t preview_counter;
+    struct {
+        rg_image_t *img;
+        uint32_t id;
+    } scaled_preview;
+    struct {
+        uint32_t frames;
+        uint32_t pixels;
+        int64_t busy_time;
+        int64_t max_time;
+    } stats;
+} scene;
+
 #define SETTING_SELECTED_TAB    "SelectedTab"
 #define SETTING_START_SCREEN    "StartScreen"
 #define SETTING_STARTUP_MODE    "StartupMode"
@@ -218,6 +260,7 @@ void gui_set_theme(const char *name)
     }
 
     gui.theme = const_string(name);
+    scene.valid = false;
 }
 
 void gui_save_config(void)
@@ -355,32 +398,225 @@ void gui_scroll_list(tab_t *tab, scroll_mode_t mode, int arg)
     }
 }
 
+static uint32_t text_key(uint32_t seed, const char *text)
+{
+    return rg_crc32(seed, (const uint8_t *)text, strlen(text));
+}
+
+static const rg_image_t *get_scaled_preview(tab_t *tab, int width, int height)
+{
+    if (tab->preview->width == width && tab->preview->height == height)
+        return tab->preview;
+
+    // Resampling is slow, keep the result around because the preview is repainted often
+    if (scene.scaled_preview.id != tab->preview_id)
+    {
+        rg_image_free(scene.scaled_preview.img);
+        scene.scaled_preview.img = rg_image_copy_resampled(tab->preview, width, height, 0);
+        scene.scaled_preview.id = tab->preview_id;
+    }
+
+    return scene.scaled_preview.img;
+}
+
+static void draw_status_text(tab_t *tab)
+{
+    const int status_x = LOGO_WIDTH + 12;
+    const int status_y = HEADER_HEIGHT - 16;
+    char *txt_left = tab->status[tab->status[1].left[0] ? 1 : 0].left;
+    char *txt_right = tab->status[tab->status[1].right[0] ? 1 : 0].right;
+
+    rg_gui_draw_text(status_x, status_y, gui.width, txt_right, C_SNOW, C_TRANSPARENT, RG_TEXT_ALIGN_LEFT);
+    rg_gui_draw_text(status_x, status_y, 0, txt_left, C_WHITE, C_TRANSPARENT, RG_TEXT_ALIGN_RIGHT);
+}
+
+static const char *get_list_line(tab_t *tab, int line, int lines, bool *selected)
+{
+    const listbox_t *list = &tab->listbox;
+    int idx = list->cursor + line - (lines / 2);
+    *selected = idx == list->cursor;
+    return (idx >= 0 && idx < list->length) ? list->items[idx].text : "";
+}
+
+static void scene_layout(tab_t *tab, widget_t *widgets)
+{
+    memset(widgets, 0, sizeof(widget_t) * WIDGET_COUNT);
+
+    if (!gui.browse)
+    {
+        widgets[WIDGET_HEADER] = (widget_t){0, (gui.height - HEADER_HEIGHT) / 2, gui.width, HEADER_HEIGHT, 1};
+        return;
+    }
+
+    int line_height, top = HEADER_HEIGHT + 6;
+    int lines = RG_MIN(max_visible_lines(tab, &line_height), LIST_LINES_MAX);
+    int clock_width = TEXT_RECT("00:00", 0).width;
+    float percentage = 0.f;
+
+    widgets[WIDGET_HEADER] = (widget_t){0, 0, gui.width, HEADER_HEIGHT, 1};
+    widgets[WIDGET_STATUS] = (widget_t){LOGO_WIDTH + 12, HEADER_HEIGHT - 16, gui.width - (LOGO_WIDTH + 12), line_height,
+        text_key(text_key(0, tab->status[tab->status[1].left[0] ? 1 : 0].left),
+                 tab->status[tab->status[1].right[0] ? 1 : 0].right)};
+    widgets[WIDGET_BATTERY] = (widget_t){gui.width - 22, 3, 20, 10,
+        rg_input_read_battery(&percentage, NULL) ? (int)percentage + 1 : 0};
+#ifdef RG_ENABLE_NETWORKING
+    widgets[WIDGET_RADIO] = (widget_t){gui.width - 45, 3, 16, 10, rg_network_get_info().state + 1};
+    widgets[WIDGET_CLOCK] = (widget_t){gui.width - (50 + clock_width), 3, clock_width, line_height, 0};
+#else
+    widgets[WIDGET_CLOCK] = (widget_t){gui.width - (20 + clock_width), 3, clock_width, line_height, 0};
+#endif
+    time_t time_sec = time(NULL);
+    struct tm *tm = localtime(&time_sec);
+    widgets[WIDGET_CLOCK].key = tm->tm_hour * 60 + tm->tm_min + 1;
+
+    if (tab->navpath)
+    {
+        widgets[WIDGET_NAVPATH] = (widget_t){0, top, gui.width, line_height, text_key(1, tab->navpath)};
+        top += line_height;
+    }
+
+    top += ((gui.height - top) - (lines * line_height)) / 2;
+
+    for (int i = 0; i < lines; i++)
+    {
+        bool selected;
+        const char *label = get_list_line(tab, i, lines, &selected);
+        widgets[WIDGET_LIST + i] = (widget_t){0, top + i * line_height, gui.width, line_height,
+            text_key(selected ? 2 : 1, label)};
+    }
+
+    if (tab->preview)
+    {
+        int height = RG_MIN(tab->preview->height, PREVIEW_HEIGHT);
+        int width = RG_MIN(tab->preview->width, PREVIEW_WIDTH);
+        widgets[WIDGET_PREVIEW] = (widget_t){gui.width - width, gui.height - height, width, height, tab->preview_id};
+    }
+}
+
+static void scene_draw_widget(tab_t *tab, const widget_t *widget, int id)
+{
+    const theme_t *theme = &gui_themes[gui.color_theme % gui_themes_count];
+
+    if (id == WIDGET_HEADER)
+        gui_draw_header(tab, widget->y);
+    else if (id == WIDGET_STATUS)
+        draw_status_text(tab);
+    else if (id == WIDGET_BATTERY)
+        rg_gui_draw_battery(widget->x, widget->y);
+    else if (id == WIDGET_RADIO)
+        rg_gui_draw_radio(widget->x, widget->y);
+    else if (id == WIDGET_CLOCK)
+        rg_gui_draw_clock(widget->x, widget->y);
+    else if (id == WIDGET_NAVPATH)
+    {
+        char buffer[64];
+        snprintf(buffer, 63, "[%s]",  tab->navpath);
+        rg_gui_draw_text(0, widget->y, gui.width, buffer, theme->list.standard_fg, theme->list.standard_bg, 0);
+    }
+    else if (id >= WIDGET_LIST && id < WIDGET_PREVIEW)
+    {
+        int lines = RG_MIN(max_visible_lines(tab, NULL), LIST_LINES_MAX);
+        bool selected;
+        const char *label = get_list_line(tab, id - WIDGET_LIST, lines, &selected);
+        rg_gui_draw_text(0, widget->y, gui.width, label,
+            selected ? theme->list.selected_fg : theme->list.standard_fg,
+            selected ? theme->list.selected_bg : theme->list.standard_bg, 0);
+    }
+    else if (id == WIDGET_PREVIEW)
+    {
+        const rg_image_t *img = get_scaled_preview(tab, widget->width, widget->height);
+        rg_gui_draw_image(widget->x, widget->y, widget->width, widget->height, true, img);
+    }
+}
+
+static void scene_paint(tab_t *tab, const widget_t *widgets, int x, int y, int width, int height)
+{
+    rg_gui_set_clip(x, y, width, height);
+
+    gui_draw_background(tab, gui.browse ? 4 : 0);
+
+    for (int id = 0; id < WIDGET_COUNT; id++)
+    {
+        const widget_t *widget = &widgets[id];
+        if (widget->width > 0 && widget->height > 0
+            && widget->x < x + width && widget->x + widget->width > x
+            && widget->y < y + height && widget->y + widget->height > y)
+            scene_draw_widget(tab, widget, id);
+    }
+
+    rg_gui_set_clip(0, 0, 0, 0);
+}
+
 void gui_redraw(void)
 {
     tab_t *tab = gui_get_current_tab();
     if (!tab)
     {
         RG_LOGW("No tab to redraw...");
+        rg_gui_flush();
+        return;
     }
-    else if (gui.browse)
+
+    int64_t time_start = rg_system_timer();
+    rg_gui_counters_t counters = rg_gui_get_counters();
+    widget_t widgets[WIDGET_COUNT];
+    int painted = 0;
+
+    int state[] = {gui.selected_tab, gui.browse, gui.color_theme, gui.width, gui.height};
+    uint32_t key = rg_crc32(0, (const uint8_t *)state, sizeof(state));
+
+    scene_layout(tab, widgets);
+
+    // Something else (a dialog, usually) drew over us, everything must be repainted
+    if (!scene.valid || scene.key != key || scene.draws != counters.draws)
     {
-        gui_draw_background(tab, 4);
-        gui_draw_header(tab, 0);
-        gui_draw_status(tab);
-        gui_draw_list(tab);
-        if (tab->preview)
-        {
-            int height = RG_MIN(tab->preview->height, PREVIEW_HEIGHT);
-            int width = RG_MIN(tab->preview->width, PREVIEW_WIDTH);
-            rg_gui_draw_image(-width, -height, width, height, true, tab->preview);
-        }
+        scene_paint(tab, widgets, 0, 0, gui.width, gui.height);
+        painted++;
     }
     else
     {
-        gui_draw_background(tab, 0);
-        gui_draw_header(tab, (gui.height - HEADER_HEIGHT) / 2);
+        for (int id = 0; id < WIDGET_COUNT; id++)
+        {
+            const widget_t *prev = &scene.widgets[id];
+            const widget_t *next = &widgets[id];
+
+            if (memcmp(prev, next, sizeof(widget_t)) == 0)
+                continue;
+
+            if (prev->width > 0 && prev->height > 0)
+                scene_paint(tab, widgets, prev->x, prev->y, prev->width, prev->height);
+            if (next->width > 0 && next->height > 0 && memcmp(prev, next, sizeof(int) * 4) != 0)
+                scene_paint(tab, widgets, next->x, next->y, next->width, next->height);
+            painted++;
+        }
     }
+
+    memcpy(scene.widgets, widgets, sizeof(widgets));
+    scene.key = key;
+    scene.valid = true;
+
     rg_gui_flush();
+
+    rg_gui_counters_t counters_after = rg_gui_get_counters();
+    scene.draws = counters_after.draws;
+
+    if (painted)
+    {
+        int64_t elapsed = rg_system_timer() - time_start;
+        scene.stats.frames++;
+        scene.stats.pixels += counters_after.pixels - counters.pixels;
+        scene.stats.busy_time += elapsed;
+        scene.stats.max_time = RG_MAX(scene.stats.max_time, elapsed);
+
+        if (scene.stats.frames == 64)
+        {
+            int avg_time = scene.stats.busy_time / scene.stats.frames;
+            RG_LOGD("%d frames: avg %dus (%d fps), max %dus, %d pixels/frame\n", (int)scene.stats.frames,
+                avg_time, 1000000 / RG_MAX(avg_time, 1), (int)scene.stats.max_time,
+                (int)(scene.stats.pixels / scene.stats.frames));
+            memset(&scene.stats, 0, sizeof(scene.stats));
+        }
+    }
 }
 
 void gui_draw_background(tab_t *tab, int shade)
@@ -420,11 +656,6 @@ void gui_draw_header(tab_t *tab, int offset)
 
 void gui_draw_status(tab_t *tab)
 {
-    const int status_x = LOGO_WIDTH + 12;
-    const int status_y = HEADER_HEIGHT - 16;
-    char *txt_left = tab->status[tab->status[1].left[0] ? 1 : 0].left;
-    char *txt_right = tab->status[tab->status[1].right[0] ? 1 : 0].right;
-
     rg_gui_draw_battery(-22, 3);
 
 #ifdef RG_ENABLE_NETWORKING
@@ -434,8 +665,7 @@ void gui_draw_status(tab_t *tab)
     rg_gui_draw_clock(-(20 + TEXT_RECT("00:00", 0).width), 3);
 #endif
 
-    rg_gui_draw_text(status_x, status_y, gui.width, txt_right, C_SNOW, C_TRANSPARENT, RG_TEXT_ALIGN_LEFT);
-    rg_gui_draw_text(status_x, status_y, 0, txt_left, C_WHITE, C_TRANSPARENT, RG_TEXT_ALIGN_RIGHT);
+    draw_status_text(tab);
 }
 
 void gui_draw_list(tab_t *tab)
@@ -444,7 +674,6 @@ void gui_draw_list(tab_t *tab)
     rg_color_t fg[2] = {theme->list.standard_fg, theme->list.selected_fg};
     rg_color_t bg[2] = {theme->list.standard_bg, theme->list.selected_bg};
 
-    const listbox_t *list = &tab->listbox;
     int line_height, top = HEADER_HEIGHT + 6;
     int lines = max_visible_lines(tab, &line_height);
 
@@ -459,9 +688,8 @@ void gui_draw_list(tab_t *tab)
 
     for (int i = 0; i < lines; i++)
     {
-        int idx = list->cursor + i - (lines / 2);
-        int selected = idx == list->cursor;
-        char *label = (idx >= 0 && idx < list->length) ? list->items[idx].text : "";
+        bool selected;
+        const char *label = get_list_line(tab, i, lines, &selected);
         top += rg_gui_draw_text(0, top, gui.width, label, fg[selected], bg[selected], 0).height;
     }
 }
@@ -474,7 +702,15 @@ void gui_set_preview(tab_t *tab, rg_image_t *preview)
     if (tab->preview)
         rg_image_free(tab->preview);
 
+    if (scene.scaled_preview.id == tab->preview_id)
+    {
+        rg_image_free(scene.scaled_preview.img);
+        scene.scaled_preview.img = NULL;
+        scene.scaled_preview.id = 0;
+    }
+
     tab->preview = preview;
+    tab->preview_id = ++scene.preview_counter;
 }
 
 void gui_load_preview(tab_t *tab)
@@ -529,6 +765,17 @@ void gui_load_preview(tab_t *tab)
         if (file->missing_cover & (1 << type))
             continue;
 
+        // The system's cover pack is tried first, the loose files below are the fallback
+        if (type == 0x2 && app->use_crc_covers && application_get_file_crc32(file))
+        {
+            rg_image_t *cover = application_load_cover(app, file->checksum);
+            if (cover)
+            {
+                gui_set_preview(tab, cover);
+                continue;
+            }
+        }
+
         if (type == 0x1 && app->use_crc_covers && application_get_file_crc32(file)) // Game cover (old format)
             snprintf(path, RG_PATH_MAX, "%s/%X/%08X.art", app->paths.covers, file->checksum >> 28, file->checksum);
         else if (type == 0x2 && app->use_crc_covers && application_get_file_crc32(file)) // Game cover (png)
@@ -552,7 +799,7 @@ void gui_load_preview(tab_t *tab)
 
         if (access(path, F_OK) == 0)
         {
-            gui_set_preview(tab, rg_image_load_from_file(path, 0));
+            gui_set_preview(tab, rg_image_load_from_file_scaled(path, PREVIEW_WIDTH, PREVIEW_HEIGHT, 0));
             if (!tab->preview)
                 errors++;
         }
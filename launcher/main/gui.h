@@ -96,6 +96,7 @@ typedef struct tab_s {
     const char *navpath;
     listbox_t listbox;
     rg_image_t *preview;
+    uint32_t preview_id;
     gui_event_handler_t event_handler;
 } tab_t;
 
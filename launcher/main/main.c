@@ -220,6 +220,17 @@ static rg_gui_event_t startup_app_cb(rg_gui_option_t *option, rg_gui_event_t eve
     return RG_DIALOG_VOID;
 }
 
+static rg_gui_event_t rescan_roms_cb(rg_gui_option_t *option, rg_gui_event_t event)
+{
+    if (event == RG_DIALOG_ENTER)
+    {
+        rg_gui_draw_hourglass();
+        applications_rescan();
+        return RG_DIALOG_CLOSE;
+    }
+    return RG_DIALOG_VOID;
+}
+
 static rg_gui_event_t about_app_cb(rg_gui_option_t *option, rg_gui_event_t event)
 {
     if (event == RG_DIALOG_ENTER)
@@ -455,6 +466,7 @@ void app_main(void)
         {0, "Hide tabs   ", "...", 1, &toggle_tabs_cb},
         {0, "Startup app ", "...", 1, &startup_app_cb},
         {0, "Timezone    ", "...", 1, &timezone_cb},
+        {0, "Rescan roms", NULL,  1, &rescan_roms_cb},
         {0, "Wi-Fi options...", NULL,  1, &wifi_options_cb},
     #if !RG_GAMEPAD_HAS_OPTION_BTN
         RG_DIALOG_SEPARATOR,
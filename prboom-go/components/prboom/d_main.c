@@ -567,13 +567,13 @@ bool D_AddFile(const char *file)
 static void CheckIWAD(const char *iwadname,GameMode_t *gmode,boolean *hassec)
 {
     int ud=0,rg=0,sw=0,cm=0,sc=0;
-    wadinfo_t header;
-    FILE *fp;
+    wadinfo_t header = {0};
+    rg_reader_t *reader;
 
-    if (!(fp = fopen(iwadname, "rb")))
+    if (!(reader = rg_storage_reader_open(iwadname)))
       I_Error("CheckIWAD: Can't open IWAD %s", iwadname);
 
-    fread(&header, sizeof(header), 1, fp);
+    rg_storage_reader_read(reader, 0, &header, sizeof(header));
     // read IWAD header
     if (!strncmp(header.identification, "IWAD", 4))
     {
@@ -585,8 +585,7 @@ static void CheckIWAD(const char *iwadname,GameMode_t *gmode,boolean *hassec)
       header.infotableofs = LONG(header.infotableofs);
       length = header.numlumps;
       fileinfo = calloc(sizeof(filelump_t), length);
-      fseek(fp, header.infotableofs, SEEK_SET);
-      fread(fileinfo, sizeof(filelump_t), length, fp);
+      rg_storage_reader_read(reader, header.infotableofs, fileinfo, sizeof(filelump_t) * length);
 
 
       // scan directory for levelname lumps
@@ -621,6 +620,8 @@ static void CheckIWAD(const char *iwadname,GameMode_t *gmode,boolean *hassec)
     else // missing IWAD tag in header
       I_Error("CheckIWAD: IWAD tag %s not present", iwadname);
 
+    rg_storage_reader_close(reader);
+
     // Determine game mode from levels present
     // Must be a full set for whichever mode is present
     // Lack of wolf-3d levels also detected here
@@ -2847,9 +2847,12 @@ boolean G_CheckDemoStatus (void)
       int endtime = I_GetTime();
       // killough -- added fps information and made it work for longer demos:
       unsigned realtics = endtime-starttime;
-      I_Error ("Timed %u gametics in %u realtics = %-.1f frames per second",
-               (unsigned) gametic,realtics,
-               (unsigned) gametic * (double) TICRATE / realtics);
+      double fps = (unsigned) gametic * (double) TICRATE / (realtics ? realtics : 1);
+      // Report and go back to the demo loop, I_Error would take the whole system down
+      lprintf(LO_INFO, "Timed %u gametics in %u realtics = %-.1f frames per second\n",
+              (unsigned) gametic, realtics, fps);
+      doom_printf("Timedemo: %.1f fps", fps);
+      timingdemo = singletics = singledemo = false;
     }
 
   if (demoplayback)
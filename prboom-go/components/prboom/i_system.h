@@ -41,6 +41,11 @@ int I_GetTimeMS(void);  // Clock time
 int I_GetTime(void);    // Tics
 void I_uSleep(unsigned long usecs);
 
+/* Runs func(arg) on the other core, returns false if there is no worker.
+ * I_WaitWorker must be called before starting another job. */
+bool I_StartWorker(void (*func)(void *), void *arg);
+void I_WaitWorker(void);
+
 const char *I_DoomExeDir(void); // killough 2/16/98: path to executable's dir
 const char* I_SigString(char* buf, size_t sz, int signum);
 
@@ -1477,6 +1477,26 @@ static void P_RemoveSlimeTrails(void)         // killough 10/98
 //
 // killough 5/3/98: reformatted, cleaned up
 
+//
+// P_PrefetchMapLumps
+// The map lumps are usually stored back to back, read them all at once
+// instead of one seek and read per P_Load* function.
+//
+static void P_PrefetchMapLumps(int lumpnum, int gl_lumpnum)
+{
+  int lumps[ML_BLOCKMAP + ML_GL_NODES];
+  size_t count = 0;
+
+  for (int i = ML_THINGS; i <= ML_BLOCKMAP; i++)
+    lumps[count++] = lumpnum + i;
+
+  if (gl_lumpnum > lumpnum)
+    for (int i = ML_GL_VERTS; i <= ML_GL_NODES; i++)
+      lumps[count++] = gl_lumpnum + i;
+
+  W_PrefetchLumps(lumps, count);
+}
+
 void P_SetupLevel(int episode, int map, int playermask, skill_t skill)
 {
   int   i;
@@ -1539,6 +1559,8 @@ void P_SetupLevel(int episode, int map, int playermask, skill_t skill)
       && !strncasecmp(lumpinfo[i].name, "BEHAVIOR", 8))
     I_Error("P_SetupLevel: %s: Hexen format not supported", lumpname);
 
+  P_PrefetchMapLumps(lumpnum, gl_lumpnum);
+
 #if 1
   // figgi 10/19/00 -- check for gl lumps and load them
   P_GetNodesVersion(lumpnum,gl_lumpnum);
@@ -602,11 +602,9 @@ int PUREFUNC R_SafeTextureNumForName(const char *name, int snum)
 // Totally rewritten by Lee Killough to use less memory,
 // to avoid using alloca(), and to improve performance.
 // cph - new wad lump handling, calls cache functions but acquires no locks
-
-static inline void precache_lump(int l)
-{
-  W_CacheLumpNum(l); W_UnlockLumpNum(l);
-}
+//
+// The lumps are collected first and handed to W_PrefetchLumps, which reads
+// them in file order with coalesced reads.
 
 void R_PrecacheLevel(void)
 {
@@ -615,11 +613,23 @@ void R_PrecacheLevel(void)
 
   size_t maxitems = MAX(numtextures, MAX(numflats, numsprites));
   byte hitlist[maxitems];
-  size_t count = 0;
+  size_t count = 0, flats = 0, patches = 0, maxlumps = numflats;
+  int *lumps;
+
+  for (int i = numtextures; --i >= 0; )
+    maxlumps += textures[i]->patchcount;
+  for (int i = numsprites; --i >= 0; )
+    maxlumps += sprites[i].numframes * 8;
+
+  lumps = malloc(maxlumps * sizeof(*lumps));
+  if (!lumps)
+  {
+    lprintf(LO_WARN, "R_PrecacheLevel: no memory for %d lumps, skipping\n", (int)maxlumps);
+    return;
+  }
 
   // Precache flats.
   memset(hitlist, 0, maxitems);
-  count = 0;
 
   for (int i = numsectors; --i >= 0; )
   {
@@ -628,20 +638,13 @@ void R_PrecacheLevel(void)
   }
 
   for (int i = numflats; --i >= 0; )
-  {
     if (hitlist[i])
-    {
-      precache_lump(firstflat + i);
-      count++;
-    }
-  }
-
-  lprintf(LO_INFO, "R_PrecacheLevel: pre-cached %d flats\n", count);
+      lumps[count++] = firstflat + i;
 
+  flats = count;
 
   // Precache textures.
   memset(hitlist, 0, maxitems);
-  count = 0;
 
   for (int i = numsides; --i >= 0; )
   {
@@ -656,18 +659,13 @@ void R_PrecacheLevel(void)
       {
         texture_t *texture = textures[i];
         for (int j = texture->patchcount; --j >= 0; )
-        {
-          precache_lump(texture->patches[j].patch);
-          count++;
-        }
+          lumps[count++] = texture->patches[j].patch;
       }
 
-  lprintf(LO_INFO, "R_PrecacheLevel: pre-cached %d textures\n", count);
-
+  patches = count - flats;
 
   // Precache sprites.
   memset(hitlist, 0, maxitems);
-  count = 0;
 
   thinker_t *th = NULL;
   while ((th = P_NextThinker(th,th_all)))
@@ -680,15 +678,16 @@ void R_PrecacheLevel(void)
         for (int j = sprites[i].numframes; --j >= 0; )
           {
             short *sflump = sprites[i].spriteframes[j].lump;
-            for (int k = 7; --k >= 0; )
-            {
-              precache_lump(firstspritelump + sflump[k]);
-              count++;
-            }
+            for (int k = 8; --k >= 0; )
+              lumps[count++] = firstspritelump + sflump[k];
           }
       }
 
-  lprintf(LO_INFO, "R_PrecacheLevel: pre-cached %d sprites\n", count);
+  lprintf(LO_INFO, "R_PrecacheLevel: %d flats, %d texture patches, %d sprite lumps\n",
+    (int)flats, (int)patches, (int)(count - flats - patches));
+
+  W_PrefetchLumps(lumps, count);
+  free(lumps);
 }
 
 // Proff - Added for OpenGL
@@ -600,6 +600,8 @@ void R_RenderPlayerView (player_t* player)
   NetUpdate ();
 #endif
 
+  // Only the flats can be drawn on two cores (threaded_flats), walls are drawn
+  // during the BSP walk above and sprites by R_DrawMasked, both on this thread.
   R_DrawPlanes ();
 
   // Check for new console commands.
@@ -58,6 +58,7 @@
 #include "r_sky.h"
 #include "r_plane.h"
 #include "v_video.h"
+#include "i_system.h"
 #include "lprintf.h"
 
 
@@ -83,25 +84,33 @@ int *openings,*lastopening; // dropoff overflow
 
 int floorclip[MAX_SCREENWIDTH], ceilingclip[MAX_SCREENWIDTH]; // dropoff overflow
 
-// spanstart holds the start of a plane span; initialized to 0 at start
-
-static int spanstart[MAX_SCREENHEIGHT];                // killough 2/8/98
-
 //
 // texture mapping
 //
+// Flats can be drawn by two threads, each one owning a vertical strip of the
+// view. Everything R_MapPlane and R_MakeSpans modify lives in a context.
+//
+
+typedef struct
+{
+  int x1, x2;                                  // columns owned by this context
+  const lighttable_t **planezlight;
+  fixed_t planeheight;
+  fixed_t xoffs, yoffs;                        // killough 2/28/98: flat offsets
+  int spanstart[MAX_SCREENHEIGHT];             // killough 2/8/98
+  fixed_t cachedheight[MAX_SCREENHEIGHT];
+  fixed_t cacheddistance[MAX_SCREENHEIGHT];
+  fixed_t cachedxstep[MAX_SCREENHEIGHT];
+  fixed_t cachedystep[MAX_SCREENHEIGHT];
+} plane_context_t;
 
-static const lighttable_t **planezlight;
-static fixed_t planeheight;
+static plane_context_t plane_contexts[2];
+
+boolean threaded_flats = false;
 
 // killough 2/8/98: make variables static
 
 static fixed_t basexscale, baseyscale;
-static fixed_t cachedheight[MAX_SCREENHEIGHT];
-static fixed_t cacheddistance[MAX_SCREENHEIGHT];
-static fixed_t cachedxstep[MAX_SCREENHEIGHT];
-static fixed_t cachedystep[MAX_SCREENHEIGHT];
-static fixed_t xoffs,yoffs;    // killough 2/28/98: flat offsets
 
 fixed_t yslope[MAX_SCREENHEIGHT], distscale[MAX_SCREENWIDTH];
 
@@ -109,19 +118,15 @@ fixed_t yslope[MAX_SCREENHEIGHT], distscale[MAX_SCREENWIDTH];
 // R_MapPlane
 //
 // Uses global vars:
-//  planeheight
-//  dsvars.source
 //  basexscale
 //  baseyscale
 //  viewx
 //  viewy
-//  xoffs
-//  yoffs
 //
 // BASIC PRIMITIVE
 //
 
-static void R_MapPlane(int y, int x1, int x2, draw_span_vars_t *dsvars)
+static void R_MapPlane(plane_context_t *ctx, int y, int x1, int x2, draw_span_vars_t *dsvars)
 {
   angle_t angle;
   fixed_t distance, length;
@@ -132,26 +137,26 @@ static void R_MapPlane(int y, int x1, int x2, draw_span_vars_t *dsvars)
     I_Error ("R_MapPlane: %i, %i at %i",x1,x2,y);
 #endif
 
-  if (planeheight != cachedheight[y])
+  if (ctx->planeheight != ctx->cachedheight[y])
     {
-      cachedheight[y] = planeheight;
-      distance = cacheddistance[y] = FixedMul (planeheight, yslope[y]);
-      dsvars->xstep = cachedxstep[y] = FixedMul (distance,basexscale);
-      dsvars->ystep = cachedystep[y] = FixedMul (distance,baseyscale);
+      ctx->cachedheight[y] = ctx->planeheight;
+      distance = ctx->cacheddistance[y] = FixedMul (ctx->planeheight, yslope[y]);
+      dsvars->xstep = ctx->cachedxstep[y] = FixedMul (distance,basexscale);
+      dsvars->ystep = ctx->cachedystep[y] = FixedMul (distance,baseyscale);
     }
   else
     {
-      distance = cacheddistance[y];
-      dsvars->xstep = cachedxstep[y];
-      dsvars->ystep = cachedystep[y];
+      distance = ctx->cacheddistance[y];
+      dsvars->xstep = ctx->cachedxstep[y];
+      dsvars->ystep = ctx->cachedystep[y];
     }
 
   length = FixedMul (distance,distscale[x1]);
   angle = (viewangle + xtoviewangle[x1])>>ANGLETOFINESHIFT;
 
   // killough 2/28/98: Add offsets
-  dsvars->xfrac =  viewx + FixedMul(finecosine[angle], length) + xoffs;
-  dsvars->yfrac = -viewy - FixedMul(finesine[angle],   length) + yoffs;
+  dsvars->xfrac =  viewx + FixedMul(finecosine[angle], length) + ctx->xoffs;
+  dsvars->yfrac = -viewy - FixedMul(finesine[angle],   length) + ctx->yoffs;
 
   if (drawvars.filterfloor == RDRAW_FILTER_LINEAR) {
     dsvars->xfrac -= (FRACUNIT>>1);
@@ -164,8 +169,8 @@ static void R_MapPlane(int y, int x1, int x2, draw_span_vars_t *dsvars)
       index = distance >> LIGHTZSHIFT;
       if (index >= MAXLIGHTZ )
         index = MAXLIGHTZ-1;
-      dsvars->colormap = planezlight[index];
-      dsvars->nextcolormap = planezlight[index+1 >= MAXLIGHTZ ? MAXLIGHTZ-1 : index+1];
+      dsvars->colormap = ctx->planezlight[index];
+      dsvars->nextcolormap = ctx->planezlight[index+1 >= MAXLIGHTZ ? MAXLIGHTZ-1 : index+1];
     }
   else
    {
@@ -199,7 +204,8 @@ void R_ClearPlanes(void)
   lastopening = openings;
 
   // texture calculation
-  memset(cachedheight, 0, sizeof(cachedheight));
+  for (i=0;i<2;i++)
+    memset(plane_contexts[i].cachedheight, 0, sizeof(plane_contexts[i].cachedheight));
 
   // scale will be unit scale at SCREENWIDTH/2 distance
   basexscale = FixedDiv (viewsin,projection);
@@ -311,149 +317,205 @@ visplane_t *R_CheckPlane(visplane_t *pl, int start, int stop)
 // R_MakeSpans
 //
 
-static void R_MakeSpans(int x, unsigned int t1, unsigned int b1,
+static void R_MakeSpans(plane_context_t *ctx, int x, unsigned int t1, unsigned int b1,
                         unsigned int t2, unsigned int b2,
                         draw_span_vars_t *dsvars)
 {
   for (; t1 < t2 && t1 <= b1; t1++)
-    R_MapPlane(t1, spanstart[t1], x-1, dsvars);
+    R_MapPlane(ctx, t1, ctx->spanstart[t1], x-1, dsvars);
   for (; b1 > b2 && b1 >= t1; b1--)
-    R_MapPlane(b1, spanstart[b1] ,x-1, dsvars);
+    R_MapPlane(ctx, b1, ctx->spanstart[b1] ,x-1, dsvars);
   while (t2 < t1 && t2 <= b2)
-    spanstart[t2++] = x;
+    ctx->spanstart[t2++] = x;
   while (b2 > b1 && b2 >= t2)
-    spanstart[b2--] = x;
+    ctx->spanstart[b2--] = x;
 }
 
-// New function, by Lee Killough
+static boolean R_IsSkyPlane(const visplane_t *pl)
+{
+  return pl->picnum == skyflatnum || pl->picnum & PL_SKYFLAT;
+}
 
-static void R_DoDrawPlane(visplane_t *pl)
+static void R_DrawSkyPlane(visplane_t *pl)
 {
   register int x;
   draw_column_vars_t dcvars;
   R_DrawColumn_f colfunc = R_GetDrawColumnFunc(RDC_PIPELINE_STANDARD, drawvars.filterwall, drawvars.filterz);
+  int texture;
+  const rpatch_t *tex_patch;
+  angle_t an, flip;
 
   R_SetDefaultDrawColumnVars(&dcvars);
 
-  if (pl->minx <= pl->maxx) {
-    if (pl->picnum == skyflatnum || pl->picnum & PL_SKYFLAT) { // sky flat
-      int texture;
-      const rpatch_t *tex_patch;
-      angle_t an, flip;
-
-      // killough 10/98: allow skies to come from sidedefs.
-      // Allows scrolling and/or animated skies, as well as
-      // arbitrary multiple skies per level without having
-      // to use info lumps.
+  // killough 10/98: allow skies to come from sidedefs.
+  // Allows scrolling and/or animated skies, as well as
+  // arbitrary multiple skies per level without having
+  // to use info lumps.
 
-      an = viewangle;
+  an = viewangle;
 
-      if (pl->picnum & PL_SKYFLAT)
-      {
-        // Sky Linedef
-        const line_t *l = &lines[pl->picnum & ~PL_SKYFLAT];
+  if (pl->picnum & PL_SKYFLAT)
+  {
+    // Sky Linedef
+    const line_t *l = &lines[pl->picnum & ~PL_SKYFLAT];
 
-        // Sky transferred from first sidedef
-        const side_t *s = *l->sidenum + sides;
+    // Sky transferred from first sidedef
+    const side_t *s = *l->sidenum + sides;
 
-        // Texture comes from upper texture of reference sidedef
-        texture = texturetranslation[s->toptexture];
+    // Texture comes from upper texture of reference sidedef
+    texture = texturetranslation[s->toptexture];
 
-        // Horizontal offset is turned into an angle offset,
-        // to allow sky rotation as well as careful positioning.
-        // However, the offset is scaled very small, so that it
-        // allows a long-period of sky rotation.
+    // Horizontal offset is turned into an angle offset,
+    // to allow sky rotation as well as careful positioning.
+    // However, the offset is scaled very small, so that it
+    // allows a long-period of sky rotation.
 
-        an += s->textureoffset;
+    an += s->textureoffset;
 
-        // Vertical offset allows careful sky positioning.
+    // Vertical offset allows careful sky positioning.
 
-        dcvars.texturemid = s->rowoffset - 28*FRACUNIT;
+    dcvars.texturemid = s->rowoffset - 28*FRACUNIT;
 
-        // We sometimes flip the picture horizontally.
-        //
-        // Doom always flipped the picture, so we make it optional,
-        // to make it easier to use the new feature, while to still
-        // allow old sky textures to be used.
+    // We sometimes flip the picture horizontally.
+    //
+    // Doom always flipped the picture, so we make it optional,
+    // to make it easier to use the new feature, while to still
+    // allow old sky textures to be used.
 
-        flip = l->special==272 ? 0u : ~0u;
-      }
-      else
-      {    // Normal Doom sky, only one allowed per level
-        dcvars.texturemid = skytexturemid;    // Default y-offset
-        texture = skytexture;             // Default texture
-        flip = 0;                         // Doom flips it
-      }
+    flip = l->special==272 ? 0u : ~0u;
+  }
+  else
+  {    // Normal Doom sky, only one allowed per level
+    dcvars.texturemid = skytexturemid;    // Default y-offset
+    texture = skytexture;             // Default texture
+    flip = 0;                         // Doom flips it
+  }
 
-      /* Sky is always drawn full bright, i.e. colormaps[0] is used.
-       * Because of this hack, sky is not affected by INVUL inverse mapping.
-       * Until Boom fixed this. Compat option added in MBF. */
+  /* Sky is always drawn full bright, i.e. colormaps[0] is used.
+   * Because of this hack, sky is not affected by INVUL inverse mapping.
+   * Until Boom fixed this. Compat option added in MBF. */
 
-      if (comp[comp_skymap] || !(dcvars.colormap = fixedcolormap))
-        dcvars.colormap = fullcolormap;          // killough 3/20/98
+  if (comp[comp_skymap] || !(dcvars.colormap = fixedcolormap))
+    dcvars.colormap = fullcolormap;          // killough 3/20/98
 
-      dcvars.nextcolormap = dcvars.colormap; // for filtering -- POPE
+  dcvars.nextcolormap = dcvars.colormap; // for filtering -- POPE
 
-      //dcvars.texturemid = skytexturemid;
-      dcvars.texheight = textureheight[skytexture]>>FRACBITS; // killough
-      // proff 09/21/98: Changed for high-res
-      dcvars.iscale = FRACUNIT*200/viewheight;
+  //dcvars.texturemid = skytexturemid;
+  dcvars.texheight = textureheight[skytexture]>>FRACBITS; // killough
+  // proff 09/21/98: Changed for high-res
+  dcvars.iscale = FRACUNIT*200/viewheight;
 
-      tex_patch = R_CacheTextureCompositePatchNum(texture);
+  tex_patch = R_CacheTextureCompositePatchNum(texture);
 
   // killough 10/98: Use sky scrolling offset, and possibly flip picture
-        for (x = pl->minx; (dcvars.x = x) <= pl->maxx; x++)
-          if ((dcvars.yl = pl->top[x]) != -1 && dcvars.yl <= (dcvars.yh = pl->bottom[x])) // dropoff overflow
-            {
-              dcvars.source = R_GetTextureColumn(tex_patch, ((an + xtoviewangle[x])^flip) >> ANGLETOSKYSHIFT);
-              dcvars.prevsource = R_GetTextureColumn(tex_patch, ((an + xtoviewangle[x-1])^flip) >> ANGLETOSKYSHIFT);
-              dcvars.nextsource = R_GetTextureColumn(tex_patch, ((an + xtoviewangle[x+1])^flip) >> ANGLETOSKYSHIFT);
-              colfunc(&dcvars);
-            }
+  for (x = pl->minx; (dcvars.x = x) <= pl->maxx; x++)
+    if ((dcvars.yl = pl->top[x]) != -1 && dcvars.yl <= (dcvars.yh = pl->bottom[x])) // dropoff overflow
+      {
+        dcvars.source = R_GetTextureColumn(tex_patch, ((an + xtoviewangle[x])^flip) >> ANGLETOSKYSHIFT);
+        dcvars.prevsource = R_GetTextureColumn(tex_patch, ((an + xtoviewangle[x-1])^flip) >> ANGLETOSKYSHIFT);
+        dcvars.nextsource = R_GetTextureColumn(tex_patch, ((an + xtoviewangle[x+1])^flip) >> ANGLETOSKYSHIFT);
+        colfunc(&dcvars);
+      }
+
+  R_UnlockTextureCompositePatchNum(texture);
+}
 
-      R_UnlockTextureCompositePatchNum(texture);
+//
+// R_DrawFlatPlane
+// Draws the part of a regular flat that falls in the context's strip.
+// The flat must have been cached (pl->source) by the main thread.
+//
 
-    } else {     // regular flat
+static void R_DrawFlatPlane(plane_context_t *ctx, const visplane_t *pl)
+{
+  register int x;
+  int x1 = MAX(pl->minx, ctx->x1);
+  int x2 = MIN(pl->maxx, ctx->x2);
+  int light;
+  draw_span_vars_t dsvars;
 
-      int stop, light;
-      draw_span_vars_t dsvars;
+  if (x1 > x2)
+    return;
 
-      dsvars.source = W_CacheLumpNum(firstflat + flattranslation[pl->picnum]);
+  dsvars.source = pl->source;
 
-      xoffs = pl->xoffs;  // killough 2/28/98: Add offsets
-      yoffs = pl->yoffs;
-      planeheight = D_abs(pl->height-viewz);
-      light = (pl->lightlevel >> LIGHTSEGSHIFT) + extralight;
+  ctx->xoffs = pl->xoffs;  // killough 2/28/98: Add offsets
+  ctx->yoffs = pl->yoffs;
+  ctx->planeheight = D_abs(pl->height-viewz);
+  light = (pl->lightlevel >> LIGHTSEGSHIFT) + extralight;
 
-      if (light >= LIGHTLEVELS)
-  light = LIGHTLEVELS-1;
+  if (light >= LIGHTLEVELS)
+    light = LIGHTLEVELS-1;
 
-      if (light < 0)
-  light = 0;
+  if (light < 0)
+    light = 0;
 
-      stop = pl->maxx + 1;
-      planezlight = zlight[light];
-      pl->top[pl->minx-1] = pl->top[stop] = 0xffffffffu; // dropoff overflow
+  ctx->planezlight = zlight[light];
 
-      for (x = pl->minx ; x <= stop ; x++)
-         R_MakeSpans(x,pl->top[x-1],pl->bottom[x-1],
-                     pl->top[x],pl->bottom[x], &dsvars);
+  // The columns on each side of the strip are treated as empty (0xffffffff, like
+  // pl->top[minx-1] and pl->top[maxx+1]) so spans are closed at the strip's edges.
+  R_MakeSpans(ctx, x1, 0xffffffffu, 0, pl->top[x1], pl->bottom[x1], &dsvars);
+  for (x = x1 + 1; x <= x2; x++)
+    R_MakeSpans(ctx, x, pl->top[x-1], pl->bottom[x-1], pl->top[x], pl->bottom[x], &dsvars);
+  R_MakeSpans(ctx, x2 + 1, pl->top[x2], pl->bottom[x2], 0xffffffffu, 0, &dsvars);
+}
 
-      W_UnlockLumpNum(firstflat + flattranslation[pl->picnum]);
-    }
-  }
+static void R_DrawFlatPlanes(void *arg)
+{
+  plane_context_t *ctx = arg;
+  visplane_t *pl;
+  int i;
+  for (i=0;i<MAXVISPLANES;i++)
+    for (pl=visplanes[i]; pl; pl=pl->next)
+      if (pl->source)
+        R_DrawFlatPlane(ctx, pl);
 }
 
 //
 // RDrawPlanes
 // At the end of each frame.
 //
+// With threaded_flats the right half of the view's flats is drawn by
+// I_StartWorker's thread while this one draws the skies and the left half.
+// Skies use the column pipeline's shared buffers so they stay here, and
+// the flats are cached beforehand because the zone allocator isn't thread
+// safe either.
+//
 
 void R_DrawPlanes (void)
 {
+  boolean threaded = threaded_flats;
   visplane_t *pl;
   int i;
+
   for (i=0;i<MAXVISPLANES;i++)
     for (pl=visplanes[i]; pl; pl=pl->next, rendered_visplanes++)
-      R_DoDrawPlane(pl);
+      pl->source = (pl->minx <= pl->maxx && !R_IsSkyPlane(pl)) ?
+        W_CacheLumpNum(firstflat + flattranslation[pl->picnum]) : NULL;
+
+  plane_contexts[0].x1 = 0;
+  plane_contexts[0].x2 = threaded ? viewwidth / 2 - 1 : viewwidth - 1;
+  plane_contexts[1].x1 = plane_contexts[0].x2 + 1;
+  plane_contexts[1].x2 = viewwidth - 1;
+
+  if (threaded && !I_StartWorker(R_DrawFlatPlanes, &plane_contexts[1]))
+  {
+    plane_contexts[0].x2 = viewwidth - 1;
+    threaded = false;
+  }
+
+  for (i=0;i<MAXVISPLANES;i++)
+    for (pl=visplanes[i]; pl; pl=pl->next)
+      if (pl->minx <= pl->maxx && R_IsSkyPlane(pl))
+        R_DrawSkyPlane(pl);
+
+  R_DrawFlatPlanes(&plane_contexts[0]);
+
+  if (threaded)
+    I_WaitWorker();
+
+  for (i=0;i<MAXVISPLANES;i++)
+    for (pl=visplanes[i]; pl; pl=pl->next)
+      if (pl->source)
+        W_UnlockLumpNum(firstflat + flattranslation[pl->picnum]);
 }
@@ -48,6 +48,7 @@ extern int *lastopening; // dropoff overflow
 
 extern int floorclip[], ceilingclip[]; // dropoff overflow
 extern fixed_t yslope[], distscale[];
+extern boolean threaded_flats; /* see R_DrawPlanes */
 
 void R_ClearPlanes(void);
 void R_DrawPlanes(void);
@@ -123,19 +123,22 @@ static void W_AddFile(wadfile_info_t *wadfile)
   filelump_t *lumpindex, *fileinfo;
   wadinfo_t header;
 
-  // If we do not have the whole thing in memory then we open it from disk
+  // Map the file if the platform can, lumps are then used in place instead of cached
   if (!wadfile->data)
   {
-    wadfile->handle = fopen(wadfile->name, "rb");
+    wadfile->data = rg_storage_map(wadfile->name, &wadfile->size, RG_MAP_NO_COPY);
+  }
+
+  // If we do not have the whole thing in memory then we read it from disk (compressed or not)
+  if (!wadfile->data)
+  {
+    wadfile->handle = rg_storage_reader_open(wadfile->name);
 #ifdef HAVE_NET
     if (!wadfile->handle && D_NetGetWad(wadfile->name)) // CPhipps
-      wadfile->handle = fopen(wadfile->name, "rb");
+      wadfile->handle = rg_storage_reader_open(wadfile->name);
 #endif
     if (wadfile->handle)
-    {
-      fseek(wadfile->handle, 0, SEEK_END);
-      wadfile->size = ftell(wadfile->handle);
-    }
+      wadfile->size = rg_storage_reader_size(wadfile->handle);
   }
 
   if (!wadfile->handle && !wadfile->data)
@@ -404,9 +407,7 @@ int W_Read(void *dest, size_t size, size_t offset, wadfile_info_t *wad)
   }
   else if (wad->handle)
   {
-    fseek(wad->handle, offset, SEEK_SET);
-    fread(dest, size, 1, wad->handle);
-    return size;
+    return rg_storage_reader_read(wad->handle, offset, dest, size);
   }
   return -1;
 }
@@ -440,6 +441,102 @@ void W_ReadLump(void *dest, int lump)
   }
 }
 
+//
+// W_PrefetchLumps
+// Loads the given lumps into the cache ahead of their first use, unlocked
+// and purgable just like a cached lump that was released. The list is
+// sorted by file position so that neighbouring lumps come in with one
+// large sequential read instead of a seek and a small read each.
+//
+#define PREFETCH_MAX_GAP  4096  // Read through holes smaller than this
+#define PREFETCH_MAX_READ 65536 // Largest coalesced read, bigger lumps are read alone
+
+static int W_ComparePosition(const void *a, const void *b)
+{
+  const lumpinfo_t *la = &lumpinfo[*(const int *)a];
+  const lumpinfo_t *lb = &lumpinfo[*(const int *)b];
+
+  if (la->wadfile != lb->wadfile)
+    return la->wadfile < lb->wadfile ? -1 : 1;
+  if (la->position != lb->position)
+    return la->position < lb->position ? -1 : 1;
+  return *(const int *)a - *(const int *)b;
+}
+
+void W_PrefetchLumps(int *lumps, size_t count)
+{
+  int start_time = I_GetTimeMS();
+  size_t wanted = 0, reads = 0, bytes = 0;
+  byte *buffer = NULL;
+
+  // Only keep the lumps that would have to be read from disk
+  for (size_t i = 0; i < count; i++)
+  {
+    if ((unsigned)lumps[i] >= numlumps)
+      continue;
+    const lumpinfo_t *l = &lumpinfo[lumps[i]];
+    if (l->ptr || l->size == 0 || !l->wadfile || l->wadfile->data || !l->wadfile->handle)
+      continue;
+    lumps[wanted++] = lumps[i];
+  }
+
+  qsort(lumps, wanted, sizeof(int), W_ComparePosition);
+
+  // A lump listed twice is now next to itself, keep one so that it's only cached once
+  size_t unique = 0;
+  for (size_t i = 0; i < wanted; i++)
+  {
+    if (unique == 0 || lumps[i] != lumps[unique - 1])
+      lumps[unique++] = lumps[i];
+  }
+  wanted = unique;
+
+  for (size_t i = 0, j; i < wanted; i = j)
+  {
+    lumpinfo_t *first = &lumpinfo[lumps[i]];
+    size_t end = first->position + first->size;
+
+    // Grow the run while the next lump is close and the read stays reasonable
+    for (j = i + 1; j < wanted; j++)
+    {
+      const lumpinfo_t *l = &lumpinfo[lumps[j]];
+      size_t new_end = MAX(end, l->position + l->size);
+      if (l->wadfile != first->wadfile || l->position > end + PREFETCH_MAX_GAP
+          || new_end - first->position > PREFETCH_MAX_READ)
+        break;
+      end = new_end;
+    }
+
+    if (j == i + 1)
+    {
+      W_ReadLump(Z_Malloc(first->size, PU_CACHE, &first->ptr), lumps[i]);
+      first->locks = 0;
+    }
+    else
+    {
+      if (!buffer)
+        buffer = Z_Malloc(PREFETCH_MAX_READ, PU_STATIC, NULL);
+      W_Read(buffer, end - first->position, first->position, first->wadfile);
+      for (size_t k = i; k < j; k++)
+      {
+        lumpinfo_t *l = &lumpinfo[lumps[k]];
+        memcpy(Z_Malloc(l->size, PU_CACHE, &l->ptr), buffer + (l->position - first->position), l->size);
+        l->locks = 0;
+      }
+    }
+
+    reads++;
+    bytes += end - first->position;
+  }
+
+  if (buffer)
+    Z_Free(buffer);
+
+  if (wanted)
+    lprintf(LO_INFO, "W_PrefetchLumps: %d lumps, %dKB in %d reads, %dms\n",
+      (int)wanted, (int)(bytes / 1024), (int)reads, I_GetTimeMS() - start_time);
+}
+
 //
 // W_CacheLumpNum
 //
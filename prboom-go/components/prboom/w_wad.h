@@ -101,6 +101,7 @@ void    W_InitCache(void);
 void    W_DoneCache(void);
 const void* W_CacheLumpNum(int lump);
 void    W_UnlockLumpNum(int lump);
+void    W_PrefetchLumps(int *lumps, size_t count);
 
 // CPhipps - convenience macros
 #define W_CheckNumForName(name) W_CheckNumForNameNs(name, ns_global)
@@ -35,12 +35,16 @@
 #include <m_misc.h>
 #include <r_draw.h>
 #include <r_fps.h>
+#include <r_main.h>
+#include <r_plane.h>
 #include <s_sound.h>
 #include <st_stuff.h>
 #include <mus2mid.h>
 #include <midifile.h>
 #include <oplplayer.h>
 #include <rg_system.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 
 // 22050 reduces perf by almost 15% but 11025 sounds awful on the G32...
 #ifdef RG_TARGET_MRGC_G32
@@ -52,7 +56,9 @@
 #define AUDIO_BUFFER_LENGTH (AUDIO_SAMPLE_RATE / TICRATE + 1)
 #define NUM_MIX_CHANNELS 8
 
-static rg_video_update_t update;
+static rg_video_update_t updates[2];
+static rg_video_update_t *currentUpdate = &updates[0];
+static bool fullUpdate = true;
 static rg_app_t *app;
 
 // Expected variables by doom
@@ -100,6 +106,11 @@ static const struct {int mask; int *key;} keymap[] = {
 };
 
 static const char *SETTING_GAMMA = "Gamma";
+static const char *SETTING_THREADED_FLATS = "ThreadedFlats";
+
+static SemaphoreHandle_t worker_start, worker_done;
+static void (*worker_func)(void *);
+static void *worker_arg;
 
 
 static rg_gui_event_t gamma_update_cb(rg_gui_option_t *option, rg_gui_event_t event)
@@ -117,7 +128,7 @@ static rg_gui_event_t gamma_update_cb(rg_gui_option_t *option, rg_gui_event_t ev
     {
         usegamma = gamma;
         I_SetPalette(current_palette);
-        rg_display_queue_update(&update, NULL);
+        rg_display_queue_update(currentUpdate, NULL);
         rg_settings_set_number(NS_APP, SETTING_GAMMA, gamma);
         usleep(50000);
     }
@@ -128,6 +139,57 @@ static rg_gui_event_t gamma_update_cb(rg_gui_option_t *option, rg_gui_event_t ev
 }
 
 
+static rg_gui_event_t threaded_flats_cb(rg_gui_option_t *option, rg_gui_event_t event)
+{
+    if (event == RG_DIALOG_PREV || event == RG_DIALOG_NEXT)
+    {
+        threaded_flats = !threaded_flats;
+        rg_settings_set_number(NS_APP, SETTING_THREADED_FLATS, threaded_flats);
+    }
+
+    strcpy(option->value, threaded_flats ? "On " : "Off");
+
+    return RG_DIALOG_VOID;
+}
+
+static rg_gui_event_t timedemo_cb(rg_gui_option_t *option, rg_gui_event_t event)
+{
+    if (event == RG_DIALOG_ENTER)
+    {
+        // Same as -timedemo: plays DEMO1 as fast as possible then logs the fps (see G_CheckDemoStatus)
+        singletics = timingdemo = singledemo = true;
+        G_DeferedPlayDemo("demo1");
+        return RG_DIALOG_CLOSE;
+    }
+
+    return RG_DIALOG_VOID;
+}
+
+static void workerTask(void *arg)
+{
+    while (1)
+    {
+        xSemaphoreTake(worker_start, portMAX_DELAY);
+        worker_func(worker_arg);
+        xSemaphoreGive(worker_done);
+    }
+}
+
+bool I_StartWorker(void (*func)(void *), void *arg)
+{
+    if (!worker_start)
+        return false;
+    worker_func = func;
+    worker_arg = arg;
+    xSemaphoreGive(worker_start);
+    return true;
+}
+
+void I_WaitWorker(void)
+{
+    xSemaphoreTake(worker_done, portMAX_DELAY);
+}
+
 void I_StartFrame(void)
 {
     //
@@ -140,8 +202,19 @@ void I_UpdateNoBlit(void)
 
 void I_FinishUpdate(void)
 {
-    rg_display_queue_update(&update, NULL);
-    rg_display_sync(); // Wait for update->buffer to be released
+    rg_video_update_t *previousUpdate = &updates[currentUpdate == &updates[0]];
+
+    // previousUpdate is what's on screen, the diff will skip whatever didn't change (status bar, border)
+    rg_display_queue_update(currentUpdate, fullUpdate ? NULL : previousUpdate);
+    fullUpdate = false;
+
+    // The display task only holds one update, previousUpdate was released when the queue accepted
+    // currentUpdate. Doom only redraws what changed outside of the view, so the frame is carried over
+    // and the next one is rendered there while this one is being sent.
+    memcpy(previousUpdate->buffer, currentUpdate->buffer, SCREENWIDTH * SCREENHEIGHT);
+    currentUpdate = previousUpdate;
+    screens[0].data = currentUpdate->buffer;
+    R_InitBuffer(scaledviewwidth, viewheight); // The renderer caches pointers into screens[0]
 }
 
 bool I_StartDisplay(void)
@@ -158,8 +231,9 @@ void I_SetPalette(int pal)
 {
     uint16_t *palette = V_BuildPalette(pal, 16);
     for (int i = 0; i < 256; i++)
-        update.palette[i] = palette[i] << 8 | palette[i] >> 8;
+        updates[0].palette[i] = updates[1].palette[i] = palette[i] << 8 | palette[i] >> 8;
     Z_Free(palette);
+    fullUpdate = true; // The pixels might not change, the diff wouldn't see it
     current_palette = pal;
 }
 
@@ -174,7 +248,7 @@ void I_InitGraphics(void)
     }
 
     // Main screen uses internal ram for speed
-    screens[0].data = update.buffer;
+    screens[0].data = currentUpdate->buffer;
     screens[0].not_on_heap = true;
 
     // statusbar
@@ -418,7 +492,7 @@ void I_StartTic(void)
     static int64_t last_time = 0;
     static int32_t prev_joystick = 0x0000;
     static int32_t rg_menu_delay = 0;
-    uint32_t joystick = rg_input_read_gamepad();
+    uint32_t joystick = rg_input_sample();
     uint32_t changed = prev_joystick ^ joystick;
     event_t event = {0};
 
@@ -468,12 +542,27 @@ void I_Init(void)
     snd_MusicVolume = 15;
     snd_SfxVolume = 15;
     usegamma = rg_settings_get_number(NS_APP, SETTING_GAMMA, 0);
+    threaded_flats = rg_settings_get_number(NS_APP, SETTING_THREADED_FLATS, 0);
+
+    // The worker draws half of the flats (see R_DrawPlanes). The main task runs on core 0,
+    // the worker shares core 1 with the display and sound tasks but only briefly.
+    // The span drawers need little stack but R_MapPlane can I_Error, which formats and panics.
+    // Without a worker I_StartWorker fails and the flats are all drawn by the main task.
+    worker_start = xSemaphoreCreateBinary();
+    worker_done = xSemaphoreCreateBinary();
+    if (!worker_start || !worker_done || !rg_task_create("doom_render", &workerTask, NULL, 4 * 1024, 6, 1))
+    {
+        RG_LOGE("Failed to start the render worker, flats will be drawn single-threaded\n");
+        if (worker_start) vSemaphoreDelete(worker_start);
+        if (worker_done) vSemaphoreDelete(worker_done);
+        worker_start = worker_done = NULL;
+    }
 }
 
 static bool screenshot_handler(const char *filename, int width, int height)
 {
     Z_FreeTags(PU_CACHE, PU_CACHE); // At this point the heap is usually full. Let's reclaim some!
-	return rg_display_save_frame(filename, &update, width, height);
+	return rg_display_save_frame(filename, currentUpdate, width, height);
 }
 
 static bool save_state_handler(const char *filename)
@@ -507,10 +596,14 @@ static void event_handler(int event, void *arg)
 
 bool is_iwad(const char *path)
 {
-    FILE *fp = fopen(path, "rb");
-    bool valid = fp && fgetc(fp) == 'I' && fgetc(fp) == 'W';
-    fclose(fp);
-    return valid;
+    rg_reader_t *reader = rg_storage_reader_open(path);
+    char magic[2] = {0};
+    if (reader)
+    {
+        rg_storage_reader_read(reader, 0, magic, 2);
+        rg_storage_reader_close(reader);
+    }
+    return magic[0] == 'I' && magic[1] == 'W';
 }
 
 void app_main()
@@ -524,26 +617,32 @@ void app_main()
     };
     const rg_gui_option_t options[] = {
         {0, "Gamma Boost", "0/5", 1, &gamma_update_cb},
+        {0, "Threaded flats", "Off", 1, &threaded_flats_cb},
+        {0, "Timedemo", NULL, 1, &timedemo_cb},
         RG_DIALOG_CHOICE_LAST
     };
 
     app = rg_system_init(AUDIO_SAMPLE_RATE, &handlers, options);
     app->refreshRate = TICRATE;
 
-    update.buffer = rg_alloc(SCREENHEIGHT*SCREENWIDTH, MEM_FAST);
+    updates[0].buffer = rg_alloc(SCREENHEIGHT*SCREENWIDTH, MEM_FAST);
+    updates[1].buffer = rg_alloc(SCREENHEIGHT*SCREENWIDTH, MEM_FAST);
 
     const char *save = RG_BASE_PATH_SAVES "/doom";
     const char *iwad = NULL;
     const char *pwad = NULL;
-    FILE *fp;
+    rg_reader_t *reader;
 
-    if ((fp = fopen(app->romPath, "rb")))
+    // Compressed wads are only told apart by their content, so read it through the storage reader
+    if ((reader = rg_storage_reader_open(app->romPath)))
     {
-        if (fgetc(fp) == 'P')
+        char magic = 0;
+        rg_storage_reader_read(reader, 0, &magic, 1);
+        if (magic == 'P')
             pwad = app->romPath;
         else
             iwad = app->romPath;
-        fclose(fp);
+        rg_storage_reader_close(reader);
     }
 
     if (!iwad)
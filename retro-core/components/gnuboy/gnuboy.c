@@ -136,11 +136,25 @@ int gnuboy_load_bios(const char *file)
 }
 
 
+static inline bool bank_is_mapped(int bank)
+{
+	return cart.romData && cart.rombanks[bank] >= cart.romData
+		&& cart.rombanks[bank] < cart.romData + cart.romSize;
+}
+
+
 void gnuboy_load_bank(int bank)
 {
 	const size_t BANK_SIZE = 0x4000;
 	const size_t OFFSET = bank * BANK_SIZE;
 
+	// A mapped ROM needs no copy, the bank is paged in on first access
+	if (cart.romData && OFFSET + BANK_SIZE <= cart.romSize)
+	{
+		cart.rombanks[bank] = cart.romData + OFFSET;
+		return;
+	}
+
 	if (!cart.rombanks[bank])
 		cart.rombanks[bank] = malloc(BANK_SIZE);
 
@@ -151,7 +165,7 @@ void gnuboy_load_bank(int bank)
 	while (!cart.rombanks[bank])
 	{
 		int i = rand() & 0xFF;
-		if (cart.rombanks[i])
+		if (cart.rombanks[i] && !bank_is_mapped(i))
 		{
 			MESSAGE_INFO("reclaiming bank %d.\n", i);
 			cart.rombanks[bank] = cart.rombanks[i];
@@ -160,12 +174,11 @@ void gnuboy_load_bank(int bank)
 		}
 	}
 
-	// Load the 16K page
-	if (fseek(cart.romFile, OFFSET, SEEK_SET) != 0
-		|| !fread(cart.rombanks[bank], BANK_SIZE, 1, cart.romFile))
+	// Load the 16K page (the reader decompresses it if the ROM is stored compressed)
+	if (rg_storage_reader_read(cart.romFile, OFFSET, cart.rombanks[bank], BANK_SIZE) != BANK_SIZE)
 	{
 		MESSAGE_WARN("ROM bank loading failed\n");
-		if (!feof(cart.romFile))
+		if (OFFSET < rg_storage_reader_size(cart.romFile))
 			abort(); // This indicates an SD Card failure
 	}
 }
@@ -188,20 +201,24 @@ int gnuboy_load_rom(const char *file)
 
 	byte header[0x200];
 
-	cart.romFile = fopen(file, "rb");
+	cart.romFile = rg_storage_reader_open(file);
 	if (cart.romFile == NULL)
 	{
 		MESSAGE_ERROR("ROM fopen failed");
 		return -1;
 	}
 
-	if (fread(&header, 0x200, 1, cart.romFile) != 1)
+	if (rg_storage_reader_read(cart.romFile, 0, &header, 0x200) != 0x200)
 	{
 		MESSAGE_ERROR("ROM fread failed");
-		fclose(cart.romFile);
+		rg_storage_reader_close(cart.romFile);
+		cart.romFile = NULL;
 		return -1;
 	}
 
+	// Large ROMs don't fit in memory on the device, only use the map when it's not a copy
+	cart.romData = rg_storage_map(file, &cart.romSize, RG_MAP_NO_COPY);
+
 	int type = header[0x0147];
 	int romsize = header[0x0148];
 	int ramsize = header[0x0149];
@@ -394,17 +411,19 @@ void gnuboy_free_rom(void)
 {
 	for (int i = 0; i < 512; i++)
 	{
-		if (cart.rombanks[i]) {
+		if (cart.rombanks[i] && !bank_is_mapped(i))
 			free(cart.rombanks[i]);
-			cart.rombanks[i] = NULL;
-		}
+		cart.rombanks[i] = NULL;
 	}
+	rg_storage_unmap(cart.romData);
+	cart.romData = NULL;
+	cart.romSize = 0;
 	free(cart.rambanks);
 	cart.rambanks = NULL;
 
 	if (cart.romFile)
 	{
-		fclose(cart.romFile);
+		rg_storage_reader_close(cart.romFile);
 		cart.romFile = NULL;
 	}
 
@@ -450,6 +469,13 @@ void gnuboy_set_hwtype(gb_hwtype_t type)
 }
 
 
+void gnuboy_set_pixformat(gb_pixformat_t format)
+{
+	host.video.format = format;
+	lcd_pal_dirty();
+}
+
+
 int gnuboy_get_palette(void)
 {
 	return host.video.colorize;
@@ -633,7 +659,9 @@ typedef struct
 } sblock_t;
 
 
-static int do_save_load(const char *file, bool save)
+// Snapshots are in-memory states used by run-ahead. They skip the compatibility
+// hacks and also include the internal sound state to avoid audible glitches.
+static int do_save_load(FILE *fp, bool save, bool snapshot)
 {
 	uint32_t sav_ver = SAVE_VERSION;
 	const svar_t svars[] =
@@ -718,13 +746,8 @@ static int do_save_load(const char *file, bool save)
 		{NULL, 0},
 	};
 
-	FILE *fp = NULL;
-
 	if (save)
 	{
-		if (!(fp = fopen(file, "wb")))
-			goto _error;
-
 		for (int i = 0; svars[i].ptr; i++)
 		{
 			uint32_t d = 0;
@@ -759,12 +782,12 @@ static int do_save_load(const char *file, bool save)
 				goto _error;
 			}
 		}
+
+		if (snapshot && fwrite(hw.snd, sizeof(gb_snd_t), 1, fp) < 1)
+			goto _error;
 	}
 	else
 	{
-		if (!(fp = fopen(file, "rb")))
-			goto _error;
-
 		for (int i = 0; blocks[i].ptr != NULL; i++)
 		{
 			if (fread(blocks[i].ptr, 4096, blocks[i].len, fp) < 1)
@@ -774,6 +797,9 @@ static int do_save_load(const char *file, bool save)
 			}
 		}
 
+		if (snapshot && fread(hw.snd, sizeof(gb_snd_t), 1, fp) < 1)
+			goto _error;
+
 		for (int i = 0; svars[i].ptr; i++)
 		{
 			uint32_t d = 0;
@@ -809,25 +835,27 @@ static int do_save_load(const char *file, bool save)
 		memcpy(hw.oam, buf + 0xF00, 256);
 		memcpy(hw.snd->wave, buf + 0xCF0, 16);
 
-		// Disable BIOS. This is a hack to support old saves
-		R_BIOS = 0x1;
+		if (!snapshot)
+		{
+			// Disable BIOS. This is a hack to support old saves
+			R_BIOS = 0x1;
+
+			// Older saves might overflow this
+			cart.rambank &= (cart.ramsize - 1);
 
-		// Older saves might overflow this
-		cart.rambank &= (cart.ramsize - 1);
+			sound_dirty();
+		}
 
 		lcd_pal_dirty();
-		sound_dirty();
 		hw_updatemap();
 	}
 
-	fclose(fp);
 	free(buf);
 
 	return 0;
 
 _error:
-	if (fp) fclose(fp);
-	if (buf) free(buf);
+	free(buf);
 
 	return -1;
 }
@@ -835,11 +863,57 @@ _error:
 
 int gnuboy_save_state(const char *file)
 {
-	return do_save_load(file, true);
+	FILE *fp = fopen(file, "wb");
+	if (!fp)
+		return -1;
+
+	int ret = do_save_load(fp, true, false);
+
+	if (fclose(fp) != 0)
+		ret = -1;
+
+	return ret;
 }
 
 
 int gnuboy_load_state(const char *file)
 {
-	return do_save_load(file, false);
+	FILE *fp = fopen(file, "rb");
+	if (!fp)
+		return -1;
+
+	int ret = do_save_load(fp, false, false);
+	fclose(fp);
+
+	return ret;
+}
+
+
+int gnuboy_save_snapshot(void *buffer, size_t *size)
+{
+	FILE *fp = fmemopen(buffer, *size, "wb");
+	if (!fp)
+		return -1;
+
+	int ret = do_save_load(fp, true, true);
+	*size = ftell(fp);
+
+	// fmemopen reports overflows when flushing
+	if (fclose(fp) != 0)
+		ret = -1;
+
+	return ret;
+}
+
+
+int gnuboy_load_snapshot(void *buffer, size_t size)
+{
+	FILE *fp = fmemopen(buffer, size, "rb");
+	if (!fp)
+		return -1;
+
+	int ret = do_save_load(fp, false, true);
+	fclose(fp);
+
+	return ret;
 }
@@ -6,7 +6,7 @@
 
 #ifdef RETRO_GO
 #include <rg_system.h>
-#define LOG_PRINTF(level, x...) rg_system_log(RG_LOG_USER, NULL, x)
+#define LOG_PRINTF(level, fmt, x...) rg_system_log(RG_LOG_USER | RG_LOG_FLAGS(fmt), NULL, fmt, ## x)
 #else
 #define LOG_PRINTF(level, x...) printf(x)
 #define IRAM_ATTR
@@ -20,6 +20,7 @@
 
 #define GB_WIDTH (160)
 #define GB_HEIGHT (144)
+#define GB_PALETTE_BANKS (4)
 
 typedef uint8_t byte;
 
@@ -103,7 +104,9 @@ typedef struct
 			uint8_t *buffer8;
 			void *buffer;
 		};
-		uint16_t palette[64];
+		// In GB_PIXEL_PALETTED mode pixels are (bank << 6 | color) and each palette change
+		// within a frame uses the next bank. The palette is big-endian in that mode.
+		uint16_t palette[64 * GB_PALETTE_BANKS];
 	} video;
 
 	struct {
@@ -132,6 +135,7 @@ void gnuboy_get_time(int *day, int *hour, int *minute, int *second);
 void gnuboy_set_time(int day, int hour, int minute, int second);
 int  gnuboy_get_hwtype(void);
 void gnuboy_set_hwtype(gb_hwtype_t type);
+void gnuboy_set_pixformat(gb_pixformat_t format);
 int  gnuboy_get_palette(void);
 void gnuboy_set_palette(gb_palette_t pal);
 
@@ -139,3 +143,5 @@ int gnuboy_load_sram(const char *file);
 int gnuboy_save_sram(const char *file, bool quick_save);
 int gnuboy_load_state(const char *file);
 int gnuboy_save_state(const char *file);
+int gnuboy_load_snapshot(void *buffer, size_t size);
+int gnuboy_save_snapshot(void *buffer, size_t *size);
@@ -11,6 +11,19 @@ gb_hw_t GB;
 
 #define hw GB
 
+#ifdef RG_ENABLE_MEMTRACE
+enum {TRACE_BUS, TRACE_IO};
+
+static inline void hw_trace(unsigned a, bool write)
+{
+	rg_memtrace_access(TRACE_BUS, a, write);
+	if (a >= 0xFF00)
+		rg_memtrace_access(TRACE_IO, a, write);
+}
+#else
+#define hw_trace(a, write)
+#endif
+
 static void rtc_latch(byte b)
 {
 	if ((cart.rtc.latch ^ b) & b & 1)
@@ -214,6 +227,12 @@ gb_hw_t *hw_init(void)
 	hw.cpu = cpu_init();
 	hw.cart = &cart;
 
+#ifdef RG_ENABLE_MEMTRACE
+	// Only accesses that miss the cpu's read/write maps are seen
+	rg_memtrace_region(TRACE_BUS, "bus", 0x0000, 8);
+	rg_memtrace_region(TRACE_IO, "io/hram", 0xFF00, 0);
+#endif
+
 	if (!hw.rambanks || !hw.vbanks || !hw.cpu || !hw.snd)
 	{
 		// hw_deinit();
@@ -268,7 +287,7 @@ void hw_vblank(void)
 {
 	hw.frames++;
 	rtc_tick();
-	sound_emulate();
+	sound_end_frame();
 }
 
 
@@ -464,6 +483,7 @@ static inline void mbc_write(unsigned a, byte b)
 void hw_write(unsigned a, byte b)
 {
 	MESSAGE_DEBUG("write to 0x%04X: 0x%02X\n", a, b);
+	hw_trace(a, true);
 
 	switch (a & 0xE000)
 	{
@@ -656,6 +676,7 @@ void hw_write(unsigned a, byte b)
 byte hw_read(unsigned a)
 {
 	MESSAGE_DEBUG("read %04x\n", a);
+	hw_trace(a, false);
 
 	switch (a & 0xE000)
 	{
@@ -182,6 +182,8 @@ typedef struct
 
 	// Memory
 	byte *rombanks[512];
+	byte *romData; // Whole ROM when it could be mapped, banks then point into it
+	size_t romSize;
 	byte (*rambanks)[8192];
 	unsigned sram_dirty;
 	unsigned sram_saved;
@@ -201,7 +203,7 @@ typedef struct
 	int rambank;
 
 	// File descriptors that we keep open
-	FILE *romFile;
+	rg_reader_t *romFile;
 	FILE *sramFile;
 } gb_cart_t;
 
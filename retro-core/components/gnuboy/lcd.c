@@ -26,6 +26,7 @@ typedef struct
 static byte BUF[0x100];
 static int WX, WY;
 static bool pal_dirty;
+static int pal_bank;
 
 
 /**
@@ -544,7 +545,7 @@ void lcd_lcdc_change(byte b)
 }
 
 
-static inline void sync_palette(void)
+static inline void sync_palette(uint16_t *palette)
 {
 	MESSAGE_DEBUG("Syncing palette...\n");
 
@@ -589,10 +590,11 @@ static inline void sync_palette(void)
 
 		int out = (r << 11) | (g << 6) | (b);
 
-		if (host.video.format == GB_PIXEL_565_BE)
-			host.video.palette[i] = (out << 8) | (out >> 8);
+		// Paletted output is meant to be expanded straight into the SPI buffer
+		if (host.video.format != GB_PIXEL_565_LE)
+			palette[i] = (out << 8) | (out >> 8);
 		else
-			host.video.palette[i] = out;
+			palette[i] = out;
 	}
 
 	pal_dirty = false;
@@ -685,20 +687,57 @@ static inline void lcd_renderline()
 
 	// Real hardware allows palette change to occur between each scanline but very few games take
 	// advantage of this. So we can switch to once per frame if performance becomes a problem...
-	if (pal_dirty) // && SL == 0)
-	{
-		sync_palette();
-	}
-
 	if (host.video.format == GB_PIXEL_PALETTED)
 	{
-		memcpy(host.video.buffer8 + SL * 160 , BUF, 160);
+		uint16_t *palette = host.video.palette;
+		byte *dst = host.video.buffer8 + SL * 160;
+
+		// In paletted mode a mid-frame palette change goes into the next bank of 64 colors and the
+		// bank number is stored in the top bits of every pixel of the line, so lines already drawn
+		// keep their colors. Past the last bank the changes are applied to the whole bank, as before.
+		if (SL == 0)
+		{
+			if (pal_bank > 0 && !pal_dirty)
+				memcpy(palette, palette + pal_bank * 64, 64 * 2);
+			pal_bank = 0;
+		}
+
+		if (pal_dirty)
+		{
+			if (SL > 0 && pal_bank < GB_PALETTE_BANKS - 1)
+			{
+				sync_palette(palette + (pal_bank + 1) * 64);
+				// Some games rewrite the same colors on every line, don't waste banks on them
+				if (memcmp(palette + pal_bank * 64, palette + (pal_bank + 1) * 64, 64 * 2) != 0)
+					pal_bank++;
+			}
+			else
+			{
+				sync_palette(palette + pal_bank * 64);
+			}
+		}
+
+		if (pal_bank == 0)
+		{
+			memcpy(dst, BUF, 160);
+		}
+		else
+		{
+			for (int i = 0; i < 160; ++i)
+				dst[i] = BUF[i] | (pal_bank << 6);
+		}
 	}
 	else
 	{
 		uint16_t *dst = host.video.buffer16 + SL * 160;
 		uint16_t *pal = host.video.palette;
 
+		if (pal_dirty || pal_bank != 0)
+		{
+			sync_palette(pal);
+			pal_bank = 0;
+		}
+
 		for (int i = 0; i < 160; ++i)
 			dst[i] = pal[BUF[i]];
 	}
@@ -10,13 +10,26 @@
 #define S3 (snd.ch[2])
 #define S4 (snd.ch[3])
 
-#define s1_freq() {int d = 2048 - (((R_NR14&7)<<8) + R_NR13); S1.freq = (snd.rate > (d<<4)) ? 0 : (snd.rate << 17)/d;}
-#define s2_freq() {int d = 2048 - (((R_NR24&7)<<8) + R_NR23); S2.freq = (snd.rate > (d<<4)) ? 0 : (snd.rate << 17)/d;}
-#define s3_freq() {int d = 2048 - (((R_NR34&7)<<8) + R_NR33); S3.freq = (snd.rate > (d<<3)) ? 0 : (snd.rate << 21)/d;}
-#define s4_freq() {S4.freq = (freqtab[R_NR43&7] >> (R_NR43 >> 4)) * snd.rate; if (S4.freq >> 18) S4.freq = 1<<18;}
+// Length counters, envelopes and sweep are clocked every SEQ_STEP cycles (512Hz)
+#define SEQ_STEP (1 << 12)
+
+// ch.freq is the number of cycles between two steps of the waveform, 0 when it is out of audible range
+#define s1_freq() {int d = 2048 - (((R_NR14&7)<<8) + R_NR13); S1.freq = (snd.rate > (d<<4)) ? 0 : d << 1;}
+#define s2_freq() {int d = 2048 - (((R_NR24&7)<<8) + R_NR23); S2.freq = (snd.rate > (d<<4)) ? 0 : d << 1;}
+#define s3_freq() {int d = 2048 - (((R_NR34&7)<<8) + R_NR33); S3.freq = (snd.rate > (d<<3)) ? 0 : d;}
+#define s4_freq() {int f = freqtab[R_NR43&7] >> (R_NR43 >> 4); S4.freq = f ? (1 << 17) / f : 0; \
+				   if (S4.freq && S4.freq < (snd.rate >> 1)) S4.freq = snd.rate >> 1;}
 
 static gb_snd_t snd;
 
+// The channels only report changes of their output to the band-limited buffers (left, right).
+// Nothing is sent while host.audio.buffer is NULL (run-ahead), the buffers and the levels below
+// then still match once the snapshot is restored.
+static rg_blip_t *blip[2];
+static struct {
+	int left, right; // Output last sent to the buffers
+} osc[4];
+
 
 void sound_dirty(void)
 {
@@ -85,171 +98,235 @@ void sound_reset(bool hard)
 	memcpy(GB.ioregs + 0x30, snd.wave, 16);
 	snd.rate = (int)(((1<<21) / (double)host.audio.samplerate) + 0.5);
 	host.audio.pos = 0;
+	if (!blip[0])
+	{
+		blip[0] = rg_blip_create(host.audio.samplerate / 10);
+		if (host.audio.stereo)
+			blip[1] = rg_blip_create(host.audio.samplerate / 10);
+	}
+	for (int i = 0; i < 2; i++)
+	{
+		if (!blip[i])
+			continue;
+		rg_blip_set_rates(blip[i], 1 << 21, host.audio.samplerate);
+		rg_blip_clear(blip[i]);
+	}
+	memset(osc, 0, sizeof(osc));
 	sound_off();
 	R_NR52 = 0xF1;
 }
 
-void sound_emulate(void)
+static inline int channel_level(int c)
 {
-	if (!snd.rate || snd.cycles < snd.rate)
-		return;
+	int s;
 
-	int16_t *output_buf = host.audio.buffer + host.audio.pos;
-	int16_t *output_end = host.audio.buffer + host.audio.len;
-	bool stereo = host.audio.stereo;
-
-	for (; snd.cycles >= snd.rate; snd.cycles -= snd.rate)
+	switch (c)
 	{
-		int l = 0;
-		int r = 0;
+	case 0:
+		return (sqwave[R_NR11>>6][S1.pos&7] & S1.envol) << 2;
 
-		if (S1.on)
-		{
-			int s = sqwave[R_NR11>>6][(S1.pos>>18)&7] & S1.envol;
-			S1.pos += S1.freq;
+	case 1:
+		return (sqwave[R_NR21>>6][S2.pos&7] & S2.envol) << 2;
 
-			if ((R_NR14 & 64) && ((S1.cnt += snd.rate) >= S1.len))
-				S1.on = 0;
+	case 2:
+		s = snd.wave[(S3.pos>>1) & 15];
+		s = (S3.pos & 1) ? (s & 15) : (s >> 4);
+		s -= 8;
+		return (R_NR32 & 96) ? s << (3 - ((R_NR32>>5)&3)) : 0;
 
-			if (S1.enlen && (S1.encnt += snd.rate) >= S1.enlen)
-			{
-				S1.encnt -= S1.enlen;
-				S1.envol += S1.endir;
-				if (S1.envol < 0) S1.envol = 0;
-				if (S1.envol > 15) S1.envol = 15;
-			}
+	default:
+		if (R_NR43 & 8)
+			s = 1 & (noise7[(S4.pos>>3)&15] >> (7-(S4.pos&7)));
+		else
+			s = 1 & (noise15[(S4.pos>>3)&4095] >> (7-(S4.pos&7)));
+		s = (-s) & S4.envol;
+		return s + (s << 1);
+	}
+}
 
-			if (S1.swlen && (S1.swcnt += snd.rate) >= S1.swlen)
-			{
-				S1.swcnt -= S1.swlen;
-				int f = S1.swfreq;
-
-				if (R_NR10 & 8)
-					f -= (f >> (R_NR10 & 7));
-				else
-					f += (f >> (R_NR10 & 7));
-
-				if (f > 2047)
-					S1.on = 0;
-				else
-				{
-					S1.swfreq = f;
-					R_NR13 = f;
-					R_NR14 = (R_NR14 & 0xF8) | (f>>8);
-					s1_freq();
-				}
-			}
-			s <<= 2;
-			if (R_NR51 & 1) r += s;
-			if (R_NR51 & 16) l += s;
-		}
+static void channel_output(int c, unsigned time)
+{
+	int s = snd.ch[c].on ? channel_level(c) : 0;
+	int l = (R_NR51 & (16 << c)) ? (s * (R_NR50 & 0x07)) << 4 : 0;
+	int r = (R_NR51 & (1 << c)) ? (s * ((R_NR50 & 0x70)>>4)) << 4 : 0;
 
-		if (S2.on)
-		{
-			int s = sqwave[R_NR21>>6][(S2.pos>>18)&7] & S2.envol;
-			S2.pos += S2.freq;
+	if (!host.audio.buffer)
+		return;
 
-			if ((R_NR24 & 64) && ((S2.cnt += snd.rate) >= S2.len))
-				S2.on = 0;
+	if (!blip[1])
+	{
+		l = (l + r) >> 1;
+		r = 0;
+	}
 
-			if (S2.enlen && (S2.encnt += snd.rate) >= S2.enlen)
-			{
-				S2.encnt -= S2.enlen;
-				S2.envol += S2.endir;
-				if (S2.envol < 0) S2.envol = 0;
-				if (S2.envol > 15) S2.envol = 15;
-			}
-			s <<= 2;
-			if (R_NR51 & 2) r += s;
-			if (R_NR51 & 32) l += s;
-		}
+	if (l != osc[c].left)
+	{
+		rg_blip_add_delta(blip[0], time, l - osc[c].left);
+		osc[c].left = l;
+	}
 
-		if (S3.on)
-		{
-			int s = snd.wave[(S3.pos>>22) & 15];
+	if (r != osc[c].right)
+	{
+		rg_blip_add_delta(blip[1], time, r - osc[c].right);
+		osc[c].right = r;
+	}
+}
 
-			if (S3.pos & (1<<21))
-				s &= 15;
-			else
-				s >>= 4;
+static void channel_run(int c, int cycles)
+{
+	// Picks up envelope, volume and panning changes made since the last run
+	channel_output(c, snd.frame_time);
 
-			s -= 8;
-			S3.pos += S3.freq;
+	if (!snd.ch[c].on || !snd.ch[c].freq)
+		return;
 
-			if ((R_NR34 & 64) && ((S3.cnt += snd.rate) >= S3.len))
-				S3.on = 0;
+	int t = snd.ch[c].delay;
 
-			if (R_NR32 & 96)
-				s <<= (3 - ((R_NR32>>5)&3));
-			else
-				s = 0;
+	for (; t < cycles; t += snd.ch[c].freq)
+	{
+		snd.ch[c].pos++;
+		channel_output(c, snd.frame_time + t);
+	}
+
+	snd.ch[c].delay = t - cycles;
+}
+
+static void sequencer_step(void)
+{
+	if (S1.on)
+	{
+		if ((R_NR14 & 64) && ((S1.cnt += SEQ_STEP) >= S1.len))
+			S1.on = 0;
 
-			if (R_NR51 & 4) r += s;
-			if (R_NR51 & 64) l += s;
+		if (S1.enlen && (S1.encnt += SEQ_STEP) >= S1.enlen)
+		{
+			S1.encnt -= S1.enlen;
+			S1.envol += S1.endir;
+			if (S1.envol < 0) S1.envol = 0;
+			if (S1.envol > 15) S1.envol = 15;
 		}
 
-		if (S4.on)
+		if (S1.swlen && (S1.swcnt += SEQ_STEP) >= S1.swlen)
 		{
-			int s;
+			S1.swcnt -= S1.swlen;
+			int f = S1.swfreq;
 
-			if (R_NR43 & 8)
-				s = 1 & (noise7[(S4.pos>>20)&15] >> (7-((S4.pos>>17)&7)));
+			if (R_NR10 & 8)
+				f -= (f >> (R_NR10 & 7));
 			else
-				s = 1 & (noise15[(S4.pos>>20)&4095] >> (7-((S4.pos>>17)&7)));
+				f += (f >> (R_NR10 & 7));
 
-			s = (-s) & S4.envol;
-			S4.pos += S4.freq;
-
-			if ((R_NR44 & 64) && ((S4.cnt += snd.rate) >= S4.len))
-				S4.on = 0;
-
-			if (S4.enlen && (S4.encnt += snd.rate) >= S4.enlen)
+			if (f > 2047)
+				S1.on = 0;
+			else
 			{
-				S4.encnt -= S4.enlen;
-				S4.envol += S4.endir;
-				if (S4.envol < 0) S4.envol = 0;
-				if (S4.envol > 15) S4.envol = 15;
+				S1.swfreq = f;
+				R_NR13 = f;
+				R_NR14 = (R_NR14 & 0xF8) | (f>>8);
+				s1_freq();
 			}
+		}
+	}
 
-			s += s << 1;
+	if (S2.on)
+	{
+		if ((R_NR24 & 64) && ((S2.cnt += SEQ_STEP) >= S2.len))
+			S2.on = 0;
 
-			if (R_NR51 & 8) r += s;
-			if (R_NR51 & 128) l += s;
+		if (S2.enlen && (S2.encnt += SEQ_STEP) >= S2.enlen)
+		{
+			S2.encnt -= S2.enlen;
+			S2.envol += S2.endir;
+			if (S2.envol < 0) S2.envol = 0;
+			if (S2.envol > 15) S2.envol = 15;
 		}
+	}
 
-		l *= (R_NR50 & 0x07);
-		r *= ((R_NR50 & 0x70)>>4);
+	if (S3.on)
+	{
+		if ((R_NR34 & 64) && ((S3.cnt += SEQ_STEP) >= S3.len))
+			S3.on = 0;
+	}
 
-		l <<= 4;
-		r <<= 4;
+	if (S4.on)
+	{
+		if ((R_NR44 & 64) && ((S4.cnt += SEQ_STEP) >= S4.len))
+			S4.on = 0;
 
-		if (!output_buf || output_buf >= output_end)
+		if (S4.enlen && (S4.encnt += SEQ_STEP) >= S4.enlen)
 		{
-			continue;
+			S4.encnt -= S4.enlen;
+			S4.envol += S4.endir;
+			if (S4.envol < 0) S4.envol = 0;
+			if (S4.envol > 15) S4.envol = 15;
 		}
-		else if (stereo)
-		{
-			*output_buf++ = (int16_t)l; //+128;
-			*output_buf++ = (int16_t)r; //+128;
-		}
-		else
+	}
+}
+
+void sound_emulate(void)
+{
+	if (!snd.rate || !blip[0] || snd.cycles <= 0)
+		return;
+
+	while (snd.cycles > 0)
+	{
+		int cycles = SEQ_STEP - snd.seq_time;
+		if (cycles > snd.cycles)
+			cycles = snd.cycles;
+
+		for (int c = 0; c < 4; c++)
+			channel_run(c, cycles);
+
+		snd.frame_time += cycles;
+		snd.cycles -= cycles;
+
+		if ((snd.seq_time += cycles) >= SEQ_STEP)
 		{
-			*output_buf++ = (int16_t)((l+r)>>1); //+128;
+			snd.seq_time = 0;
+			sequencer_step();
 		}
 	}
 
-	host.audio.pos = output_buf - host.audio.buffer;
-
 	R_NR52 = (R_NR52&0xf0) | S1.on | (S2.on<<1) | (S3.on<<2) | (S4.on<<3);
 }
 
+void sound_end_frame(void)
+{
+	sound_emulate();
+
+	if (!blip[0] || !host.audio.buffer)
+	{
+		snd.frame_time = 0;
+		return;
+	}
+
+	int stride = blip[1] ? 2 : 1;
+	int count = 0;
+
+	for (int i = 0; i < 2 && blip[i]; i++)
+		rg_blip_end_frame(blip[i], snd.frame_time);
+	snd.frame_time = 0;
+
+	if (host.audio.pos < host.audio.len)
+	{
+		int16_t *output_buf = host.audio.buffer + host.audio.pos;
+		count = (host.audio.len - host.audio.pos) / stride;
+		for (int i = 0; i < 2 && blip[i]; i++)
+			count = rg_blip_read_samples(blip[i], output_buf + i, count, stride);
+		host.audio.pos += count * stride;
+	}
+
+	// Whatever didn't fit in the host buffer is dropped
+	for (int i = 0; i < 2 && blip[i]; i++)
+		rg_blip_read_samples(blip[i], NULL, rg_blip_samples_avail(blip[i]), 0);
+}
+
 void sound_write(byte r, byte b)
 {
 	if (!(R_NR52 & 128) && r != RI_NR52)
 		return;
 
-	if (snd.cycles >= snd.rate)
-		sound_emulate();
+	sound_emulate();
 
 	switch (r)
 	{
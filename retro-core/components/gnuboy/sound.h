@@ -5,9 +5,12 @@
 typedef struct
 {
 	int rate, cycles;
+	int seq_time;        // Cycles since the last sequencer step
+	unsigned frame_time; // Cycles since the last sound_end_frame
 	byte wave[16];
 	struct {
 		unsigned on, pos;
+		int delay; // Cycles until the next step of the waveform
 		int cnt, encnt, swcnt;
 		int len, enlen, swlen;
 		int swfreq, freq;
@@ -20,4 +23,5 @@ void sound_write(byte r, byte b);
 void sound_dirty(void);
 void sound_reset(bool hard);
 void sound_emulate(void);
+void sound_end_frame(void);
 #define sound_advance(count) GB.snd->cycles += (count)
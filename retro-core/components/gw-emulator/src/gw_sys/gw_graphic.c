@@ -49,6 +49,8 @@ static uint8 SEG_TRANSPARENT_COLOR = 0;
 #define SEG_WHITE_COLOR 0xff
 #define SEG_BLACK_COLOR 0x0
 
+#define GW_SEGMENTS_MAX 256
+
 /*** Basic Pixel functions ***/
 /*
   RGB multiplicative blending between background and segment 
@@ -73,150 +75,317 @@ static inline uint16 rgb_multiply_8bits(uint32 bg, uint32 sg)
 	return (uint16)(bg_r << 11) | (bg_g << 5) | bg_b;
 }
 
-/************************ Generic function to display a segment *****************/
-void (*update_segment)(uint8 segment_nb, bool segment_state);
+/*** Segments sprites cache ***/
+/*
+  Segments are unpacked once at ROM load. For each pixel we keep its 8bits
+  intensity (SEG_TRANSPARENT_COLOR when there is nothing to mix) and its colour
+  already multiplied with the background.
+  The pre-multiplied colour is exact unless the segment is mixed over another
+  lit segment, which only happens for 'shared' segments in non inverted mode.
+*/
+static uint8 *seg_cache = 0;
+static uint16 *seg_color[GW_SEGMENTS_MAX];
+static uint8 *seg_intensity[GW_SEGMENTS_MAX];
+static uint8 seg_shared[GW_SEGMENTS_MAX / 8];
+static int seg_count = 0;
+
+/* Segments state of the current and previous frame, and drawing order */
+static uint8 seg_state[GW_SEGMENTS_MAX / 8];
+static uint8 seg_state_prev[GW_SEGMENTS_MAX / 8];
+static uint8 seg_order[GW_SEGMENTS_MAX];
+static int seg_order_count = 0;
 
-/* Segment to framebuffer graphic function */
-/* segments are stored from 0 to 255 in memory*/
+/* Last framebuffer drawn, anything else needs a full redraw */
+static uint16 *last_framebuffer = 0;
 
-/* Deviation 2bits segment resolution function */
-__attribute__((optimize("unroll-loops"))) static inline void update_segment_2bits(uint8 segment_nb, bool segment_state)
+/* Screen areas changed by the last rendering */
+static gw_rect_t dirty_rects[GW_DIRTY_RECTS_MAX];
+static int dirty_rects_count = 0;
+
+#define SEG_BIT(map, nb) (((map)[(nb) >> 3] >> ((nb) & 7)) & 1)
+
+/* Get the 8bits intensity of pixel 'i' of a packed segment */
+static uint8 unpack_segment_pixel(uint32 segment, int i)
 {
+	uint8 cur_pixel;
 
-	/* segment first pixel corner (up/left) */
-	uint32 segment = gw_segments_offset[segment_nb];
+	/* Deviation 2bits segment resolution */
+	if (gw_head.flags & FLAG_SEGMENTS_2BITS)
+	{
+		int idx = (segment & 0x3) + i;
+		cur_pixel = (gw_segments[(segment >> 2) + (idx >> 2)] >> 2*(idx & 0x3)) & 0x3;
+		cur_pixel = cur_pixel | cur_pixel << 2 | cur_pixel << 4 | cur_pixel << 6;
 
-	uint8 cur_pixel,cur_pixelr;
-	int idx = 0;
+		if (cur_pixel == SEG_TRANSPARENT_COLOR)
+			return cur_pixel;
 
-	/* nothing to do for this segment */
-	if (segment_state == 0)
-		return;
+		// change black color to get transparency effect
+		return cur_pixel ? cur_pixel : 39;
+	}
+
+	/* Deviation 4bits segment resolution */
+	if (gw_head.flags & FLAG_SEGMENTS_4BITS)
+	{
+		int idx = (segment & 0x1) + i;
+		if ((idx & 0x1) == 0)
+			cur_pixel = gw_segments[(segment >> 1) + (idx >> 1)] & 0xF0;
+		else
+			cur_pixel = gw_segments[(segment >> 1) + (idx >> 1)] << 4;
 
-	/* 4bits data size access */
-	idx = segment & 0x3;
-	segment = segment >> 2;
+		return cur_pixel | cur_pixel >> 4;
+	}
 
-	uint8 *pixel;
-	pixel = &gw_segments[segment];
+	/* Deviation 8bits segment resolution */
+	return gw_segments[segment + i];
+}
 
-	/* get segment coordinates */
-	uint16 segments_x = gw_segments_x[segment_nb];
-	uint16 segments_y = gw_segments_y[segment_nb];
-	uint16 segments_width = gw_segments_width[segment_nb];
-	uint16 segments_height = gw_segments_height[segment_nb];
+/* Returns false when there is no memory for it, segments are then unpacked on the fly */
+static bool build_segments_cache()
+{
+	size_t total = 0;
+
+	free(seg_cache);
+	seg_cache = 0;
+	memset(seg_shared, 0, sizeof(seg_shared));
+
+	seg_count = gw_head.segments_x_size / sizeof(*gw_segments_x);
+	if (seg_count > GW_SEGMENTS_MAX)
+		seg_count = GW_SEGMENTS_MAX;
+
+	for (int nb = 0; nb < seg_count; nb++)
+		total += gw_segments_width[nb] * gw_segments_height[nb];
+
+	seg_cache = malloc(total * 3);
+	uint8 *coverage = calloc(GW_SCREEN_WIDTH * GW_SCREEN_HEIGHT, 1);
 
-	for (int line = segments_y; line < segments_height + segments_y; line++)
+	if (!seg_cache || !coverage)
 	{
-		for (int x = segments_x; x < segments_width + segments_x; x++)
-		{
+		free(seg_cache);
+		free(coverage);
+		seg_cache = 0;
+		return false;
+	}
 
-			cur_pixelr = (pixel[idx >> 2] >> 2*(idx & 0x3)) &0x3;
+	uint16 *color = (uint16 *)seg_cache;
+	uint8 *intensity = seg_cache + total * 2;
 
-			idx++;
+	for (int nb = 0; nb < seg_count; nb++)
+	{
+		uint16 segments_x = gw_segments_x[nb];
+		uint16 segments_y = gw_segments_y[nb];
+		uint16 segments_width = gw_segments_width[nb];
+		uint16 segments_height = gw_segments_height[nb];
+		int i = 0;
 
-			cur_pixel = cur_pixelr | cur_pixelr << 2 | cur_pixelr << 4 | cur_pixelr << 6;
+		seg_color[nb] = color;
+		seg_intensity[nb] = intensity;
 
+		for (int line = segments_y; line < segments_height + segments_y; line++)
+		{
+			for (int x = segments_x; x < segments_width + segments_x; x++, i++)
+			{
+				uint8 cur_pixel = unpack_segment_pixel(gw_segments_offset[nb], i);
 
-			/* Check if there something to mix
-			if the segment pixel is transparent nothing to do. */
-			if (cur_pixel != SEG_TRANSPARENT_COLOR) {
-			
-			// change black color to get transparency effect
-			if ( cur_pixel == 0 ) cur_pixel = 39;
-			gw_graphic_framebuffer[line * GW_SCREEN_WIDTH + x] = rgb_multiply_8bits(source_mixer[line * GW_SCREEN_WIDTH + x], cur_pixel);
+				intensity[i] = cur_pixel;
+				color[i] = rgb_multiply_8bits(gw_background[line * GW_SCREEN_WIDTH + x], cur_pixel);
+
+				if (cur_pixel != SEG_TRANSPARENT_COLOR && coverage[line * GW_SCREEN_WIDTH + x] < 0xff)
+					coverage[line * GW_SCREEN_WIDTH + x]++;
 			}
+		}
+
+		color += i;
+		intensity += i;
+	}
+
+	/* Flag segments sharing pixels with another one */
+	for (int nb = 0; nb < seg_count; nb++)
+	{
+		uint16 segments_x = gw_segments_x[nb];
+		uint16 segments_y = gw_segments_y[nb];
+		uint16 segments_width = gw_segments_width[nb];
+		uint16 segments_height = gw_segments_height[nb];
+		int i = 0;
 
+		for (int line = segments_y; line < segments_height + segments_y; line++)
+		{
+			for (int x = segments_x; x < segments_width + segments_x; x++, i++)
+			{
+				if (seg_intensity[nb][i] != SEG_TRANSPARENT_COLOR && coverage[line * GW_SCREEN_WIDTH + x] > 1)
+					seg_shared[nb >> 3] |= 1 << (nb & 7);
+			}
 		}
 	}
+
+	free(coverage);
+	return true;
 }
-/* Deviation 4bits segment resolution function */
-__attribute__((optimize("unroll-loops"))) static inline void update_segment_4bits(uint8 segment_nb, bool segment_state)
-{
 
-	/* segment first pixel corner (up/left) */
-	uint32 segment = gw_segments_offset[segment_nb];
+/* Record a segment state, segments are drawn later in the same order */
+static inline void update_segment(uint8 segment_nb, bool segment_state)
+{
+	seg_order[seg_order_count++] = segment_nb;
 
-	uint8 cur_pixel;
-	int idx = 0;
+	if (segment_state)
+		seg_state[segment_nb >> 3] |= 1 << (segment_nb & 7);
+}
 
-	/* nothing to do for this segment */
-	if (segment_state == 0)
+/* Draw the part of a segment inside the x0,y0 - x1,y1 area (exclusive) */
+static void draw_segment(uint8 segment_nb, int x0, int y0, int x1, int y1)
+{
+	if (segment_nb >= seg_count)
 		return;
 
-	/* 4bits data size access */
-	idx = segment & 0x1;
-	segment = segment >> 1;
-
-	uint8 *pixel;
-	pixel = &gw_segments[segment];
+	const uint16 *color = seg_color[segment_nb];
+	const uint8 *intensity = seg_intensity[segment_nb];
+	bool premultiplied = !SEG_BIT(seg_shared, segment_nb) || source_mixer == gw_background;
+	bool cached = seg_cache != 0;
 
 	/* get segment coordinates */
-	uint16 segments_x = gw_segments_x[segment_nb];
-	uint16 segments_y = gw_segments_y[segment_nb];
-	uint16 segments_width = gw_segments_width[segment_nb];
-	uint16 segments_height = gw_segments_height[segment_nb];
-
-	for (int line = segments_y; line < segments_height + segments_y; line++)
+	int segments_x = gw_segments_x[segment_nb];
+	int segments_y = gw_segments_y[segment_nb];
+	int segments_width = gw_segments_width[segment_nb];
+	int segments_height = gw_segments_height[segment_nb];
+
+	/* clip to the area */
+	int left = segments_x > x0 ? segments_x : x0;
+	int right = segments_x + segments_width < x1 ? segments_x + segments_width : x1;
+	int top = segments_y > y0 ? segments_y : y0;
+	int bottom = segments_y + segments_height < y1 ? segments_y + segments_height : y1;
+
+	for (int line = top; line < bottom; line++)
 	{
-		for (int x = segments_x; x < segments_width + segments_x; x++)
-		{
+		int i = (line - segments_y) * segments_width + (left - segments_x);
+		uint16 *dst = &gw_graphic_framebuffer[line * GW_SCREEN_WIDTH];
 
-			if ((idx & 0x1) == 0)
-				cur_pixel = pixel[idx >> 1] & 0xF0;
-			else
-				cur_pixel = pixel[idx >> 1] << 4;
+		for (int x = left; x < right; x++, i++)
+		{
+			uint8 cur_pixel = cached ? intensity[i] : unpack_segment_pixel(gw_segments_offset[segment_nb], i);
 
-			cur_pixel |= cur_pixel >> 4;
-			idx++;
+			/* if the segment pixel is transparent nothing to do. */
+			if (cur_pixel == SEG_TRANSPARENT_COLOR)
+				continue;
 
-			/* Check if there something to mix
-			if the segment pixel is transparent nothing to do. */
-			if (cur_pixel != SEG_TRANSPARENT_COLOR)
-				gw_graphic_framebuffer[line * GW_SCREEN_WIDTH + x] = rgb_multiply_8bits(source_mixer[line * GW_SCREEN_WIDTH + x], cur_pixel);
+			if (cached && premultiplied)
+				dst[x] = color[i];
+			else
+				dst[x] = rgb_multiply_8bits(source_mixer[line * GW_SCREEN_WIDTH + x], cur_pixel);
 		}
 	}
 }
 
-/* Deviation 8bits segment resolution function */
-__attribute__((optimize("unroll-loops"))) static inline void update_segment_8bits(uint8 segment_nb, bool segment_state)
+/* Restore the background then draw all lit segments over the area */
+static void redraw_area(const gw_rect_t *rect)
 {
+	int x1 = rect->x + rect->width;
+	int y1 = rect->y + rect->height;
 
-	/* segment first pixel corner (up/left) */
-	uint32 segment = gw_segments_offset[segment_nb];
+	for (int line = rect->y; line < y1; line++)
+	{
+		uint16 *dst = &gw_graphic_framebuffer[line * GW_SCREEN_WIDTH + rect->x];
 
-	uint8 cur_pixel;
-	int idx = 0;
+		if (gw_head.flags & FLAG_RENDERING_LCD_INVERTED)
+			memset(dst, 0, rect->width * 2);
+		else
+			memcpy(dst, &gw_background[line * GW_SCREEN_WIDTH + rect->x], rect->width * 2);
+	}
 
-	/* nothing to do for this segment */
-	if (segment_state == 0)
-		return;
+	for (int n = 0; n < seg_order_count; n++)
+	{
+		uint8 nb = seg_order[n];
+		if (SEG_BIT(seg_state, nb))
+			draw_segment(nb, rect->x, rect->y, x1, y1);
+	}
+}
 
-	uint8 *pixel;
-	pixel = &gw_segments[segment];
+/* Add an area to the dirty list, merging it with the ones it touches */
+static void add_dirty_rect(int x, int y, int width, int height)
+{
+	gw_rect_t rect = {x, y, width, height};
 
-	/* get segment coordinates */
-	uint16 segments_x = gw_segments_x[segment_nb];
-	uint16 segments_y = gw_segments_y[segment_nb];
-	uint16 segments_width = gw_segments_width[segment_nb];
-	uint16 segments_height = gw_segments_height[segment_nb];
+	for (int n = 0; n < dirty_rects_count;)
+	{
+		gw_rect_t *r = &dirty_rects[n];
+
+		if (rect.x <= r->x + r->width && r->x <= rect.x + rect.width &&
+		    rect.y <= r->y + r->height && r->y <= rect.y + rect.height)
+		{
+			int x1 = rect.x + rect.width > r->x + r->width ? rect.x + rect.width : r->x + r->width;
+			int y1 = rect.y + rect.height > r->y + r->height ? rect.y + rect.height : r->y + r->height;
+			rect.x = rect.x < r->x ? rect.x : r->x;
+			rect.y = rect.y < r->y ? rect.y : r->y;
+			rect.width = x1 - rect.x;
+			rect.height = y1 - rect.y;
+
+			/* the merged area may now touch a previous one */
+			*r = dirty_rects[--dirty_rects_count];
+			n = 0;
+		}
+		else
+			n++;
+	}
 
-	for (int line = segments_y; line < segments_height + segments_y; line++)
+	/* Too many areas, redraw their bounding box */
+	if (dirty_rects_count == GW_DIRTY_RECTS_MAX)
 	{
-		for (int x = segments_x; x < segments_width + segments_x; x++)
+		for (int n = 0; n < dirty_rects_count; n++)
 		{
+			gw_rect_t *r = &dirty_rects[n];
+			int x1 = rect.x + rect.width > r->x + r->width ? rect.x + rect.width : r->x + r->width;
+			int y1 = rect.y + rect.height > r->y + r->height ? rect.y + rect.height : r->y + r->height;
+			rect.x = rect.x < r->x ? rect.x : r->x;
+			rect.y = rect.y < r->y ? rect.y : r->y;
+			rect.width = x1 - rect.x;
+			rect.height = y1 - rect.y;
+		}
+		dirty_rects_count = 0;
+	}
+
+	dirty_rects[dirty_rects_count++] = rect;
+}
+
+/* Start a new frame: segments states are collected with update_segment() */
+static void begin_segments(uint16 *framebuffer)
+{
+	gw_graphic_framebuffer = framebuffer;
+
+	if (gw_head.flags & FLAG_RENDERING_LCD_INVERTED)
+		source_mixer = gw_background;
+	else
+		source_mixer = framebuffer;
 
-			cur_pixel = pixel[idx];
-			idx++;
+	memcpy(seg_state_prev, seg_state, sizeof(seg_state));
+	memset(seg_state, 0, sizeof(seg_state));
+	seg_order_count = 0;
+	dirty_rects_count = 0;
+}
 
-			/* Check if there something to mix
-				if the segment pixel is black, it's considered transparent.
-				it prevents from mixing 2 overlapping segments
-				'gw_background' is the colour sheet. segment colour is white. */
-			if (cur_pixel != SEG_TRANSPARENT_COLOR)
-				gw_graphic_framebuffer[line * GW_SCREEN_WIDTH + x] = rgb_multiply_8bits(source_mixer[line * GW_SCREEN_WIDTH + x], cur_pixel);
+/* Draw only what changed since the previous frame */
+static void end_segments()
+{
+	/* Without the cache the shared segments aren't known, always redraw everything */
+	if (gw_graphic_framebuffer != last_framebuffer || !seg_cache)
+	{
+		add_dirty_rect(0, 0, GW_SCREEN_WIDTH, GW_SCREEN_HEIGHT);
+		last_framebuffer = gw_graphic_framebuffer;
+	}
+	else
+	{
+		for (int nb = 0; nb < seg_count; nb++)
+		{
+			if (SEG_BIT(seg_state, nb) != SEG_BIT(seg_state_prev, nb))
+				add_dirty_rect(gw_segments_x[nb], gw_segments_y[nb], gw_segments_width[nb], gw_segments_height[nb]);
 		}
 	}
+
+	for (int n = 0; n < dirty_rects_count; n++)
+		redraw_area(&dirty_rects[n]);
+}
+
+int gw_gfx_dirty_rects(const gw_rect_t **rects)
+{
+	*rects = dirty_rects;
+	return dirty_rects_count;
 }
 
 /* Specific functions to pool segments status */
@@ -246,21 +415,7 @@ __attribute__((optimize("unroll-loops"))) inline void gw_gfx_sm510_rendering(uin
 	uint8 segment_position;
 	uint8 segment_state;
 
-	gw_graphic_framebuffer = framebuffer;
-
-	if (gw_head.flags & FLAG_RENDERING_LCD_INVERTED)
-	{
-
-		memset(framebuffer, 0, GW_SCREEN_WIDTH * GW_SCREEN_HEIGHT * 2);
-		SEG_TRANSPARENT_COLOR = SEG_BLACK_COLOR;
-		source_mixer = gw_background;
-	}
-	else
-	{
-		memcpy(framebuffer, gw_background, GW_SCREEN_WIDTH * GW_SCREEN_HEIGHT * 2);
-		SEG_TRANSPARENT_COLOR = SEG_WHITE_COLOR;
-		source_mixer = framebuffer;
-	}
+	begin_segments(framebuffer);
 
 	//scan group a1..a16,b1..b16,c11..c16
 	for (int seg_y = 0; seg_y < NB_SEGS_ROW; seg_y++)
@@ -320,6 +475,8 @@ __attribute__((optimize("unroll-loops"))) inline void gw_gfx_sm510_rendering(uin
 
 		update_segment(132 + seg_z, ((segment_state & (1 << seg_z)) != 0));
 	}
+
+	end_segments();
 }
 
 /* SM500 I/O based LCD controller */
@@ -338,21 +495,7 @@ __attribute__((optimize("unroll-loops"))) inline void gw_gfx_sm500_rendering(uin
 */
 	uint8 seg;
 
-	gw_graphic_framebuffer = framebuffer;
-
-	if (gw_head.flags & FLAG_RENDERING_LCD_INVERTED)
-	{
-
-		memset(framebuffer, 0, GW_SCREEN_WIDTH * GW_SCREEN_HEIGHT * 2);
-		SEG_TRANSPARENT_COLOR = SEG_BLACK_COLOR;
-		source_mixer = gw_background;
-	}
-	else
-	{
-		memcpy(framebuffer, gw_background, GW_SCREEN_WIDTH * GW_SCREEN_HEIGHT * 2);
-		SEG_TRANSPARENT_COLOR = SEG_WHITE_COLOR;
-		source_mixer = framebuffer;
-	}
+	begin_segments(framebuffer);
 
 	// 2 columns z
 	for (int h = 0; h < 2; h++)
@@ -374,6 +517,8 @@ __attribute__((optimize("unroll-loops"))) inline void gw_gfx_sm500_rendering(uin
 			update_segment(8 * o + 6 + h, m_bp ? ((seg & 0x8) != 0) : 0); // 6,7
 		}
 	}
+
+	end_segments();
 }
 void gw_gfx_init()
 {
@@ -385,12 +530,15 @@ void gw_gfx_init()
 	// for segments rendering side
 	deflicker_enabled = (flag_lcd_deflicker_level != 0);
 
-	/* determine which API to use for segments rendering */
-	update_segment = update_segment_8bits;
+	/* pixels to leave untouched when mixing segments */
+	if (gw_head.flags & FLAG_RENDERING_LCD_INVERTED)
+		SEG_TRANSPARENT_COLOR = SEG_BLACK_COLOR;
+	else
+		SEG_TRANSPARENT_COLOR = SEG_WHITE_COLOR;
 
-	if (gw_head.flags & FLAG_SEGMENTS_4BITS)
-		update_segment = update_segment_4bits;
-	if (gw_head.flags & FLAG_SEGMENTS_2BITS)
-		update_segment = update_segment_2bits;
+	/* unpack and pre-multiply segments, then force a full redraw */
+	build_segments_cache();
+	memset(seg_state, 0, sizeof(seg_state));
+	last_framebuffer = 0;
 
 }
@@ -22,6 +22,8 @@ __license__ = "GPLv3"
 #ifndef _GW_GRAPHIC_H_
 #define _GW_GRAPHIC_H_
 
+#include "gw_system.h"
+
 /****************************/
 // H1..4
 #define NB_SEGS_COL   4
@@ -41,5 +43,6 @@ __license__ = "GPLv3"
 void gw_gfx_init();
 void gw_gfx_sm500_rendering(uint16 *framebuffer);
 void gw_gfx_sm510_rendering(uint16 *framebuffer);
+int gw_gfx_dirty_rects(const gw_rect_t **rects);
 
 #endif /* _GW_GRAPHIC_H_ */
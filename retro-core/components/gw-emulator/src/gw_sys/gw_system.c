@@ -181,6 +181,7 @@ bool gw_system_config()
 void gw_system_reset() { device_reset(); }
 void gw_system_start() { device_start(); }
 void gw_system_blit(unsigned short *active_framebuffer) { device_blit(active_framebuffer); }
+int gw_system_dirty_rects(const gw_rect_t **rects) { return gw_gfx_dirty_rects(rects); }
 bool gw_system_romload() { return gw_romloader(); }
 
 /******** Audio functions *******************/
@@ -49,6 +49,19 @@ void gw_system_reset();
 int gw_system_run(int clock_cycles);
 void gw_system_blit(unsigned short *active_framebuffer);
 
+// Screen areas changed by the last blit (only segments that changed are redrawn)
+#define GW_DIRTY_RECTS_MAX 16
+
+typedef struct gw_rect_s
+{
+    unsigned short x;
+    unsigned short y;
+    unsigned short width;
+    unsigned short height;
+} gw_rect_t;
+
+int gw_system_dirty_rects(const gw_rect_t **rects);
+
 // Audio init
 void gw_system_sound_init();
 
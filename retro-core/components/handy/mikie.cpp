@@ -866,23 +866,8 @@ void CMikie::BuildPalette()
 
 inline void CMikie::ResetDisplayPtr()
 {
-   if (mDisplayRotate != mDisplayRotate_Pending)
-   {
-      mDisplayRotate = mDisplayRotate_Pending;
-   }
-
-   switch(mDisplayRotate)
-   {
-      case MIKIE_ROTATE_L:
-         mpDisplayCurrent=gPrimaryFrameBuffer+(mDisplayPitch*(HANDY_SCREEN_WIDTH-1));
-         break;
-      case MIKIE_ROTATE_R:
-         mpDisplayCurrent=gPrimaryFrameBuffer+mDisplayPitch-(((HANDY_SCREEN_WIDTH-HANDY_SCREEN_HEIGHT))*2)-2;
-         break;
-      default:
-         mpDisplayCurrent=gPrimaryFrameBuffer;
-         break;
-   }
+   // Lines are always rendered in native orientation, rotation is done by rg_display
+   mpDisplayCurrent=gPrimaryFrameBuffer;
 }
 
 inline ULONG CMikie::DisplayRenderLine(void)
@@ -945,76 +930,23 @@ inline ULONG CMikie::DisplayRenderLine(void)
       // Assign the temporary pointer;
       bitmap_tmp=(UWORD*)mpDisplayCurrent;
 
-		switch(mDisplayRotate)
-		{
-         case MIKIE_ROTATE_L:
-            for(loop=0;loop<HANDY_SCREEN_WIDTH/2;loop++)
-            {
-               source=mpRamPointer[mLynxAddr];
-               if(mDISPCTL_Flip)
-               {
-                  mLynxAddr--;
-                  *(bitmap_tmp)=mColourMap[mPalette[source&0x0f].Index];
-                  bitmap_tmp-=HANDY_SCREEN_WIDTH;
-                  *(bitmap_tmp)=mColourMap[mPalette[source>>4].Index];
-                  bitmap_tmp-=HANDY_SCREEN_WIDTH;
-               }
-               else
-               {
-                  mLynxAddr++;
-                  if (bitmap_tmp >= (UWORD*)(gPrimaryFrameBuffer))
-                  *(bitmap_tmp)=mColourMap[mPalette[source>>4].Index];
-                  bitmap_tmp-=HANDY_SCREEN_WIDTH;
-                  if (bitmap_tmp >= (UWORD*)(gPrimaryFrameBuffer))
-                  *(bitmap_tmp)=mColourMap[mPalette[source&0x0f].Index];
-                  bitmap_tmp-=HANDY_SCREEN_WIDTH;
-               }
-            }
-            mpDisplayCurrent+=sizeof(UWORD);
-				break;
-			case MIKIE_ROTATE_R:
-            for(loop=0;loop<HANDY_SCREEN_WIDTH/2;loop++)
-            {
-               source=mpRamPointer[mLynxAddr];
-               if(mDISPCTL_Flip)
-               {
-                  mLynxAddr--;
-                  *(bitmap_tmp)=mColourMap[mPalette[source&0x0f].Index];
-                  bitmap_tmp+=HANDY_SCREEN_WIDTH;
-                  *(bitmap_tmp)=mColourMap[mPalette[source>>4].Index];
-                  bitmap_tmp+=HANDY_SCREEN_WIDTH;
-               }
-               else
-               {
-                  mLynxAddr++;
-                  *(bitmap_tmp)=mColourMap[mPalette[source>>4].Index];
-                  bitmap_tmp+=HANDY_SCREEN_WIDTH;
-                  *(bitmap_tmp)=mColourMap[mPalette[source&0x0f].Index];
-                  bitmap_tmp+=HANDY_SCREEN_WIDTH;
-               }
-            }
-            mpDisplayCurrent-=sizeof(UWORD);
-				break;
-			default:
-            for(loop=0;loop<HANDY_SCREEN_WIDTH/2;loop++)
-            {
-               source=mpRamPointer[mLynxAddr];
-               if(mDISPCTL_Flip)
-               {
-                  mLynxAddr--;
-                  *(bitmap_tmp++)=mColourMap[mPalette[source&0x0f].Index];
-                  *(bitmap_tmp++)=mColourMap[mPalette[source>>4].Index];
-               }
-               else
-               {
-                  mLynxAddr++;
-                  *(bitmap_tmp++)=mColourMap[mPalette[source>>4].Index];
-                  *(bitmap_tmp++)=mColourMap[mPalette[source&0x0f].Index];
-               }
-            }
-            mpDisplayCurrent+=mDisplayPitch;
-            break;
-		}
+      for(loop=0;loop<HANDY_SCREEN_WIDTH/2;loop++)
+      {
+         source=mpRamPointer[mLynxAddr];
+         if(mDISPCTL_Flip)
+         {
+            mLynxAddr--;
+            *(bitmap_tmp++)=mColourMap[mPalette[source&0x0f].Index];
+            *(bitmap_tmp++)=mColourMap[mPalette[source>>4].Index];
+         }
+         else
+         {
+            mLynxAddr++;
+            *(bitmap_tmp++)=mColourMap[mPalette[source>>4].Index];
+            *(bitmap_tmp++)=mColourMap[mPalette[source&0x0f].Index];
+         }
+      }
+      mpDisplayCurrent+=mDisplayPitch;
    }
    return work_done;
 }
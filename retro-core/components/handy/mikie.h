@@ -127,17 +127,6 @@ typedef struct
 }TPALETTE;
 
 
-//
-// Enumerated types for possible mikie windows independant modes
-//
-enum
-{
-   MIKIE_BAD_MODE=0,
-   MIKIE_NO_ROTATE,
-   MIKIE_ROTATE_L,
-   MIKIE_ROTATE_R
-};
-
 enum
 {
    MIKIE_PIXEL_FORMAT_16BPP_565=0,
@@ -167,7 +156,6 @@ class CMikie : public CLynxBase
       void	BuildPalette(void);
 
       void Update(void);
-      void SetRotation(UBYTE data) {mDisplayRotate_Pending = data;};
       inline bool SwitchAudInDir(void){ return(mIODIR&0x10);};
       inline bool SwitchAudInValue(void){ return (mIODAT&0x10);};
 
@@ -187,8 +175,6 @@ class CMikie : public CLynxBase
       ULONG		mAudioInputComparator;
       ULONG		mTimerStatusFlags;
       ULONG		mTimerInterruptMask;
-      UBYTE    mDisplayRotate;
-      UBYTE    mDisplayRotate_Pending;
 
       TPALETTE	mPalette[16];
       UWORD		mColourMap[4096];
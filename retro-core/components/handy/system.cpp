@@ -128,24 +128,22 @@ CSystem::CSystem(const char* filename, long displayformat, long samplerate)
 {
    UBYTE *filedata = NULL;
    ULONG filesize = 0;
-   FILE *fp;
+   rg_reader_t *fp;
 
    log_printf("Loading '%s'...\n", filename);
 
-   if ((fp = fopen(filename, "rb"))) {
-      fseek(fp, 0, SEEK_END);
-      filesize = ftell(fp);
+   if ((fp = rg_storage_reader_open(filename))) {
+      filesize = rg_storage_reader_size(fp);
       filedata = (UBYTE*)malloc(filesize);
-      fseek(fp, 0, SEEK_SET);
       if (!filedata) {
          log_printf("-> memory allocation failed (%d bytes)!\n", filesize);
-      } else if (fread(filedata, filesize, 1, fp) != 1) {
-         log_printf("-> fread failed (%d bytes)!\n", filesize);
+      } else if (rg_storage_reader_read(fp, 0, filedata, filesize) != filesize) {
+         log_printf("-> read failed (%d bytes)!\n", filesize);
       } else {
          // log_printf("-> read ok. size=%d, crc32=%08X\n", filesize, crc32_le(0, filedata, filesize));
          log_printf("-> read ok. size=%d\n", filesize);
       }
-      fclose(fp);
+      rg_storage_reader_close(fp);
    } else {
       log_printf("-> fopen failed!\n");
    }
@@ -23,7 +23,8 @@
 
 #include "nes.h"
 
-#define APU_VOLUME_DECAY(x)  ((x) -= ((x) >> 7))
+/* Deltas are timestamped in fractions of an output sample, see apu_process */
+#define APU_SAMPLE_TIME 1024
 
 /* Runtime settings */
 #define OPT(n) (apu.options[(n)])
@@ -31,6 +32,9 @@
 /* active APU */
 static apu_t apu;
 
+/* start of the sample being processed, in APU_SAMPLE_TIME units */
+static unsigned sample_time;
+
 /* vblank length table used for rectangles, triangle, noise */
 static const uint8 vbl_length[32] =
 {
@@ -111,6 +115,19 @@ void apu_getcontext(apu_t *dest_apu)
    *dest_apu = apu;
 }
 
+/* Sends a change of a channel's output to the synthesis buffer, `cycles` into the current sample */
+static inline void apu_output(int *output_vol, int value, float cycles)
+{
+   if (value == *output_vol)
+      return;
+
+   if (cycles < 0)
+      cycles = 0;
+
+   rg_blip_add_delta(apu.blip, sample_time + (unsigned)(cycles * apu.cycle_time), value - *output_vol);
+   *output_vol = value;
+}
+
 static void apu_build_luts(int num_samples)
 {
    /* lut used for enveloping and frequency sweeps */
@@ -134,14 +151,15 @@ static void apu_build_luts(int num_samples)
 ** reg3: 0-2=high freq, 7-4=vbl length counter
 */
 #define  APU_MAKE_RECTANGLE(ch) \
-static inline int apu_rectangle_##ch(void) \
+static inline void apu_rectangle_##ch(void) \
 { \
-   int output, total, num_times; \
-\
-   APU_VOLUME_DECAY(apu.rectangle[ch].output_vol); \
+   int output; \
 \
    if (!apu.rectangle[ch].enabled || apu.rectangle[ch].vbl_length == 0) \
-      return apu.rectangle[ch].output_vol; \
+   { \
+      apu_output(&apu.rectangle[ch].output_vol, 0, 0); \
+      return; \
+   } \
 \
    /* vbl length counter */ \
    if (!apu.rectangle[ch].holdnote) \
@@ -163,7 +181,10 @@ static inline int apu_rectangle_##ch(void) \
    if (apu.rectangle[ch].freq < 8 \
        || (false == apu.rectangle[ch].sweep_inc \
            && apu.rectangle[ch].freq > apu.rectangle[ch].freq_limit)) \
-      return apu.rectangle[ch].output_vol; \
+   { \
+      apu_output(&apu.rectangle[ch].output_vol, 0, 0); \
+      return; \
+   } \
 \
    /* frequency sweeping at a rate of (sweep_delay + 1) / 120 secs */ \
    if (apu.rectangle[ch].sweep_on && apu.rectangle[ch].sweep_shifts) \
@@ -186,33 +207,28 @@ static inline int apu_rectangle_##ch(void) \
          } \
       } \
    } \
-\
-   apu.rectangle[ch].accum -= apu.cycle_rate; \
-   if (apu.rectangle[ch].accum >= 0) \
-      return apu.rectangle[ch].output_vol; \
 \
    if (apu.rectangle[ch].fixed_envelope) \
       output = apu.rectangle[ch].volume << 8; /* fixed volume */ \
    else \
       output = (apu.rectangle[ch].env_vol ^ 0x0F) << 8; \
 \
-   num_times = total = 0; \
+   /* volume changes apply from the start of the sample, duty steps at their exact time */ \
+   apu_output(&apu.rectangle[ch].output_vol, \
+      (apu.rectangle[ch].adder < apu.rectangle[ch].duty_flip) ? output : -output, 0); \
+\
+   apu.rectangle[ch].accum -= apu.cycle_rate; \
 \
    while (apu.rectangle[ch].accum < 0) \
    { \
+      float cycles = apu.cycle_rate + apu.rectangle[ch].accum; \
+\
       apu.rectangle[ch].accum += apu.rectangle[ch].freq + 1; \
       apu.rectangle[ch].adder = (apu.rectangle[ch].adder + 1) & 0x0F; \
 \
-      if (apu.rectangle[ch].adder < apu.rectangle[ch].duty_flip) \
-         total += output; \
-      else \
-         total -= output; \
-\
-      num_times++; \
+      apu_output(&apu.rectangle[ch].output_vol, \
+         (apu.rectangle[ch].adder < apu.rectangle[ch].duty_flip) ? output : -output, cycles); \
    } \
-\
-   apu.rectangle[ch].output_vol = total / num_times; \
-   return apu.rectangle[ch].output_vol; \
 }
 
 /* generate the functions */
@@ -226,12 +242,18 @@ APU_MAKE_RECTANGLE(1)
 ** reg2: low 8 bits of frequency
 ** reg3: 7-3=length counter, 2-0=high 3 bits of frequency
 */
-static inline int apu_triangle(void)
+static inline int apu_triangle_level(void)
 {
-   APU_VOLUME_DECAY(apu.triangle.output_vol);
+   /* 16 steps up then down, (2 << 8) each plus a quarter */
+   int step = (apu.triangle.adder & 0x10) ? (0x1F - apu.triangle.adder) : apu.triangle.adder;
+   return (step * 2 - 15) * 320;
+}
 
+static inline void apu_triangle(void)
+{
+   /* a silenced triangle holds its level, like the real one */
    if (!apu.triangle.enabled || apu.triangle.vbl_length == 0)
-      goto output;
+      return;
 
    if (apu.triangle.counter_started)
    {
@@ -247,22 +269,18 @@ static inline int apu_triangle(void)
    }
 
    if (apu.triangle.linear_length == 0 || apu.triangle.freq < 4) /* inaudible */
-      goto output;
+      return;
 
-   apu.triangle.accum -= apu.cycle_rate; \
+   apu.triangle.accum -= apu.cycle_rate;
    while (apu.triangle.accum < 0)
    {
+      float cycles = apu.cycle_rate + apu.triangle.accum;
+
       apu.triangle.accum += apu.triangle.freq;
       apu.triangle.adder = (apu.triangle.adder + 1) & 0x1F;
 
-      if (apu.triangle.adder & 0x10)
-         apu.triangle.output_vol -= (2 << 8);
-      else
-         apu.triangle.output_vol += (2 << 8);
+      apu_output(&apu.triangle.output_vol, apu_triangle_level(), cycles);
    }
-
-output:
-   return (apu.triangle.output_vol + (apu.triangle.output_vol >> 2));
 }
 
 
@@ -272,16 +290,15 @@ output:
 ** reg2: 7=small(93 byte) sample,3-0=freq lookup
 ** reg3: 7-4=vbl length counter
 */
-static inline int apu_noise(void)
+static inline void apu_noise(void)
 {
-   int outvol = 0;
-   int num_times = 0;
-   int total = 0;
-
-   APU_VOLUME_DECAY(apu.noise.output_vol);
+   int outvol;
 
    if (!apu.noise.enabled || apu.noise.vbl_length == 0)
-      goto output;
+   {
+      apu_output(&apu.noise.output_vol, 0, 0);
+      return;
+   }
 
    /* vbl length counter */
    if (!apu.noise.holdnote)
@@ -299,40 +316,33 @@ static inline int apu_noise(void)
          apu.noise.env_vol++;
    }
 
-   apu.noise.accum -= apu.cycle_rate;
-
-   if (apu.noise.accum >= 0)
-      goto output;
-
    if (apu.noise.fixed_envelope)
       outvol = apu.noise.volume << 8; /* fixed volume */
    else
       outvol = (apu.noise.env_vol ^ 0x0F) << 8;
 
+   outvol = (outvol * 3) >> 2;
+
+   apu_output(&apu.noise.output_vol, (apu.noise.shift_reg & 1) ? -outvol : outvol, 0);
+
+   apu.noise.accum -= apu.cycle_rate;
+
    /* emulation of the 15-bit shift register the
    ** NES uses to generate pseudo-random series
    ** for the white noise channel
    */
    while (apu.noise.accum < 0)
    {
+      float cycles = apu.cycle_rate + apu.noise.accum;
       int sreg = apu.noise.shift_reg;
       int tap = (sreg & apu.noise.xor_tap) ? 1 : 0;
-      int bit0 = sreg & 1;
-      int bit14 = (bit0 ^ tap);
-
-      total += (bit0 ^ 1) ? outvol : -outvol;
-      num_times++;
+      int bit14 = ((sreg & 1) ^ tap);
 
       apu.noise.shift_reg = (bit14 << 14) | (sreg >> 1);
       apu.noise.accum += apu.noise.freq;
-   }
 
-   outvol = total / num_times;
-
-   apu.noise.output_vol = outvol;
-
-output:
-   return ((apu.noise.output_vol + apu.noise.output_vol + apu.noise.output_vol) >> 2);
+      apu_output(&apu.noise.output_vol, (apu.noise.shift_reg & 1) ? -outvol : outvol, cycles);
+   }
 }
 
 
@@ -350,9 +360,12 @@ static inline void apu_dmcreload(void)
 ** reg2: 8 bits of 64-byte aligned address offset : $C000 + (value * 64)
 ** reg3: length, (value * 16) + 1
 */
-static inline int apu_dmc(void)
+#define APU_DMC_LEVEL(dac) (((dac) - 0x40) * 192)
+
+static inline void apu_dmc(void)
 {
-   APU_VOLUME_DECAY(apu.dmc.output_vol);
+   /* direct DAC writes apply from the start of the sample */
+   apu_output(&apu.dmc.output_vol, APU_DMC_LEVEL(apu.dmc.regs[1]), 0);
 
    /* only process when channel is alive */
    if (apu.dmc.dma_length)
@@ -361,6 +374,8 @@ static inline int apu_dmc(void)
 
       while (apu.dmc.accum < 0)
       {
+         float cycles = apu.cycle_rate + apu.dmc.accum;
+
          apu.dmc.accum += apu.dmc.freq;
 
          int delta_bit = (apu.dmc.dma_length & 7) ^ 7;
@@ -405,24 +420,18 @@ static inline int apu_dmc(void)
          if (apu.dmc.cur_byte & (1 << delta_bit))
          {
             if (apu.dmc.regs[1] < 0x7D)
-            {
                apu.dmc.regs[1] += 2;
-               apu.dmc.output_vol += (2 << 8);
-            }
          }
          /* negative delta */
          else
          {
             if (apu.dmc.regs[1] > 1)
-            {
                apu.dmc.regs[1] -= 2;
-               apu.dmc.output_vol -= (2 << 8);
-            }
          }
+
+         apu_output(&apu.dmc.output_vol, APU_DMC_LEVEL(apu.dmc.regs[1]), cycles);
       }
    }
-
-   return ((apu.dmc.output_vol + apu.dmc.output_vol + apu.dmc.output_vol) >> 2);
 }
 
 
@@ -548,11 +557,8 @@ IRAM_ATTR void apu_write(uint32 address, uint8 value)
       break;
 
    case APU_WRE1: /* 7-bit DAC */
-      /* add the _delta_ between written value and
-      ** current output level of the volume reg
-      */
+      /* the new level reaches the output in apu_dmc */
       value &= 0x7F; /* bit 7 ignored */
-      apu.dmc.output_vol += ((value - apu.dmc.regs[1]) << 8);
       apu.dmc.regs[1] = value;
       break;
 
@@ -677,59 +683,45 @@ IRAM_ATTR uint8 apu_read(uint32 address)
    return value;
 }
 
+/* The channels send their level changes to a band-limited synthesis buffer, timestamped
+** within the sample, which takes care of filtering and DC removal. Envelopes, sweeps and
+** length counters are still clocked once per output sample.
+*/
 void apu_process(short *buffer, size_t num_samples, bool stereo)
 {
-   int prev_sample = apu.prev_sample;
-
-   if (!buffer)
+   if (!buffer || !apu.blip)
       return;
 
-   while (num_samples--)
+   for (size_t i = 0; i < num_samples; i++)
    {
-      int accum = 0;
+      sample_time = i * APU_SAMPLE_TIME;
 
       // if (OPT(APU_CHANNEL1_EN))
-         accum += apu_rectangle_0();
+         apu_rectangle_0();
       // if (OPT(APU_CHANNEL2_EN))
-         accum += apu_rectangle_1();
+         apu_rectangle_1();
       // if (OPT(APU_CHANNEL3_EN))
-         accum += apu_triangle();
+         apu_triangle();
       // if (OPT(APU_CHANNEL4_EN))
-         accum += apu_noise();
+         apu_noise();
       // if (OPT(APU_CHANNEL5_EN))
-         accum += apu_dmc();
+         apu_dmc();
       if (apu.ext) // && OPT(APU_CHANNEL6_EN))
-         accum += apu.ext->process();
-
-      /* do any filtering */
-      if (OPT(APU_FILTER_TYPE) == APU_FILTER_WEIGHTED)
-      {
-         accum = (accum + accum + accum + prev_sample) >> 2;
-      }
-      else if (OPT(APU_FILTER_TYPE) == APU_FILTER_LOWPASS)
-      {
-         accum += prev_sample;
-         accum >>= 1;
-      }
-      prev_sample = accum;
-
-      /* do clipping */
-      if (accum > 0x7FFF)
-         accum = 0x7FFF;
-      else if (accum < -0x8000)
-         accum = -0x8000;
-
-      /* signed 16-bit output */
-      *buffer++ = (short) accum;
-
-      if (stereo)
-         *buffer++ = (short) accum;
+         apu_output(&apu.ext_output, apu.ext->process(), 0);
 
       // Advance frame counter
       // apu_fc_advance(apu.cycle_rate);
    }
 
-   apu.prev_sample = prev_sample;
+   rg_blip_end_frame(apu.blip, num_samples * APU_SAMPLE_TIME);
+   num_samples = rg_blip_read_samples(apu.blip, buffer, num_samples, stereo ? 2 : 1);
+
+   /* signed 16-bit output, the same in both channels */
+   if (stereo)
+   {
+      for (size_t i = 0; i < num_samples; i++)
+         buffer[i * 2 + 1] = buffer[i * 2];
+   }
 }
 
 void apu_emulate(void)
@@ -760,6 +752,7 @@ void apu_reset(void)
    /* Update region if needed */
    apu.samples_per_frame = apu.sample_rate / NES_REFRESH_RATE;
    apu.cycle_rate = (float)NES_CPU_CLOCK / apu.sample_rate;
+   apu.cycle_time = APU_SAMPLE_TIME / apu.cycle_rate;
    apu.noise.shift_reg = 0x4000;
    apu_build_luts(apu.samples_per_frame);
 
@@ -772,6 +765,20 @@ void apu_reset(void)
 
    if (apu.ext && apu.ext->reset)
       apu.ext->reset();
+
+   /* start the synthesis over from the levels the channels just settled on */
+   apu.rectangle[0].output_vol = 0;
+   apu.rectangle[1].output_vol = 0;
+   apu.triangle.output_vol = apu_triangle_level();
+   apu.noise.output_vol = 0;
+   apu.dmc.output_vol = APU_DMC_LEVEL(apu.dmc.regs[1]);
+   apu.ext_output = 0;
+
+   if (apu.blip)
+   {
+      rg_blip_set_rates(apu.blip, APU_SAMPLE_TIME, 1);
+      rg_blip_clear(apu.blip);
+   }
 }
 
 apu_t *apu_init(int sample_rate, bool stereo)
@@ -779,11 +786,11 @@ apu_t *apu_init(int sample_rate, bool stereo)
    memset(&apu, 0, sizeof(apu_t));
 
    apu.buffer = calloc(sample_rate / 50 + 2, stereo ? 4 : 2);
+   apu.blip = rg_blip_create(sample_rate / 50 + 2);
    apu.sample_rate = sample_rate;
    apu.stereo = stereo;
    apu.ext = NULL;
 
-   apu_setopt(APU_FILTER_TYPE, APU_FILTER_WEIGHTED);
    apu_setopt(APU_CHANNEL1_EN, true);
    apu_setopt(APU_CHANNEL2_EN, true);
    apu_setopt(APU_CHANNEL3_EN, true);
@@ -800,6 +807,8 @@ void apu_shutdown()
       apu.ext->shutdown();
    free(apu.buffer);
    apu.buffer = NULL;
+   rg_blip_free(apu.blip);
+   apu.blip = NULL;
 }
 
 void apu_setext(apuext_t *ext)
@@ -23,6 +23,8 @@
 
 #pragma once
 
+#include <rg_audio.h>
+
 #define  APU_WRA0       0x4000
 #define  APU_WRA1       0x4001
 #define  APU_WRA2       0x4002
@@ -150,13 +152,6 @@ typedef struct
    int cur_byte;
 } dmc_t;
 
-enum
-{
-   APU_FILTER_NONE,
-   APU_FILTER_LOWPASS,
-   APU_FILTER_WEIGHTED
-};
-
 /* external sound chip stuff */
 typedef struct
 {
@@ -168,7 +163,6 @@ typedef struct
 
 typedef enum
 {
-   APU_FILTER_TYPE,
    APU_CHANNEL1_EN,
    APU_CHANNEL2_EN,
    APU_CHANNEL3_EN,
@@ -191,9 +185,12 @@ typedef struct
 
    short *buffer;
 
-   int prev_sample;
+   /* band-limited synthesis of the channels' output_vol changes */
+   rg_blip_t *blip;
+   int ext_output;
 
    float cycle_rate;
+   float cycle_time; /* synthesis time units per CPU cycle */
 
    struct {
       unsigned state;
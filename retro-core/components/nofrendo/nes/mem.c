@@ -25,6 +25,21 @@
 
 static mem_t mem;
 
+#ifdef RG_ENABLE_MEMTRACE
+enum {TRACE_BUS, TRACE_PPU, TRACE_APU};
+
+static inline void mem_trace(uint32 address, bool write)
+{
+   rg_memtrace_access(TRACE_BUS, address, write);
+   if ((address & 0xE000) == 0x2000)
+      rg_memtrace_access(TRACE_PPU, 0x2000 | (address & 7), write);
+   else if ((address & 0xFFE0) == 0x4000)
+      rg_memtrace_access(TRACE_APU, address, write);
+}
+#else
+#define mem_trace(address, write)
+#endif
+
 
 static void dummy_write(uint32 address, uint8 value)
 {
@@ -90,6 +105,8 @@ IRAM_ATTR uint8 mem_getbyte(uint32 address)
 {
    uint8 *page = mem.pages_read[address >> MEM_PAGESHIFT];
 
+   mem_trace(address, false);
+
    /* Special memory handlers */
    if (MEM_PAGE_HAS_HANDLERS(page))
    {
@@ -119,6 +136,8 @@ IRAM_ATTR void mem_putbyte(uint32 address, uint8 value)
 {
    uint8 *page = mem.pages_write[address >> MEM_PAGESHIFT];
 
+   mem_trace(address, true);
+
    /* Special memory handlers */
    if (MEM_PAGE_HAS_HANDLERS(page))
    {
@@ -185,6 +204,13 @@ void mem_reset(void)
          mem.write_handlers[num_write_handlers++] = write_handlers[wc++];
    }
 
+#ifdef RG_ENABLE_MEMTRACE
+   // Only accesses that miss nes6502's fast paths are seen (handlers, mostly)
+   rg_memtrace_region(TRACE_BUS, "bus", 0x0000, 8);
+   rg_memtrace_region(TRACE_PPU, "ppu", 0x2000, 0);
+   rg_memtrace_region(TRACE_APU, "apu/io", 0x4000, 0);
+#endif
+
    // Mark pages if they contain handlers (used for fast access in nes6502)
    for (mem_read_handler_t *mr = mem.read_handlers; mr->read_func != NULL; mr++)
    {
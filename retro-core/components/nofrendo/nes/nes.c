@@ -237,6 +237,7 @@ void nes_reset(bool hard_reset)
     ppu_reset();
     mem_reset();
     mmc_reset();
+    ppu_flushcache(); // Mappers may have written to CHR-RAM directly
     input_reset();
     nes6502_reset();
 
@@ -45,6 +45,21 @@
 /* the NES PPU */
 static ppu_t ppu;
 
+/* Decoded pattern cache, one row of 8 pixels (0-3) per tile row. Entries are
+** keyed by the physical address of the row's first plane in CHR-ROM/RAM, so
+** they stay valid across bank switches (MMC3 and friends switch CHR banks
+** mid-frame). The cache is direct mapped, consecutive rows of CHR memory use
+** consecutive entries. CHR-RAM writes drop the affected row. The 512 tiles of
+** the 8KB pattern space have 4096 rows, one entry each.
+*/
+#define PATCACHE_ENTRIES 4096
+
+static struct
+{
+   uint8 (*rows)[8];
+   const uint8 **tags; /* Address of the row's first plane, NULL when empty */
+   ppu_cachestats_t stats;
+} patcache;
 
 #ifndef PPU_MEM_READ
 INLINE uint8 PPU_MEM_READ(uint32 x)
@@ -56,11 +71,41 @@ INLINE uint8 PPU_MEM_READ(uint32 x)
 }
 #endif
 
+INLINE uint32 patcache_entry(const uint8 *row_ptr)
+{
+   /* Bit 3 selects the second plane, it's never part of a row's address */
+   uintptr_t addr = (uintptr_t)row_ptr;
+   return (((addr >> 1) & ~7) | (addr & 7)) & (PATCACHE_ENTRIES - 1);
+}
+
+/* The CHR-RAM byte at address was written */
+INLINE void patcache_invalidate(uint32 address)
+{
+   const uint8 *row_ptr = ppu.page[address >> 10] + (address & ~8);
+   uint32 entry = patcache_entry(row_ptr);
+
+   if (patcache.tags[entry] == row_ptr)
+      patcache.tags[entry] = NULL;
+}
+
+void ppu_flushcache(void)
+{
+   memset(patcache.tags, 0, PATCACHE_ENTRIES * sizeof(*patcache.tags));
+   patcache.stats.flushes++;
+}
+
+void ppu_getcachestats(ppu_cachestats_t *stats)
+{
+   ASSERT(stats);
+   *stats = patcache.stats;
+}
+
 void ppu_setcontext(ppu_t *src_ppu)
 {
    ASSERT(src_ppu);
    ppu = *src_ppu;
    ppu_setnametables(ppu.nt1, ppu.nt2, ppu.nt3, ppu.nt4);
+   /* The pattern cache is keyed by CHR address, bank switches don't affect it */
 }
 
 void ppu_getcontext(ppu_t *dest_ppu)
@@ -72,9 +117,7 @@ void ppu_getcontext(ppu_t *dest_ppu)
 void ppu_setpage(int size, int page_num, uint8 *location)
 {
    while (size--)
-   {
       ppu.page[page_num++] = location;
-   }
 }
 
 uint8 *ppu_getpage(int page)
@@ -304,6 +347,8 @@ IRAM_ATTR void ppu_write(uint32 address, uint8 value)
             MESSAGE_DEBUG("VRAM write to $%04X, scanline %d\n",
                            ppu.vaddr, NES_CURRENT_SCANLINE);
             PPU_MEM_WRITE(ppu.vaddr, 0xFF); /* corrupt */
+            if (ppu.vaddr < 0x2000)
+               patcache_invalidate(ppu.vaddr);
          }
          else
          {
@@ -313,6 +358,8 @@ IRAM_ATTR void ppu_write(uint32 address, uint8 value)
                ppu.vaddr -= 0x1000;
 
             PPU_MEM_WRITE(addr, value);
+            if (addr < 0x2000)
+               patcache_invalidate(addr);
          }
       }
       else
@@ -365,38 +412,55 @@ void ppu_setvreadfunc(ppu_vreadfunc_t func)
 }
 
 /* rendering routines */
-INLINE uint32 get_patpix(uint32 tile_addr)
+INLINE const uint32 *get_patpix(uint32 tile_addr)
 {
+   static uint8 uncached[8] __attribute__((aligned(4)));
+   const uint8 *row_ptr = ppu.page[tile_addr >> 10] + tile_addr;
+   uint8 *pixels = uncached;
+   uint32 entry = 0;
+
+   /* A read hook (MMC5) can return something else than the mapped memory */
+   if (!ppu.vreadfunc)
+   {
+      entry = patcache_entry(row_ptr);
+      pixels = patcache.rows[entry];
+      if (patcache.tags[entry] == row_ptr)
+      {
+         patcache.stats.hits++;
+         return (const uint32 *)pixels;
+      }
+   }
+
    uint8 pat1 = PPU_MEM_READ(tile_addr);
    uint8 pat2 = PPU_MEM_READ(tile_addr + 8);
-   return ((pat2 & 0xAA) << 8) | ((pat2 & 0x55) << 1)
-        | ((pat1 & 0xAA) << 7) | (pat1 & 0x55);
+
+   for (int i = 0; i < 8; i++)
+      pixels[i] = ((pat1 >> (7 - i)) & 1) | (((pat2 >> (7 - i)) & 1) << 1);
+
+   if (!ppu.vreadfunc)
+      patcache.tags[entry] = row_ptr;
+   patcache.stats.misses++;
+
+   return (const uint32 *)pixels;
+}
+
+INLINE bool is_transparent(const uint32 *pattern)
+{
+   return 0 == (pattern[0] | pattern[1]);
 }
 
-INLINE void build_tile_colors(bool flip, uint32 pattern, uint8 *colors)
+INLINE void build_tile_colors(bool flip, const uint32 *pattern, uint32 *colors)
 {
    /* swap pixels around if our tile is flipped */
    if (flip)
    {
-      colors[7] = (pattern >> 14) & 3;
-      colors[6] = (pattern >> 6) & 3;
-      colors[5] = (pattern >> 12) & 3;
-      colors[4] = (pattern >> 4) & 3;
-      colors[3] = (pattern >> 10) & 3;
-      colors[2] = (pattern >> 2) & 3;
-      colors[1] = (pattern >> 8) & 3;
-      colors[0] = pattern & 3;
+      colors[0] = __builtin_bswap32(pattern[1]);
+      colors[1] = __builtin_bswap32(pattern[0]);
    }
    else
    {
-      colors[0] = (pattern >> 14) & 3;
-      colors[1] = (pattern >> 6) & 3;
-      colors[2] = (pattern >> 12) & 3;
-      colors[3] = (pattern >> 4) & 3;
-      colors[4] = (pattern >> 10) & 3;
-      colors[5] = (pattern >> 2) & 3;
-      colors[6] = (pattern >> 8) & 3;
-      colors[7] = pattern & 3;
+      colors[0] = pattern[0];
+      colors[1] = pattern[1];
    }
 }
 
@@ -404,19 +468,20 @@ INLINE void build_tile_colors(bool flip, uint32 pattern, uint8 *colors)
 ** where the sprite 0 strike is going to occur (in terms of
 ** cpu cycles), using the relation that 3 pixels == 1 cpu cycle
 */
-INLINE void check_strike(uint8 *surface, uint8 attrib, uint32 pattern)
+INLINE void check_strike(uint8 *surface, uint8 attrib, const uint32 *pattern)
 {
-   uint8 colors[8];
+   uint32 colors32[2];
+   uint8 *colors = (uint8 *)colors32;
 
    /* Flag already set */
    if (ppu.strikeflag)
       return;
 
    /* sprite is 100% transparent */
-   if (0 == pattern)
+   if (is_transparent(pattern))
       return;
 
-   build_tile_colors(attrib & OAMF_HFLIP, pattern, colors);
+   build_tile_colors(attrib & OAMF_HFLIP, pattern, colors32);
 
    for (int i = 0; i < 8; i++)
    {
@@ -430,27 +495,30 @@ INLINE void check_strike(uint8 *surface, uint8 attrib, uint32 pattern)
    }
 }
 
-INLINE void draw_bgtile(uint8 *surface, uint32 pattern, const uint8 *colors)
+INLINE void draw_bgtile(uint8 *surface, const uint32 *pattern, const uint8 *colors)
 {
-   *surface++ = colors[(pattern >> 14) & 3];
-   *surface++ = colors[(pattern >> 6) & 3];
-   *surface++ = colors[(pattern >> 12) & 3];
-   *surface++ = colors[(pattern >> 4) & 3];
-   *surface++ = colors[(pattern >> 10) & 3];
-   *surface++ = colors[(pattern >> 2) & 3];
-   *surface++ = colors[(pattern >> 8) & 3];
-   *surface   = colors[pattern & 3];
+   const uint8 *pixels = (const uint8 *)pattern;
+
+   *surface++ = colors[pixels[0]];
+   *surface++ = colors[pixels[1]];
+   *surface++ = colors[pixels[2]];
+   *surface++ = colors[pixels[3]];
+   *surface++ = colors[pixels[4]];
+   *surface++ = colors[pixels[5]];
+   *surface++ = colors[pixels[6]];
+   *surface   = colors[pixels[7]];
 }
 
-INLINE void draw_oamtile(uint8 *surface, uint8 attrib, uint32 pattern, const uint8 *col_tbl)
+INLINE void draw_oamtile(uint8 *surface, uint8 attrib, const uint32 *pattern, const uint8 *col_tbl)
 {
-   uint8 colors[8];
+   uint32 colors32[2];
+   uint8 *colors = (uint8 *)colors32;
 
    /* sprite is 100% transparent */
-   if (0 == pattern)
+   if (is_transparent(pattern))
       return;
 
-   build_tile_colors(attrib & OAMF_HFLIP, pattern, colors);
+   build_tile_colors(attrib & OAMF_HFLIP, pattern, colors32);
 
    /* draw the character */
    if (attrib & OAMF_BEHIND)
@@ -732,12 +800,24 @@ void ppu_reset()
    ppu.latch = 0;
    ppu.vram_accessible = true;
    ppu.last_scanline = NES_SCANLINES - 1;
+
+   ppu_flushcache();
 }
 
 ppu_t *ppu_init(void)
 {
    memset(&ppu, 0, sizeof(ppu_t));
 
+   if (!patcache.rows)
+      patcache.rows = malloc(PATCACHE_ENTRIES * 8);
+   if (!patcache.tags)
+      patcache.tags = malloc(PATCACHE_ENTRIES * sizeof(*patcache.tags));
+   if (!patcache.rows || !patcache.tags)
+      return NULL;
+
+   memset(&patcache.stats, 0, sizeof(patcache.stats));
+   ppu_flushcache();
+
    ppu_setopt(PPU_DRAW_BACKGROUND, true);
    ppu_setopt(PPU_DRAW_SPRITES, true);
    ppu_setopt(PPU_LIMIT_SPRITES, true);
@@ -91,6 +91,13 @@ typedef struct
    uint8 x_loc;
 } ppu_obj_t;
 
+typedef struct
+{
+   uint32 hits;
+   uint32 misses;
+   uint32 flushes;
+} ppu_cachestats_t;
+
 typedef struct
 {
    /* The NES has only 2 nametables, but we allocate 4 for mappers to use */
@@ -158,6 +165,10 @@ void ppu_setvreadfunc(ppu_vreadfunc_t func);
 void ppu_getcontext(ppu_t *dest_ppu);
 void ppu_setcontext(ppu_t *src_ppu);
 
+/* Decoded pattern cache */
+void ppu_flushcache(void);
+void ppu_getcachestats(ppu_cachestats_t *stats);
+
 /* IO */
 uint8 ppu_read(uint32 address);
 void ppu_write(uint32 address, uint8 value);
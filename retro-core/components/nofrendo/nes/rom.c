@@ -254,13 +254,14 @@ rom_t *rom_loadmem(uint8 *data, size_t size)
 rom_t *rom_loadfile(const char *filename)
 {
    uint8 *data = NULL;
-   long size = 0;
+   size_t size = 0;
 
    if (!filename)
       return NULL;
 
-   FILE *fp = fopen(filename, "rb");
-   if (!fp)
+   // On the host the file is mmapped, elsewhere it's read into memory
+   data = rg_storage_map(filename, &size, 0);
+   if (!data)
    {
       MESSAGE_ERROR("ROM: Unable to open file '%s'\n", filename);
       return NULL;
@@ -268,29 +269,16 @@ rom_t *rom_loadfile(const char *filename)
 
    MESSAGE_INFO("ROM: Loading file '%s'\n", filename);
 
-   fseek(fp, 0, SEEK_END);
-   size = ftell(fp);
-   fseek(fp, 0, SEEK_SET);
-
    if (size < 16 || size > 0x200000)
    {
       MESSAGE_ERROR("ROM: File size error\n");
    }
-   else if ((data = malloc(size)) == NULL)
-   {
-      MESSAGE_ERROR("ROM: Memory allocation failed\n");
-   }
-   else if (fread(data, size, 1, fp) != 1)
-   {
-      MESSAGE_ERROR("ROM: Read error\n");
-   }
    else if (rom_loadmem(data, size) == NULL)
    {
       MESSAGE_ERROR("ROM: Load error\n");
    }
    else
    {
-      fclose(fp);
       if (rom.system == SYS_UNKNOWN)
       {
          if (strstr(filename, "(E)")
@@ -308,8 +296,7 @@ rom_t *rom_loadfile(const char *filename)
       return &rom;
    }
 
-   fclose(fp);
-   free(data);
+   rg_storage_unmap(data);
    return NULL;
 }
 
@@ -321,7 +308,7 @@ void rom_free(void)
 #endif
    if (rom.flags & ROM_FLAG_FREE_DATA)
    {
-      free(rom.data_ptr);
+      rg_storage_unmap(rom.data_ptr);
       rom.data_ptr = NULL;
    }
    free(rom.prg_ram);
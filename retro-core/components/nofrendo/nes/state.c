@@ -468,6 +468,9 @@ int state_load(const char* fn)
    /* close file, we're done */
    fclose(file);
 
+   /* VRAM was loaded behind the PPU's back */
+   ppu_flushcache();
+
    MESSAGE_INFO("state_load: Game restored\n");
 
    return 0;
@@ -477,3 +480,92 @@ _error:
    fclose(file);
    return -1;
 }
+
+
+/**
+ * Snapshots are in-memory states used by run-ahead. Unlike SNSS they are
+ * a raw dump of the internal contexts, they're only valid for the current
+ * session but they're much faster and restore the APU exactly.
+ */
+
+typedef struct
+{
+   nes6502_t cpu;
+   ppu_t ppu;
+   apu_t apu;
+   mem_t mem;
+   input_t input[2];
+   int scanline;
+   float cycles;
+   uint8 mapper[0x80];
+} snapshot_t;
+
+int state_save_snapshot(void *buffer, size_t *size)
+{
+   nes_t *machine = nes_getptr();
+   size_t prg_ram_size = 0x2000 * machine->cart->prg_ram_banks;
+   size_t chr_ram_size = 0x2000 * machine->cart->chr_ram_banks;
+   size_t total_size = sizeof(snapshot_t) + prg_ram_size + chr_ram_size;
+   snapshot_t *snapshot = buffer;
+
+   if (*size < total_size)
+   {
+      *size = total_size;
+      return -1;
+   }
+
+   nes6502_getcontext(&snapshot->cpu);
+   ppu_getcontext(&snapshot->ppu);
+   apu_getcontext(&snapshot->apu);
+   memcpy(&snapshot->mem, machine->mem, sizeof(mem_t));
+   memcpy(&snapshot->input, machine->input, sizeof(snapshot->input));
+   snapshot->scanline = machine->scanline;
+   snapshot->cycles = machine->cycles;
+
+   if (machine->mapper->get_state)
+      machine->mapper->get_state(snapshot->mapper);
+
+   memcpy((uint8_t *)buffer + sizeof(snapshot_t), machine->cart->prg_ram, prg_ram_size);
+   memcpy((uint8_t *)buffer + sizeof(snapshot_t) + prg_ram_size, machine->cart->chr_ram, chr_ram_size);
+
+   *size = total_size;
+
+   return 0;
+}
+
+int state_load_snapshot(void *buffer, size_t size)
+{
+   nes_t *machine = nes_getptr();
+   size_t prg_ram_size = 0x2000 * machine->cart->prg_ram_banks;
+   size_t chr_ram_size = 0x2000 * machine->cart->chr_ram_banks;
+   snapshot_t *snapshot = buffer;
+
+   if (size < sizeof(snapshot_t) + prg_ram_size + chr_ram_size)
+   {
+      MESSAGE_ERROR("state_load_snapshot: Invalid snapshot size!\n");
+      return -1;
+   }
+
+   nes6502_setcontext(&snapshot->cpu);
+   ppu_setcontext(&snapshot->ppu);
+   apu_setcontext(&snapshot->apu);
+   memcpy(machine->mem, &snapshot->mem, sizeof(mem_t));
+   memcpy(machine->input, &snapshot->input, sizeof(snapshot->input));
+   machine->scanline = snapshot->scanline;
+   machine->cycles = snapshot->cycles;
+
+   if (machine->mapper->set_state)
+      machine->mapper->set_state(snapshot->mapper);
+
+   memcpy(machine->cart->prg_ram, (uint8_t *)buffer + sizeof(snapshot_t), prg_ram_size);
+
+   /* Decoded patterns only go stale if CHR-RAM writes are being rolled back */
+   const uint8_t *chr_ram = (uint8_t *)buffer + sizeof(snapshot_t) + prg_ram_size;
+   if (chr_ram_size && memcmp(machine->cart->chr_ram, chr_ram, chr_ram_size) != 0)
+   {
+      memcpy(machine->cart->chr_ram, chr_ram, chr_ram_size);
+      ppu_flushcache();
+   }
+
+   return 0;
+}
@@ -22,6 +22,30 @@ static struct {
 
 static uint8_t *framebuffer_top, *framebuffer_bottom;
 
+/*
+	Everything a line's pixels depend on. If a framebuffer line was drawn with the
+	same state then it already holds the right pixels and can be left alone.
+	A width of 0 marks a line that holds nothing we know about.
+*/
+typedef struct {
+	uint32_t generation;
+	uint16_t scroll_x;
+	uint16_t scroll_y;
+	uint16_t control;
+	uint16_t width;
+} line_state_t;
+
+// The frontend alternates between two framebuffers
+#define LINE_CACHE_SLOTS 2
+
+static struct {
+	uint8_t *buffer;
+	line_state_t lines[XBUF_HEIGHT];
+} line_cache[LINE_CACHE_SLOTS];
+
+static int line_cache_slot = 0;
+static bool dirty_lines[XBUF_HEIGHT];
+
 /*
 	Draw background tiles between two lines
 */
@@ -306,7 +330,53 @@ gfx_latch_context(int force)
 
 
 /*
-	Render lines into the buffer from min_line to max_line (inclusive)
+	Draw lines Y1 to Y2 (exclusive) using the latched context
+*/
+static void
+draw_lines(uint8_t *screen_buffer, int Y1, int Y2)
+{
+	// We must fill the region with color 0 first.
+	size_t screen_width = IO_VDC_SCREEN_WIDTH;
+	for (int y = Y1; y < Y2; y++) {
+		memset(screen_buffer + (y * XBUF_WIDTH), PCE.Palette[0], screen_width);
+	}
+
+	// Sprites with priority 0 are drawn behind the tiles
+	if (gfx_context.control & 0x40) {
+		draw_sprites(screen_buffer, Y1, Y2, 0);
+	}
+
+	// Draw the background tiles
+	if (gfx_context.control & 0x80) {
+		draw_tiles(screen_buffer, Y1, Y2, gfx_context.scroll_x, gfx_context.scroll_y);
+	}
+
+	// Draw regular sprites
+	if (gfx_context.control & 0x40) {
+		draw_sprites(screen_buffer, Y1, Y2, 1);
+	}
+}
+
+
+/*
+	Find the line states of the given framebuffer, starting fresh if we don't know it
+*/
+static line_state_t *
+line_cache_get(uint8_t *buffer)
+{
+	if (line_cache[line_cache_slot].buffer != buffer) {
+		line_cache_slot = (line_cache_slot + 1) % LINE_CACHE_SLOTS;
+		if (line_cache[line_cache_slot].buffer != buffer) {
+			memset(&line_cache[line_cache_slot], 0, sizeof(line_cache[0]));
+			line_cache[line_cache_slot].buffer = buffer;
+		}
+	}
+	return line_cache[line_cache_slot].lines;
+}
+
+
+/*
+	Render lines into the buffer from min_line to max_line (exclusive)
 */
 static inline void
 render_lines(int min_line, int max_line)
@@ -322,26 +392,50 @@ render_lines(int min_line, int max_line)
 	framebuffer_top = screen_buffer - 16;
 	framebuffer_bottom = screen_buffer + PCE.VDC.screen_height * XBUF_WIDTH;
 
-	// We must fill the region with color 0 first.
-	size_t screen_width = IO_VDC_SCREEN_WIDTH;
-	for (int y = min_line; y <= max_line; y++) {
-		memset(screen_buffer + (y * XBUF_WIDTH), PCE.Palette[0], screen_width);
+	line_state_t *lines = line_cache_get(screen_buffer);
+	line_state_t state = {
+		.generation = PCE.VDC.generation,
+		.scroll_x = gfx_context.scroll_x,
+		.scroll_y = gfx_context.scroll_y,
+		.control = gfx_context.control,
+		.width = IO_VDC_SCREEN_WIDTH,
+	};
+
+	max_line = MIN(max_line, XBUF_HEIGHT);
+
+	// Only redraw the runs of lines that were drawn from a different state
+	for (int y = min_line; y < max_line;) {
+		if (memcmp(&lines[y], &state, sizeof(state)) == 0) {
+			y++;
+			continue;
+		}
+		int start = y;
+		while (y < max_line && memcmp(&lines[y], &state, sizeof(state)) != 0) {
+			lines[y++] = state;
+		}
+		draw_lines(screen_buffer, start, y);
 	}
+}
 
-	// Sprites with priority 0 are drawn behind the tiles
-	if (gfx_context.control & 0x40) {
-		draw_sprites(screen_buffer, min_line, max_line, 0);
-	}
 
-	// Draw the background tiles
-	if (gfx_context.control & 0x80) {
-		draw_tiles(screen_buffer, min_line, max_line, gfx_context.scroll_x, gfx_context.scroll_y);
+/*
+	Lines that differ between the last two framebuffers handed to us, or NULL if unknown
+*/
+const bool *
+gfx_dirty_lines(void)
+{
+	const line_state_t *cur = line_cache[line_cache_slot].lines;
+	const line_state_t *prev = line_cache[(line_cache_slot + 1) % LINE_CACHE_SLOTS].lines;
+
+	if (!line_cache[0].buffer || !line_cache[1].buffer) {
+		return NULL;
 	}
 
-	// Draw regular sprites
-	if (gfx_context.control & 0x40) {
-		draw_sprites(screen_buffer, min_line, max_line, 1);
+	for (int y = 0; y < XBUF_HEIGHT; y++) {
+		dirty_lines[y] = !cur[y].width || !prev[y].width || memcmp(&cur[y], &prev[y], sizeof(*cur)) != 0;
 	}
+
+	return dirty_lines;
 }
 
 
@@ -358,6 +452,7 @@ gfx_reset(bool hard)
 {
 	last_line_counter = 0;
 	line_counter = 0;
+	memset(line_cache, 0, sizeof(line_cache));
 }
 
 
@@ -454,7 +549,10 @@ gfx_run(void)
 
 		/* VRAM to SATB DMA */
 		if (PCE.VDC.satb == DMA_TRANSFER_PENDING || AutoSATBON) {
-			memcpy(PCE.SPRAM, PCE.VRAM + IO_VDC_REG[SATB].W, 512);
+			if (memcmp(PCE.SPRAM, PCE.VRAM + IO_VDC_REG[SATB].W, 512) != 0) {
+				memcpy(PCE.SPRAM, PCE.VRAM + IO_VDC_REG[SATB].W, 512);
+				PCE.VDC.generation++;
+			}
 			PCE.VDC.satb = DMA_TRANSFER_COUNTER + 4;
 		}
 	}
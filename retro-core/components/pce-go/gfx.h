@@ -8,3 +8,4 @@ void gfx_term(void);
 void gfx_irq(int type);
 void gfx_reset(bool hard);
 void gfx_latch_context(int force);
+const bool *gfx_dirty_lines(void);
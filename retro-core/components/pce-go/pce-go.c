@@ -105,7 +105,7 @@ LoadCard(const char *name)
 
 	MESSAGE_INFO("Opening %s...\n", name);
 
-	FILE *fp = fopen(name, "rb");
+	rg_reader_t *fp = rg_storage_reader_open(name);
 
 	if (fp == NULL)
 	{
@@ -118,8 +118,7 @@ LoadCard(const char *name)
 	}
 
 	// find file size
-	fseek(fp, 0, SEEK_END);
-	fsize = ftell(fp);
+	fsize = rg_storage_reader_size(fp);
 	offset = fsize & 0x1fff;
 
 	// read ROM
@@ -128,13 +127,13 @@ LoadCard(const char *name)
 	if (PCE.ROM == NULL)
 	{
 		MESSAGE_ERROR("Failed to allocate ROM buffer!\n");
+		rg_storage_reader_close(fp);
 		return -1;
 	}
 
-	fseek(fp, 0, SEEK_SET);
-	fread(PCE.ROM, 1, fsize, fp);
+	rg_storage_reader_read(fp, 0, PCE.ROM, fsize);
 
-	fclose(fp);
+	rg_storage_reader_close(fp);
 
 	PCE.ROM_SIZE = (fsize - offset) / 0x2000;
 	PCE.ROM_DATA = PCE.ROM + offset;
@@ -303,6 +302,16 @@ PalettePCE(int bitdepth)
 }
 
 
+/**
+ * Returns which framebuffer lines changed since the previous frame (NULL if unknown)
+ */
+const bool *
+DirtyLinesPCE(void)
+{
+	return gfx_dirty_lines();
+}
+
+
 /**
  * Start the emulation
  */
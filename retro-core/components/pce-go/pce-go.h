@@ -10,7 +10,7 @@
 
 #ifdef RETRO_GO
 #include <rg_system.h>
-#define LOG_PRINTF(level, x...) rg_system_log(RG_LOG_USER, NULL, x)
+#define LOG_PRINTF(level, fmt, x...) rg_system_log(RG_LOG_USER | RG_LOG_FLAGS(fmt), NULL, fmt, ## x)
 #define crc32_le(a, b, c) rg_crc32(a, b, c)
 #else
 #define LOG_PRINTF(level, x...) printf(x)
@@ -79,6 +79,7 @@ void ShutdownPCE();
 int InitPCE(int samplerate, bool stereo, const char *huecard);
 int LoadCard(const char *name);
 void *PalettePCE(int bitdepth);
+const bool *DirtyLinesPCE(void);
 
 extern uint8_t *osd_gfx_framebuffer(int width, int height);
 extern void osd_input_read(uint8_t joypads[8]);
@@ -15,6 +15,20 @@ uint8_t *PageW[8];
 
 static inline void timer_run(int cycles);
 
+#ifdef RG_ENABLE_MEMTRACE
+enum {MEMTRACE_IO, MEMTRACE_VDC};
+
+static inline void io_trace(uint16_t A, bool write)
+{
+	rg_memtrace_access(MEMTRACE_IO, A & 0x1FFF, write);
+	// VDC data port accesses, by selected register
+	if ((A & 0x1F02) == 0x0002)
+		rg_memtrace_access(MEMTRACE_VDC, PCE.VDC.reg, write);
+}
+#else
+#define io_trace(A, write)
+#endif
+
 /**
   * Reset the hardware
   **/
@@ -87,6 +101,11 @@ pce_init(void)
 	PCE.MemoryMapR[0xFF] = PCE.IOAREA;
 	PCE.MemoryMapW[0xFF] = PCE.IOAREA;
 
+#ifdef RG_ENABLE_MEMTRACE
+	rg_memtrace_region(MEMTRACE_IO, "io", 0x0000, 5);
+	rg_memtrace_region(MEMTRACE_VDC, "vdc regs", 0x00, 0);
+#endif
+
 	// pce_reset();
 
 	return 0;
@@ -192,6 +211,8 @@ pce_readIO(uint16_t A)
 {
 	uint8_t ret = 0xFF; // Open Bus
 
+	io_trace(A, false);
+
 	// The last read value in 0800-017FF is read from the io buffer
 	if (A >= 0x800 && A < 0x1800)
 		ret = PCE.io_buffer;
@@ -310,6 +331,7 @@ inline void
 pce_writeIO(uint16_t A, uint8_t V)
 {
 	TRACE_IO("IO Write %02x at %04x\n", V, A);
+	io_trace(A, true);
 
 	// The last write value in 0800-017FF is saved in the io buffer
 	if (A >= 0x800 && A < 0x1800)
@@ -365,6 +387,8 @@ pce_writeIO(uint16_t A, uint8_t V)
 				break;
 
 			case MWR:                           // Memory Width Register
+				if (IO_VDC_REG_ACTIVE.B.l != V)
+					PCE.VDC.generation++;
 				break;
 
 			case HSR:
@@ -416,7 +440,11 @@ pce_writeIO(uint16_t A, uint8_t V)
 			case VWR:                           // VRAM Write Register
 				// I am not 100% sure if MAWR should wrap instead, eg IO_VDC_REG[MAWR].W & 0x7FFF
 				if (IO_VDC_REG[MAWR].W < 0x8000) {
-					PCE.VRAM[IO_VDC_REG[MAWR].W] = (V << 8) | IO_VDC_REG_ACTIVE.B.l;
+					uint16_t word = (V << 8) | IO_VDC_REG_ACTIVE.B.l;
+					if (PCE.VRAM[IO_VDC_REG[MAWR].W] != word) {
+						PCE.VRAM[IO_VDC_REG[MAWR].W] = word;
+						PCE.VDC.generation++;
+					}
 				}
 				IO_VDC_REG_INC(MAWR);
 				break;
@@ -454,6 +482,8 @@ pce_writeIO(uint16_t A, uint8_t V)
 				break;
 
 			case MWR:                           // Memory Width Register
+				if (IO_VDC_REG_ACTIVE.B.h != V)
+					PCE.VDC.generation++;
 				break;
 
 			case HSR:
@@ -501,6 +531,7 @@ pce_writeIO(uint16_t A, uint8_t V)
 					IO_VDC_REG[DISTR].W += dst_inc;
 					IO_VDC_REG[LENR].W -= 1;
 				}
+				PCE.VDC.generation++;
 
 				gfx_irq(VDC_STAT_DV);
 				return;
@@ -541,8 +572,11 @@ pce_writeIO(uint16_t A, uint8_t V)
 				if (n == 0) {
 					for (int i = 0; i < 256; i += 16)
 						PCE.Palette[i] = c;
-				} else if (n & 15)
+					PCE.VDC.generation++;
+				} else if ((n & 15) && PCE.Palette[n] != c) {
 					PCE.Palette[n] = c;
+					PCE.VDC.generation++;
+				}
 			}
 			return;
 
@@ -554,8 +588,11 @@ pce_writeIO(uint16_t A, uint8_t V)
 				if (n == 0) {
 					for (int i = 0; i < 256; i += 16)
 						PCE.Palette[i] = c;
-				} else if (n & 15)
+					PCE.VDC.generation++;
+				} else if ((n & 15) && PCE.Palette[n] != c) {
 					PCE.Palette[n] = c;
+					PCE.VDC.generation++;
+				}
 			}
 			PCE.VCE.reg = (PCE.VCE.reg + 1) & 0x1FF;
 			return;
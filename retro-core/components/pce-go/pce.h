@@ -206,6 +206,7 @@ typedef struct {
 		uint32_t pending_irqs;	/* Pending VDC IRQs (we use it as a stack of 4bit events) */
 		uint32_t screen_width;	/* Effective resolution updated by mode_chg */
 		uint32_t screen_height;	/* Effective resolution updated by mode_chg */
+		uint32_t generation;	/* Bumped on any VRAM, SATB, palette or MWR change */
 	} VDC;
 
 	// Programmable Sound Generator
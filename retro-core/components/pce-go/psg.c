@@ -12,23 +12,60 @@ static const uint8_t vol_tbl[32] = {
 	7085 >> 8, 7986 >> 8, 9002 >> 8, 10148 >> 8, 11439 >> 8, 12894 >> 8, 14535 >> 8, 16384 >> 8
 };
 
-// The buffer should be signed but it seems to sound better
-// unsigned. I am still reviewing the implementation bellow.
-// In some games it also sounds better in 8 bit than in 16...
-// typedef uint8_t sample_t;
-typedef int16_t sample_t;
-
 static int samplerate = 22050;
 static int stereo = true;
 
+// The channels only report changes of their output to the band-limited buffers (left, right)
+static rg_blip_t *blip[2];
+static struct {
+	int left, right; // Output last sent to the buffers
+} out[PSG_CHANNELS];
+static struct {
+	int lvol, rvol;  // Master volume
+	bool unsigned_samples;
+	int clocks_per_sample;
+} mix;
+
+
+static inline void
+psg_output(int ch, unsigned time, int sample, int lvol, int rvol)
+{
+	int l = sample * lvol;
+	int r = sample * rvol;
+
+	// The "unsigned audio" option, it sounds better in some games...
+	if (mix.unsigned_samples) {
+		l = (uint8_t)l;
+		r = (uint8_t)r;
+	}
+
+	l *= mix.lvol;
+	r *= mix.rvol;
+
+	if (!stereo) {
+		l = (l + r) >> 1;
+		r = 0;
+	}
+
+	if (l != out[ch].left) {
+		rg_blip_add_delta(blip[0], time, l - out[ch].left);
+		out[ch].left = l;
+	}
+
+	if (r != out[ch].right) {
+		rg_blip_add_delta(blip[1], time, r - out[ch].right);
+		out[ch].right = r;
+	}
+}
+
 
 static inline void
-psg_update_chan(sample_t *buf, int ch, size_t dwSize)
+psg_update_chan(int ch, unsigned clocks)
 {
 	psg_chan_t *chan = &PCE.PSG.chan[ch];
+	unsigned time = 0;
 	int sample = 0;
 	uint32_t Tp;
-	sample_t *buf_end = buf + dwSize;
 
 	/*
 	* This gives us a volume level of (0...15).
@@ -36,51 +73,31 @@ psg_update_chan(sample_t *buf, int ch, size_t dwSize)
 	int lvol = (((chan->balance >> 4) * 1.1) * (chan->control & 0x1F)) / 32;
 	int rvol = (((chan->balance & 0xF) * 1.1) * (chan->control & 0x1F)) / 32;
 
-	if (!stereo) {
-		lvol = (lvol + rvol) / 2;
-	}
-
 	// This isn't very accurate, we don't track how long each DA sample should play
 	// but we call psg_update() often enough (10x per frame) that guessing should be good enough...
 	if (chan->dda_count) {
-		// Cycles per frame: 119318
-		// Samples per frame: 368
-
-		// Cycles per scanline: 454
-		// Samples per scanline: ~1.4
-
-		// One sample = 324 cycles
-
-		// const int cycles_per_sample = CYCLES_PER_FRAME / (host.sound.sample_freq / 60);
-
-		// float repeat = (float)elapsed / cycles_per_sample / chan->dda_count;
-		// MESSAGE_INFO("%.2f\n", repeat);
-
 		int start = (int)chan->dda_index - chan->dda_count;
 		if (start < 0)
 			start += 0x100;
 
-		int repeat = 3; // MIN(2, (dwSize / 2) / chan->dda_count) + 1;
+		int dda_lvol = vol_tbl[lvol << 1];
+		int dda_rvol = vol_tbl[rvol << 1];
 
-		lvol = vol_tbl[lvol << 1];
-		rvol = vol_tbl[rvol << 1];
-
-		while (buf < buf_end && (chan->dda_count || chan->control & PSG_DDA_ENABLE)) {
-			if (chan->dda_count) {
-				// sample = chan->dda_data[(start++) & 0x7F];
-				if ((sample = (chan->dda_data[(start++) & 0xFF] - 16)) >= 0)
-					sample++;
-				chan->dda_count--;
-			}
+		while (chan->dda_count && time < clocks) {
+			if ((sample = (chan->dda_data[(start++) & 0xFF] - 16)) >= 0)
+				sample++;
+			chan->dda_count--;
+			psg_output(ch, time, sample, dda_lvol, dda_rvol);
+			time += mix.clocks_per_sample * 3;
+		}
 
-			for (int i = 0; i < repeat; i++) {
-				*buf++ = (sample * lvol);
+		// The last sample is held until the end of the update
+		if (chan->control & PSG_DDA_ENABLE)
+			return;
+	}
 
-				if (stereo) {
-					*buf++ = (sample * rvol);
-				}
-			}
-		}
+	if (time >= clocks) {
+		return;
 	}
 
 	/*
@@ -88,85 +105,72 @@ psg_update_chan(sample_t *buf, int ch, size_t dwSize)
 	*/
 	if (!(chan->control & PSG_CHAN_ENABLE)) {
 		chan->wave_accum = 0;
+		psg_output(ch, time, 0, lvol, rvol);
 	}
 	/*
 	* PSG Noise generation (it has priority over DDA and WAVE)
 	*/
 	else if ((ch == 4 || ch == 5) && (chan->noise_ctrl & PSG_NOISE_ENABLE)) {
 		int Np = (chan->noise_ctrl & 0x1F);
-
-		while (buf < buf_end) {
-			chan->noise_accum += 3000 + Np * 512;
-
-			if ((Tp = (chan->noise_accum / samplerate)) >= 1) {
-				if (chan->noise_rand & 0x00080000) {
-					chan->noise_rand = ((chan->noise_rand ^ 0x0004) << 1) + 1;
-					chan->noise_level = -15;
-				} else {
-					chan->noise_rand <<= 1;
-					chan->noise_level = 15;
-				}
-				chan->noise_accum -= samplerate * Tp;
-			}
-
-			*buf++ = (chan->noise_level * lvol);
-
-			if (stereo) {
-				*buf++ = (chan->noise_level * rvol);
+		unsigned period = CLOCK_PSG / (3000 + Np * 512);
+
+		// noise_accum is the number of clocks until the next step
+		psg_output(ch, time, chan->noise_level, lvol, rvol);
+
+		for (time += chan->noise_accum; time < clocks; time += period) {
+			if (chan->noise_rand & 0x00080000) {
+				chan->noise_rand = ((chan->noise_rand ^ 0x0004) << 1) + 1;
+				chan->noise_level = -15;
+			} else {
+				chan->noise_rand <<= 1;
+				chan->noise_level = 15;
 			}
+			psg_output(ch, time, chan->noise_level, lvol, rvol);
 		}
+
+		chan->noise_accum = time - clocks;
 	}
 	/*
 	* There is 'direct access' audio to be played.
 	*/
 	else if (chan->control & PSG_DDA_ENABLE) {
-
+		psg_output(ch, time, 0, lvol, rvol);
 	}
 	/*
 	* PSG Wave generation.
+	*
+	* Taken from the PSG doc written by Paul Clifford (paul@plasma.demon.co.uk)
+	* <in reference to the 12 bit frequency value in PSG registers 2 and 3>
+	* "For waveform output, a copy of this value is, in effect, decremented 3,580,000
+	*  times a second until zero is reached.  When this happens the PSG advances an
+	*  internal pointer into the channel's waveform buffer by one."
+	*
+	* So the pointer advances every Tp clocks of CLOCK_PSG.
 	*/
-	else if ((Tp = chan->freq_lsb + (chan->freq_msb << 8)) > 0) {
-		/*
-		 * Thank god for well commented code!  The original line of code read:
-		 * fixed_inc = ((uint32_t) (3.2 * 1118608 / samplerate) << 16) / Tp;
-		 * and had nary a comment to be found.  It took a little head scratching to get
-		 * it figured out.  The 3.2 * 1118608 comes out to 3574595.6 which is obviously
-		 * meant to represent the 3.58mhz cpu clock speed used in the pc engine to
-		 * decrement the sound 'frequency'.  I haven't figured out why the original
-		 * author had the two numbers multiplied together to get the odd value instead of
-		 * just using 3580000.  I did some checking and the value will compute the same
-		 * using either value divided by any standard soundcard samplerate.
-		 *
-		 * Taken from the PSG doc written by Paul Clifford (paul@plasma.demon.co.uk)
-		 * <in reference to the 12 bit frequency value in PSG registers 2 and 3>
-		 * "For waveform output, a copy of this value is, in effect, decremented 3,580,000
-		 *  times a second until zero is reached.  When this happens the PSG advances an
-		 *  internal pointer into the channel's waveform buffer by one."
-		 *
-		 * So all we need to do to emulate original pc engine behaviour is take our soundcard's
-		 * sampling rate into consideration with regard to the 3580000 effective pc engine
-		 * samplerate.  We use 16.16 fixed arithmetic for speed.
-		 */
-		uint32_t fixed_inc = ((CLOCK_PSG / samplerate) << 16) / Tp;
-
-		while (buf < buf_end) {
+	else if ((Tp = chan->freq_lsb + (chan->freq_msb << 8)) > 0 && Tp * 32 >= mix.clocks_per_sample * 2) {
+		// Steps faster than the output rate are grouped, the buffer filters out what they'd add
+		unsigned step = (mix.clocks_per_sample + Tp - 1) / Tp;
+		unsigned period = Tp * step;
+
+		// wave_accum is the number of clocks until the next step
+		if ((sample = (chan->wave_data[chan->wave_index] - 16)) >= 0)
+			sample++;
+		psg_output(ch, time, sample, lvol, rvol);
+
+		for (time += chan->wave_accum; time < clocks; time += period) {
+			chan->wave_index = (chan->wave_index + step) & 0x1F;
 			if ((sample = (chan->wave_data[chan->wave_index] - 16)) >= 0)
 				sample++;
-
-			*buf++ = (sample * lvol);
-
-			if (stereo) {
-				*buf++ = (sample * rvol);
-			}
-
-			chan->wave_accum += fixed_inc;
-			chan->wave_accum &= 0x1FFFFF;	/* (31 << 16) + 0xFFFF */
-			chan->wave_index = chan->wave_accum >> 16;
+			psg_output(ch, time, sample, lvol, rvol);
 		}
-	}
 
-	if (buf < buf_end) {
-		memset(buf, 0, (void*)buf_end - (void*)buf);
+		chan->wave_accum = time - clocks;
+	}
+	/*
+	* Out of the audible range (or stopped)
+	*/
+	else {
+		psg_output(ch, time, 0, lvol, rvol);
 	}
 }
 
@@ -180,6 +184,17 @@ psg_init(int _samplerate, bool _stereo)
 	samplerate = _samplerate;
 	stereo = _stereo;
 
+	psg_term();
+
+	for (int i = 0; i < (stereo ? 2 : 1); i++) {
+		if (!(blip[i] = rg_blip_create(samplerate / 10)))
+			return -1;
+		rg_blip_set_rates(blip[i], CLOCK_PSG, samplerate);
+	}
+
+	mix.clocks_per_sample = CLOCK_PSG / samplerate;
+	memset(out, 0, sizeof(out));
+
 	return 0;
 }
 
@@ -187,37 +202,35 @@ psg_init(int _samplerate, bool _stereo)
 void
 psg_term(void)
 {
-	//
+	for (int i = 0; i < 2; i++) {
+		rg_blip_free(blip[i]);
+		blip[i] = NULL;
+	}
 }
 
 
 void
 psg_update(int16_t *output, size_t length, bool downsample)
 {
-	int lvol = (PCE.PSG.volume >> 4);
-	int rvol = (PCE.PSG.volume & 0x0F);
+	int stride = stereo ? 2 : 1;
 
-	if (stereo) {
-		length *= 2;
+	if (!blip[0]) {
+		memset(output, 0, length * stride * sizeof(int16_t));
+		return;
 	}
 
-	memset(output, 0, length * sizeof(int16_t));
+	mix.lvol = (PCE.PSG.volume >> 4);
+	mix.rvol = (PCE.PSG.volume & 0x0F);
+	mix.unsigned_samples = downsample;
 
-	for (int i = 0; i < PSG_CHANNELS; i++)
-	{
-		sample_t mix_buffer[length + 1];
-		psg_update_chan(mix_buffer, i, length);
+	unsigned clocks = rg_blip_clocks_needed(blip[0], length);
 
-		if (downsample) {
-			for (int j = 0; j < length; j += 2) {
-				output[j] += (uint8_t)mix_buffer[j] * lvol;
-				output[j + 1] += (uint8_t)mix_buffer[j + 1] * rvol;
-			}
-		} else {
-			for (int j = 0; j < length; j += 2) {
-				output[j] += mix_buffer[j] * lvol;
-				output[j + 1] += mix_buffer[j + 1] * rvol;
-			}
-		}
+	for (int i = 0; i < PSG_CHANNELS; i++) {
+		psg_update_chan(i, clocks);
+	}
+
+	for (int i = 0; i < stride; i++) {
+		rg_blip_end_frame(blip[i], clocks);
+		rg_blip_read_samples(blip[i], output + i, length, stride);
 	}
 }
@@ -5,6 +5,7 @@
 #include <gnuboy.h>
 
 static bool fullFrame = false;
+static bool formatChanged = false;
 static long skipFrames = 20; // The 20 is to hide startup flicker in some games
 
 static const char *sramFile;
@@ -67,6 +68,29 @@ static bool reset_handler(bool hard)
     return true;
 }
 
+static bool save_snapshot_handler(void *buffer, size_t *length)
+{
+    return gnuboy_save_snapshot(buffer, length) == 0;
+}
+
+static bool load_snapshot_handler(void *buffer, size_t *length)
+{
+    return gnuboy_load_snapshot(buffer, *length) == 0;
+}
+
+static void run_frame(bool draw, bool audio)
+{
+    int16_t *buffer = host.audio.buffer;
+
+    // Run-ahead frames produce no sound at all, see sound_end_frame
+    if (!audio)
+        host.audio.buffer = NULL;
+
+    gnuboy_run(draw);
+
+    host.audio.buffer = buffer;
+}
+
 static rg_gui_event_t palette_update_cb(rg_gui_option_t *option, rg_gui_event_t event)
 {
     int pal = gnuboy_get_palette();
@@ -205,11 +229,39 @@ static rg_gui_event_t sram_settings_cb(rg_gui_option_t *option, rg_gui_event_t e
 static void blit_frame(void)
 {
     rg_video_update_t *previousUpdate = &updates[currentUpdate == &updates[0]];
+    if (host.video.format == GB_PIXEL_PALETTED)
+    {
+        memcpy(currentUpdate->palette, host.video.palette, sizeof(host.video.palette));
+        // The diff only sees color indexes, any palette change requires a full redraw
+        if (memcmp(currentUpdate->palette, previousUpdate->palette, sizeof(host.video.palette)) != 0)
+            previousUpdate = NULL;
+    }
+    // The previous frame is in the other pixel format, there's nothing to diff against
+    if (formatChanged)
+        previousUpdate = NULL, formatChanged = false;
     fullFrame = rg_display_queue_update(currentUpdate, previousUpdate) == RG_UPDATE_FULL;
-    currentUpdate = previousUpdate;
+    currentUpdate = &updates[currentUpdate == &updates[0]];
     host.video.buffer = currentUpdate->buffer;
 }
 
+static void update_display_mode(void)
+{
+    // When scaling, write_rect() reads every source pixel anyway so it might as well do the palette
+    // lookup and spare us a full conversion pass. Unscaled, it can stream 565 lines as they are.
+    gb_pixformat_t format = rg_display_get_scaling() ? GB_PIXEL_PALETTED : GB_PIXEL_565_BE;
+
+    if (format == host.video.format)
+        return;
+
+    // The core and the display must always agree on the pixel format
+    gnuboy_set_pixformat(format);
+    formatChanged = true;
+    if (format == GB_PIXEL_PALETTED)
+        rg_display_set_source_format(GB_WIDTH, GB_HEIGHT, 0, 0, GB_WIDTH, RG_PIXEL_PAL565_BE);
+    else
+        rg_display_set_source_format(GB_WIDTH, GB_HEIGHT, 0, 0, GB_WIDTH * 2, RG_PIXEL_565_BE);
+}
+
 static void auto_sram_update(void)
 {
     if (autoSaveSRAM > 0 && gnuboy_sram_dirty())
@@ -230,6 +282,8 @@ void gbc_main(void)
         .saveState = &save_state_handler,
         .reset = &reset_handler,
         .screenshot = &screenshot_handler,
+        .saveSnapshot = &save_snapshot_handler,
+        .loadSnapshot = &load_snapshot_handler,
     };
     const rg_gui_option_t options[] = {
         {0, "Palette", "7/7", 1, &palette_update_cb},
@@ -266,6 +320,7 @@ void gbc_main(void)
         gnuboy_load_bios(RG_BASE_PATH_BIOS "/gb_bios.bin");
 
     gnuboy_set_palette(rg_settings_get_number(NS_APP, SETTING_PALETTE, GB_PALETTE_CGB));
+    update_display_mode();
 
     // Hard reset to have a clean slate
     gnuboy_reset(true);
@@ -292,7 +347,7 @@ void gbc_main(void)
 
     while (true)
     {
-        joystick = rg_input_read_gamepad();
+        joystick = rg_input_sample();
 
         if (joystick & (RG_KEY_MENU|RG_KEY_OPTION))
         {
@@ -302,6 +357,7 @@ void gbc_main(void)
             else
                 rg_gui_options_menu();
             rg_audio_set_sample_rate(app->sampleRate * app->speed);
+            update_display_mode();
         }
         else if (joystick != joystick_old)
         {
@@ -321,7 +377,7 @@ void gbc_main(void)
         int64_t startTime = rg_system_timer();
         bool drawFrame = !skipFrames;
 
-        gnuboy_run(drawFrame);
+        rg_emu_run_frame(&run_frame, drawFrame);
 
         if (autoSaveSRAM > 0)
         {
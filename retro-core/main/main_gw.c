@@ -133,13 +133,12 @@ void gw_main(void)
 
     rg_display_set_source_format(GW_SCREEN_WIDTH, GW_SCREEN_HEIGHT, 0, 0, GW_SCREEN_WIDTH * 2, RG_PIXEL_565_LE);
 
-    FILE *fp = fopen(app->romPath, "rb");
-    if (!fp)
+    rg_reader_t *reader = rg_storage_reader_open(app->romPath);
+    if (!reader)
         RG_PANIC("Rom load failed");
     ROM_DATA = malloc(400000);
-    // fseek(fp, 0x15, SEEK_SET);
-    ROM_DATA_LENGTH = fread(ROM_DATA, 1, 400000, fp);
-    fclose(fp);
+    ROM_DATA_LENGTH = rg_storage_reader_read(reader, 0, ROM_DATA, RG_MIN(rg_storage_reader_size(reader), 400000));
+    rg_storage_reader_close(reader);
 
     unsigned previous_m_halt = 2;
 
@@ -226,7 +225,7 @@ void gw_main(void)
         previous_m_halt = m_halt;
 
         // hardware keys
-        uint32_t joystick = rg_input_read_gamepad();
+        uint32_t joystick = rg_input_sample();
 
         if (joystick & RG_KEY_MENU)
             rg_gui_game_menu();
@@ -255,7 +254,13 @@ void gw_main(void)
         if (!rg_display_is_busy() && drawFrame)
         {
             gw_system_blit(currentUpdate->buffer);
-            rg_display_queue_update(currentUpdate, NULL);
+
+            const gw_rect_t *rects;
+            rg_display_rect_t dirty[GW_DIRTY_RECTS_MAX];
+            int count = gw_system_dirty_rects(&rects);
+            for (int i = 0; i < count; i++)
+                dirty[i] = (rg_display_rect_t){rects[i].x, rects[i].y, rects[i].width, rects[i].height};
+            rg_display_submit_rects(currentUpdate, dirty, count);
         }
         /****************************************************************************/
 
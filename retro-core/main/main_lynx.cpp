@@ -19,7 +19,6 @@ static int dpad_mapped_right;
 static void set_display_mode(void)
 {
     display_rotation_t rotation = rg_display_get_rotation();
-    int width, height;
 
     if (rotation == RG_DISPLAY_ROTATION_AUTO)
     {
@@ -49,27 +48,19 @@ static void set_display_mode(void)
     switch(rotation)
     {
         case RG_DISPLAY_ROTATION_LEFT:
-            width = HANDY_SCREEN_HEIGHT;
-            height = HANDY_SCREEN_WIDTH;
-            lynx->mMikie->SetRotation(MIKIE_ROTATE_L);
             dpad_mapped_up    = BUTTON_RIGHT;
             dpad_mapped_down  = BUTTON_LEFT;
             dpad_mapped_left  = BUTTON_UP;
             dpad_mapped_right = BUTTON_DOWN;
             break;
         case RG_DISPLAY_ROTATION_RIGHT:
-            width = HANDY_SCREEN_HEIGHT;
-            height = HANDY_SCREEN_WIDTH;
-            lynx->mMikie->SetRotation(MIKIE_ROTATE_R);
             dpad_mapped_up    = BUTTON_LEFT;
             dpad_mapped_down  = BUTTON_RIGHT;
             dpad_mapped_left  = BUTTON_DOWN;
             dpad_mapped_right = BUTTON_UP;
             break;
         default:
-            width = HANDY_SCREEN_WIDTH;
-            height = HANDY_SCREEN_HEIGHT;
-            lynx->mMikie->SetRotation(MIKIE_NO_ROTATE);
+            rotation = RG_DISPLAY_ROTATION_OFF;
             dpad_mapped_up    = BUTTON_UP;
             dpad_mapped_down  = BUTTON_DOWN;
             dpad_mapped_left  = BUTTON_LEFT;
@@ -77,7 +68,9 @@ static void set_display_mode(void)
             break;
     }
 
-    rg_display_set_source_format(width, height, 0, 0, HANDY_SCREEN_WIDTH * 2, RG_PIXEL_565_BE);
+    // Mikie always renders the native orientation, the display driver rotates while scaling
+    rg_display_set_source_format(HANDY_SCREEN_WIDTH, HANDY_SCREEN_HEIGHT, 0, 0, HANDY_SCREEN_WIDTH * 2, RG_PIXEL_565_BE);
+    rg_display_set_source_rotation(rotation);
 }
 
 
@@ -165,9 +158,8 @@ extern "C" void lynx_main(void)
 
     app = rg_system_reinit(AUDIO_SAMPLE_RATE, &handlers, options);
 
-    // the HANDY_SCREEN_WIDTH * HANDY_SCREEN_WIDTH is deliberate because of rotation
-    updates[0].buffer = (void*)rg_alloc(HANDY_SCREEN_WIDTH * HANDY_SCREEN_WIDTH * 2, MEM_FAST);
-    updates[1].buffer = (void*)rg_alloc(HANDY_SCREEN_WIDTH * HANDY_SCREEN_WIDTH * 2, MEM_FAST);
+    updates[0].buffer = (void*)rg_alloc(HANDY_SCREEN_WIDTH * HANDY_SCREEN_HEIGHT * 2, MEM_FAST);
+    updates[1].buffer = (void*)rg_alloc(HANDY_SCREEN_WIDTH * HANDY_SCREEN_HEIGHT * 2, MEM_FAST);
 
     // The Lynx has a variable framerate but 60 is typical
     app->refreshRate = 60;
@@ -198,7 +190,7 @@ extern "C" void lynx_main(void)
     // Start emulation
     while (1)
     {
-        uint32_t joystick = rg_input_read_gamepad();
+        uint32_t joystick = rg_input_sample();
 
         if (joystick & (RG_KEY_MENU|RG_KEY_OPTION))
         {
@@ -49,6 +49,28 @@ static bool reset_handler(bool hard)
     return true;
 }
 
+static bool save_snapshot_handler(void *buffer, size_t *length)
+{
+    return state_save_snapshot(buffer, length) == 0;
+}
+
+static bool load_snapshot_handler(void *buffer, size_t *length)
+{
+    return state_load_snapshot(buffer, *length) == 0;
+}
+
+static void run_frame(bool draw, bool audio)
+{
+    short *buffer = nes->apu->buffer;
+
+    if (!audio)
+        nes->apu->buffer = NULL;
+
+    nes_emulate(draw);
+
+    nes->apu->buffer = buffer;
+}
+
 
 static void set_display_mode(void)
 {
@@ -166,6 +188,23 @@ static void blit_screen(uint8 *bmp)
     currentUpdate = &updates[currentUpdate == &updates[0]];
 }
 
+static void log_cache_stats(void)
+{
+    static ppu_cachestats_t prev;
+    ppu_cachestats_t stats;
+
+    ppu_getcachestats(&stats);
+
+    uint32_t hits = stats.hits - prev.hits;
+    uint32_t misses = stats.misses - prev.misses;
+
+    RG_LOGD("Pattern cache: %.2f%% hits, %u misses, %u flushes\n",
+        (hits + misses) ? hits * 100.f / (hits + misses) : 0.f, (unsigned)misses,
+        (unsigned)(stats.flushes - prev.flushes));
+
+    prev = stats;
+}
+
 static void nsf_draw_overlay(void)
 {
     extern int nsf_current_song;
@@ -191,6 +230,8 @@ void nes_main(void)
         .reset = &reset_handler,
         .event = &event_handler,
         .screenshot = &screenshot_handler,
+        .saveSnapshot = &save_snapshot_handler,
+        .loadSnapshot = &load_snapshot_handler,
     };
     const rg_gui_option_t options[] = {
         {1, "Palette     ", "Default", 1, &palette_update_cb},
@@ -241,11 +282,12 @@ void nes_main(void)
     }
 
     int skipFrames = 0;
+    int frames = 0;
     int nsfPlayer = nes->cart->mapper_number == 31;
 
     while (true)
     {
-        uint32_t joystick = rg_input_read_gamepad();
+        uint32_t joystick = rg_input_sample();
 
         if (joystick & (RG_KEY_MENU|RG_KEY_OPTION))
         {
@@ -272,7 +314,10 @@ void nes_main(void)
         if (joystick & RG_KEY_B)      buttons |= NES_PAD_B;
         input_update(0, buttons);
 
-        nes_emulate(drawFrame);
+        rg_emu_run_frame(&run_frame, drawFrame);
+
+        if (++frames % 600 == 0)
+            log_cache_stats();
 
         int elapsed = rg_system_timer() - startTime;
 
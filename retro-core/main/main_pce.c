@@ -81,7 +81,7 @@ void osd_vsync(void)
     if (skipFrames == 0)
     {
         rg_video_update_t *previousUpdate = &updates[currentUpdate == &updates[0]];
-        rg_display_queue_update(currentUpdate, NULL);
+        rg_display_submit_lines(currentUpdate, DirtyLinesPCE());
         currentUpdate = previousUpdate;
     }
 
@@ -126,7 +126,7 @@ void osd_vsync(void)
 
 void osd_input_read(uint8_t joypads[8])
 {
-    uint32_t joystick = rg_input_read_gamepad();
+    uint32_t joystick = rg_input_sample();
     uint32_t buttons = 0;
 
     if (joystick & (RG_KEY_MENU|RG_KEY_OPTION))
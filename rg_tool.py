@@ -197,10 +197,11 @@ def clean_app(app):
     print("Done.\n")
 
 
-def build_app(app, device_type, with_profiling=False, without_networking=False):
+def build_app(app, device_type, with_profiling=False, without_networking=False, with_memtrace=False):
     # To do: clean up if any of the flags changed since last build
     print("Building app '%s'" % app)
     os.putenv("RG_ENABLE_PROFILING", "1" if with_profiling else "0")
+    os.putenv("RG_ENABLE_MEMTRACE", "1" if with_memtrace else "0")
     os.putenv("RG_ENABLE_NETWORKING", "0" if without_networking else "1")
     os.putenv("RG_BUILD_TARGET", re.sub(r'[^A-Z0-9]', '_', device_type.upper()))
     os.putenv("RG_BUILD_TIME", str(int(time.time())))
@@ -296,6 +297,9 @@ parser.add_argument(
 parser.add_argument(
     "--without-networking", action="store_const", const=True, help="Build without networking enabled"
 )
+parser.add_argument(
+    "--with-memtrace", action="store_const", const=True, help="Build with memory access tracing (slow!)"
+)
 parser.add_argument(
     "--port", default=DEFAULT_PORT, help="Serial port to use for flash and monitor"
 )
@@ -328,7 +332,7 @@ if command in ["clean", "release"]:
 if command in ["build", "build-fw", "build-img", "release", "run", "profile"]:
     print("=== Step: Building ===\n")
     for app in apps:
-        build_app(app, args.target, command == "profile", args.without_networking)
+        build_app(app, args.target, command == "profile", args.without_networking, args.with_memtrace)
 
 if command in ["build-fw", "release"]:
     print("=== Step: Packing ===\n")
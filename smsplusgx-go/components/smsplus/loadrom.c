@@ -366,30 +366,31 @@ void set_rom_config(void)
 
 int load_rom(const char *filename)
 {
-  size_t actual_size = 0, count = 0;
+  size_t actual_size = 0;
 
-  FILE *fd = fopen(filename, "rb");
-  if (fd)
+  /* The ROM is mapped as is, only tiny ones are copied to get the 16KB minimum */
+  uint8 *data = rg_storage_map(filename, &actual_size, 0);
+  if (!data)
   {
-    fseek(fd, 0, SEEK_END);
-    actual_size = ftell(fd);
-    fseek(fd, 0, SEEK_SET);
-
-    cart.size = actual_size < 0x4000 ? 0x4000 : actual_size;
-    cart.rom = calloc(1, cart.size);
-    cart.sram = calloc(1, 0x8000);
+    return 0;
+  }
 
-    if (!cart.rom || !cart.sram) abort();
+  cart.size = actual_size < 0x4000 ? 0x4000 : actual_size;
+  cart.sram = calloc(1, 0x8000);
 
-    count = fread(cart.rom, actual_size, 1, fd);
-    fclose(fd);
+  if (actual_size < 0x4000)
+  {
+    cart.rom = calloc(1, cart.size);
+    if (cart.rom) memcpy(cart.rom, data, actual_size);
+    rg_storage_unmap(data);
   }
-
-  if (count == 0)
+  else
   {
-    return 0;
+    cart.rom = data;
   }
 
+  if (!cart.rom || !cart.sram) abort();
+
   if (strcasecmp(filename + (strlen(filename) - 4), ".col") == 0)
   {
     option.console = 6;
@@ -399,10 +400,10 @@ int load_rom(const char *filename)
   if ((cart.size / 512) & 1)
   {
     cart.size -= 512;
-    memmove(cart.rom, cart.rom + 512, cart.size);
+    cart.rom += 512;
   }
 
-  cart.crc = crc32_le(0, cart.rom, option.console == 6 ? actual_size : cart.size);
+  cart.crc = crc32_le(0, cart.rom, option.console == 6 && actual_size < cart.size ? actual_size : cart.size);
 
   set_rom_config();
 
@@ -19,7 +19,7 @@ typedef signed long int int32;
 
 #ifdef RETRO_GO
 #include <rg_system.h>
-#define LOG_PRINTF(level, x...) rg_system_log(RG_LOG_USER, NULL, x)
+#define LOG_PRINTF(level, fmt, x...) rg_system_log(RG_LOG_USER | RG_LOG_FLAGS(fmt), NULL, fmt, ## x)
 #define crc32_le(a, b, c) rg_crc32(a, b, c)
 #else
 #define LOG_PRINTF(level, x...) printf(x)
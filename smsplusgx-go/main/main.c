@@ -146,7 +146,7 @@ void app_main(void)
 
     while (true)
     {
-        *localJoystick = rg_input_read_gamepad();
+        *localJoystick = rg_input_sample();
 
         if (*localJoystick & (RG_KEY_MENU|RG_KEY_OPTION))
         {
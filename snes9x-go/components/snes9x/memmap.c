@@ -330,7 +330,9 @@ bool LoadROM(const char* filename)
    int32_t TotalFileSize = 0;
    bool Interleaved = false;
    bool Tales = false;
-   FILE *fp;
+   rg_reader_t *fp;
+   uint8_t *data;
+   size_t size;
 
    printf("Loading ROM: '%s'\n", filename ?: "(null)");
 
@@ -347,13 +349,20 @@ again:
    {
       printf("Using Memory.ROM as is.\n");
    }
-   else if ((fp = fopen(filename, "rb")))
+   else if ((data = rg_storage_map(filename, &size, RG_MAP_NO_COPY)))
    {
-      fseek(fp, 0, SEEK_END);
-      Memory.ROM_Size = ftell(fp);
-      fseek(fp, 0, SEEK_SET);
-      fread(Memory.ROM, MIN(Memory.ROM_Size, MAX_ROM_SIZE), 1, fp);
-      fclose(fp);
+      // The ROM is patched and deinterleaved in place so it still needs a copy, but it comes
+      // straight from the page cache and the copier header is dropped on the way.
+      size_t skip = (size & 0x7FF) == 512 ? 512 : 0;
+      Memory.ROM_Size = size - skip;
+      memcpy(Memory.ROM, data + skip, MIN(Memory.ROM_Size, MAX_ROM_SIZE));
+      rg_storage_unmap(data);
+   }
+   else if ((fp = rg_storage_reader_open(filename)))
+   {
+      Memory.ROM_Size = rg_storage_reader_size(fp);
+      rg_storage_reader_read(fp, 0, Memory.ROM, MIN(Memory.ROM_Size, MAX_ROM_SIZE));
+      rg_storage_reader_close(fp);
    }
    else
    {
@@ -334,7 +334,7 @@ void app_main(void)
 
     while (1)
     {
-        uint32_t joystick = rg_input_read_gamepad();
+        uint32_t joystick = rg_input_sample();
 
         if (menuPressed && !(joystick & RG_KEY_MENU))
         {
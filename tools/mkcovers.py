@@ -0,0 +1,196 @@
+#!/usr/bin/env python
+import sys, os, zlib, struct
+
+# Converts a cover tree (covers/<sys>/<X>/<CRC>.png) to one cover pack per system (<sys>.pack).
+#
+# Pack format (little endian):
+#   header: magic "RGCP", version:U32, count:U32, reserved:U32
+#   index:  {crc:U32 offset:U32 size:U32 original_size:U32} * count, sorted by crc
+#   data:   one rg_image_t blob (width:U16 height:U16 RGB565 pixels) per cover. The blob is
+#           LZ4 block compressed when size != original_size.
+
+PACK_MAGIC = b"RGCP"
+PACK_VERSION = 1
+
+
+def png_decode(data):
+    if data[:8] != b"\x89PNG\r\n\x1a\n":
+        raise ValueError("not a PNG file")
+    pos, idat, palette = 8, b"", None
+    while pos < len(data):
+        length, ctype = struct.unpack(">I4s", data[pos:pos + 8])
+        chunk = data[pos + 8:pos + 8 + length]
+        pos += length + 12
+        if ctype == b"IHDR":
+            width, height, depth, color, _, _, interlace = struct.unpack(">IIBBBBB", chunk)
+        elif ctype == b"PLTE":
+            palette = [tuple(chunk[i:i + 3]) for i in range(0, len(chunk), 3)]
+        elif ctype == b"IDAT":
+            idat += chunk
+        elif ctype == b"IEND":
+            break
+    if depth != 8 or interlace:
+        raise ValueError("unsupported PNG (depth %d, interlace %d)" % (depth, interlace))
+    channels = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}[color]
+    raw = zlib.decompress(idat)
+    stride = width * channels
+    prev = bytearray(stride)
+    pixels = []
+    for y in range(height):
+        ftype = raw[y * (stride + 1)]
+        line = bytearray(raw[y * (stride + 1) + 1:(y + 1) * (stride + 1)])
+        for i in range(stride):
+            a = line[i - channels] if i >= channels else 0
+            b = prev[i]
+            if ftype == 1:
+                line[i] = (line[i] + a) & 0xFF
+            elif ftype == 2:
+                line[i] = (line[i] + b) & 0xFF
+            elif ftype == 3:
+                line[i] = (line[i] + ((a + b) >> 1)) & 0xFF
+            elif ftype == 4:
+                c = prev[i - channels] if i >= channels else 0
+                p = a + b - c
+                pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+                line[i] = (line[i] + (a if pa <= pb and pa <= pc else b if pb <= pc else c)) & 0xFF
+        prev = line
+        for x in range(width):
+            px = line[x * channels:(x + 1) * channels]
+            if color == 3:
+                pixels.append(palette[px[0]])
+            elif color in (0, 4):
+                pixels.append((px[0], px[0], px[0]))
+            else:
+                pixels.append(tuple(px[:3]))
+    return width, height, pixels
+
+
+def box_downscale(width, height, pixels, max_width, max_height):
+    scale = min(max_width / width, max_height / height)
+    if scale >= 1:
+        return width, height, pixels
+    new_width, new_height = max(1, int(width * scale)), max(1, int(height * scale))
+    out = []
+    for y in range(new_height):
+        y0, y1 = y * height // new_height, max((y + 1) * height // new_height, y * height // new_height + 1)
+        for x in range(new_width):
+            x0, x1 = x * width // new_width, max((x + 1) * width // new_width, x * width // new_width + 1)
+            acc, count = [0, 0, 0], (y1 - y0) * (x1 - x0)
+            for sy in range(y0, y1):
+                for px in pixels[sy * width + x0:sy * width + x1]:
+                    acc[0] += px[0]; acc[1] += px[1]; acc[2] += px[2]
+            out.append(tuple((v + count // 2) // count for v in acc))
+    return new_width, new_height, out
+
+
+def to_rg_image(width, height, pixels):
+    blob = bytearray(struct.pack("<HH", width, height))
+    for r, g, b in pixels:
+        blob += struct.pack("<H", ((r * 31 + 127) // 255) << 11 | ((g * 63 + 127) // 255) << 5 | ((b * 31 + 127) // 255))
+    return bytes(blob)
+
+
+def lz4_compress(data):
+    # Greedy LZ4 block compressor, compatible with rg_lz4_decompress
+    out, table, anchor, pos, end = bytearray(), {}, 0, 0, len(data)
+
+    def emit(literals, offset=0, match_len=0):
+        lit_len = len(literals)
+        token = (min(lit_len, 15) << 4) | (min(match_len - 4, 15) if offset else 0)
+        out.append(token)
+        if lit_len >= 15:
+            n = lit_len - 15
+            while n >= 255:
+                out.append(255); n -= 255
+            out.append(n)
+        out.extend(literals)
+        if offset:
+            out.extend(struct.pack("<H", offset))
+            if match_len - 4 >= 15:
+                n = match_len - 4 - 15
+                while n >= 255:
+                    out.append(255); n -= 255
+                out.append(n)
+
+    # The last match must start at least 12 bytes before the end, the last 5 bytes are literals
+    while pos < end - 12:
+        key = data[pos:pos + 4]
+        ref = table.get(key)
+        table[key] = pos
+        if ref is None or pos - ref > 65535:
+            pos += 1
+            continue
+        match_len = 4
+        while pos + match_len < end - 5 and data[ref + match_len] == data[pos + match_len]:
+            match_len += 1
+        emit(data[anchor:pos], pos - ref, match_len)
+        pos += match_len
+        anchor = pos
+    emit(data[anchor:])
+    return bytes(out)
+
+
+def build_pack(folder, output, max_width, max_height, compress):
+    covers = {}
+    for root, dirs, files in os.walk(folder):
+        for name in files:
+            base, ext = os.path.splitext(name)
+            if ext.lower() != ".png":
+                continue
+            try:
+                crc = int(base, 16)
+            except ValueError:
+                continue # Named covers can't be indexed by crc, they stay loose
+            try:
+                with open(os.path.join(root, name), "rb") as f:
+                    width, height, pixels = png_decode(f.read())
+            except Exception as err:
+                print(" > WARNING: skipping %s: %s" % (os.path.join(root, name), err))
+                continue
+            blob = to_rg_image(*box_downscale(width, height, pixels, max_width, max_height))
+            packed = lz4_compress(blob) if compress else blob
+            covers[crc] = (packed if len(packed) < len(blob) else blob, len(blob))
+
+    if not covers:
+        return 0
+
+    index, data = [], []
+    offset = 16 + len(covers) * 16
+    for crc in sorted(covers):
+        blob, original_size = covers[crc]
+        index.append(struct.pack("<IIII", crc, offset, len(blob), original_size))
+        data.append(blob)
+        offset += len(blob)
+
+    with open(output, "wb") as f:
+        f.write(struct.pack("<4sIII", PACK_MAGIC, PACK_VERSION, len(covers), 0))
+        f.write(b"".join(index))
+        f.write(b"".join(data))
+
+    print("%s: %d covers, %.2f MB" % (output, len(covers), offset / 1048576))
+    return len(covers)
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 3:
+        exit("usage: mkcovers.py [--lz4] [--size 160x168] covers_folder output_folder")
+
+    args = sys.argv[1:]
+    compress = "--lz4" in args
+    max_width, max_height = 160, 168
+
+    if compress:
+        args.remove("--lz4")
+
+    if "--size" in args:
+        i = args.index("--size")
+        max_width, max_height = [int(v) for v in args[i + 1].lower().split("x")]
+        del args[i:i + 2]
+
+    covers_folder, output_folder = args[0], args[1]
+    os.makedirs(output_folder, exist_ok=True)
+
+    for system in sorted(os.listdir(covers_folder)):
+        if os.path.isdir(os.path.join(covers_folder, system)):
+            build_pack(os.path.join(covers_folder, system), os.path.join(output_folder, system + ".pack"),
+                       max_width, max_height, compress)
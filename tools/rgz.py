@@ -0,0 +1,75 @@
+#!/usr/bin/env python
+import sys, os, zlib, struct
+from mkcovers import lz4_compress
+
+# Converts ROMs to the block compressed container read by rg_storage_reader_*. The file name
+# (and extension) is kept, the emulators detect the container by its magic.
+#
+# Container format (little endian):
+#   header:  magic "RGZB", version:U8, block_shift:U8, reserved:U16, size:U32, crc32:U32
+#   offsets: U32 * (block_count + 1), file offset of each block (the last one marks the end)
+#   blocks:  LZ4 blocks, or raw data when a block didn't compress (stored size == block size)
+
+RGZ_MAGIC = b"RGZB"
+RGZ_VERSION = 1
+
+
+def compress_rom(data, block_shift):
+    block_size = 1 << block_shift
+    blocks = []
+    for pos in range(0, len(data), block_size):
+        raw = data[pos:pos + block_size]
+        packed = lz4_compress(raw)
+        blocks.append(packed if len(packed) < len(raw) else raw)
+
+    offset = 16 + (len(blocks) + 1) * 4
+    offsets = []
+    for block in blocks:
+        offsets.append(offset)
+        offset += len(block)
+    offsets.append(offset)
+
+    header = struct.pack("<4sBBHII", RGZ_MAGIC, RGZ_VERSION, block_shift, 0, len(data), zlib.crc32(data))
+    return header + struct.pack("<%dI" % len(offsets), *offsets) + b"".join(blocks)
+
+
+def convert(source, dest, block_shift):
+    with open(source, "rb") as f:
+        data = f.read()
+    if data[:4] == RGZ_MAGIC:
+        print("%s: already compressed" % source)
+        return
+    packed = compress_rom(data, block_shift)
+    if len(packed) >= len(data):
+        print("%s: doesn't compress, copied as is" % source)
+        packed = data
+    else:
+        print("%s: %d => %d bytes (%.1f%%)" % (source, len(data), len(packed), len(packed) * 100 / len(data)))
+    os.makedirs(os.path.dirname(dest) or ".", exist_ok=True)
+    with open(dest, "wb") as f:
+        f.write(packed)
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 3:
+        exit("usage: rgz.py [--block-size 16384] rom_file_or_folder output_file_or_folder")
+
+    args = sys.argv[1:]
+    block_shift = 14 # 16KB matches GB/SMS/NES banks
+
+    if "--block-size" in args:
+        i = args.index("--block-size")
+        block_shift = int(args[i + 1]).bit_length() - 1
+        del args[i:i + 2]
+        if not 10 <= block_shift <= 20:
+            exit("block size must be a power of two between 1KB and 1MB")
+
+    source, dest = args[0], args[1]
+
+    if os.path.isdir(source):
+        for root, dirs, files in os.walk(source):
+            for name in sorted(files):
+                path = os.path.join(root, name)
+                convert(path, os.path.join(dest, os.path.relpath(path, source)), block_shift)
+    else:
+        convert(source, dest, block_shift)